@@ -0,0 +1,52 @@
+#version 450 core
+
+layout(binding = 0) uniform Matrices {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightSpaceMatrices[4]; // Has to match ShadowCascades::MAX_CASCADES
+    vec4 cascadeSplitDistances;
+    vec3 lightDirection;
+    float ambientLight;
+    uint numShadowCascades;
+} u_Matrices;
+
+layout(std430, binding = 2) readonly buffer Palettes {
+    vec4 colors[];
+} u_Palettes;
+
+layout(location = 0) in vec3 in_Position; // Packed, see PackedVertex
+layout(location = 1) in vec2 in_Normal; // Octahedral encoded
+layout(location = 2) in vec3 in_Color; // The red channel holds the material slot of the vertex as unorm8
+layout(location = 3) in vec3 instance_Position;
+layout(location = 4) in float instance_Rotation;
+layout(location = 5) in uint instance_Palette;
+layout(location = 0) out vec3 fs_Color;
+layout(location = 1) out vec3 fs_Normal;
+layout(location = 2) out vec3 fs_WorldPosition;
+layout(location = 3) flat out float fs_AmbientLight;
+layout(location = 4) flat out vec3 fs_LightDirection;
+
+// Has to match PackedVertex::POSITION_RANGE
+const float POSITION_RANGE = 8.0;
+
+vec3 decodeNormal(vec2 octahedral) {
+    vec3 normal = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+void main() {
+    vec3 localPosition = in_Position * POSITION_RANGE;
+    fs_Color = u_Palettes.colors[instance_Palette + uint(round(in_Color.r * 255.0))].rgb;
+    mat3 rotation_matrix = mat3(1.0);
+    rotation_matrix[0] = vec3(cos(instance_Rotation), 0.0, sin(instance_Rotation));
+    rotation_matrix[2] = vec3(-sin(instance_Rotation), 0.0, cos(instance_Rotation));
+    fs_Normal = rotation_matrix * decodeNormal(in_Normal);
+    vec3 position = rotation_matrix * localPosition + instance_Position;
+    fs_WorldPosition = position;
+    fs_AmbientLight = u_Matrices.ambientLight;
+    fs_LightDirection = u_Matrices.lightDirection;
+    gl_Position = u_Matrices.projectionMatrix * u_Matrices.viewMatrix * vec4(position, 1.0);
+}
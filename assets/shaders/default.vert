@@ -3,9 +3,11 @@
 layout(binding = 0) uniform Matrices {
     mat4 projectionMatrix;
     mat4 viewMatrix;
-    mat4 lightSpaceMatrix;
+    mat4 lightSpaceMatrices[4]; // Has to match ShadowCascades::MAX_CASCADES
+    vec4 cascadeSplitDistances;
     vec3 lightDirection;
     float ambientLight;
+    uint numShadowCascades;
 } u_Matrices;
 
 layout(push_constant) uniform PushConstants {
@@ -13,22 +15,35 @@ layout(push_constant) uniform PushConstants {
     bool debugBB;
 } u_PushConstants;
 
-layout(location = 0) in vec3 in_Position;
-layout(location = 1) in vec3 in_Normal;
-layout(location = 2) in vec3 in_Color;
+layout(location = 0) in vec3 in_Position; // Packed, see PackedVertex
+layout(location = 1) in vec2 in_Normal; // Octahedral encoded
+layout(location = 2) in vec3 in_Color; // Square root of the color
 layout(location = 0) out vec3 fs_Color;
 layout(location = 1) out vec3 fs_Normal;
-layout(location = 2) out vec4 fs_PositionInLightSpace;
+layout(location = 2) out vec3 fs_WorldPosition;
 layout(location = 3) flat out int fs_Transparency;
 layout(location = 4) flat out float fs_AmbientLight;
 layout(location = 5) flat out vec3 fs_LightDirection;
 
+// Has to match PackedVertex::POSITION_RANGE
+const float POSITION_RANGE = 8.0;
+
+vec3 decodeNormal(vec2 octahedral) {
+    vec3 normal = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
 void main() {
-    fs_Color = in_Color;
-    fs_Normal = in_Normal;
-    fs_PositionInLightSpace = u_Matrices.lightSpaceMatrix * u_PushConstants.modelMatrix * vec4(in_Position, 1.0);
+    vec3 localPosition = in_Position * POSITION_RANGE;
+    fs_Color = in_Color * in_Color;
+    fs_Normal = decodeNormal(in_Normal);
+    vec4 worldPosition = u_PushConstants.modelMatrix * vec4(localPosition, 1.0);
+    fs_WorldPosition = worldPosition.xyz;
     fs_Transparency = u_PushConstants.debugBB ? 1 : 0;
     fs_AmbientLight = u_Matrices.ambientLight;
     fs_LightDirection = u_Matrices.lightDirection;
-    gl_Position = u_Matrices.projectionMatrix * u_Matrices.viewMatrix * u_PushConstants.modelMatrix * vec4(in_Position, 1.0);
+    gl_Position = u_Matrices.projectionMatrix * u_Matrices.viewMatrix * worldPosition;
 }
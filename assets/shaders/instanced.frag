@@ -1,16 +1,40 @@
 #version 450 core
 
+layout(binding = 0) uniform Matrices {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightSpaceMatrices[4]; // Has to match ShadowCascades::MAX_CASCADES
+    vec4 cascadeSplitDistances;
+    vec3 lightDirection;
+    float ambientLight;
+    uint numShadowCascades;
+} u_Matrices;
+
 layout (binding = 1) uniform sampler2D shadowMap;
 
+// Has to match ShadowCascades::ATLAS_COLUMNS and ShadowCascades::ATLAS_ROWS
+const uint SHADOW_ATLAS_COLUMNS = 2u;
+const uint SHADOW_ATLAS_ROWS = 2u;
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragNormal;
-layout(location = 2) in vec4 fragPositionInLightSpace;
+layout(location = 2) in vec3 fragWorldPosition;
 layout(location = 3) flat in float ambientLight;
 layout(location = 4) flat in vec3 lightDirection;
 layout(location = 0) out vec4 outColor;
 
 float calculateShadowFactor() {
-    vec3 projectedCoordinates = fragPositionInLightSpace.xyz / fragPositionInLightSpace.w;
+    // Cascades are picked by the distance of the fragment from the camera, there are no shadows beyond the last one
+    float viewDistance = -(u_Matrices.viewMatrix * vec4(fragWorldPosition, 1.0)).z;
+    uint cascade = 0u;
+    while (cascade < u_Matrices.numShadowCascades && viewDistance > u_Matrices.cascadeSplitDistances[cascade]) {
+        ++cascade;
+    }
+    if (cascade == u_Matrices.numShadowCascades) {
+        return 0.0;
+    }
+    vec4 positionInLightSpace = u_Matrices.lightSpaceMatrices[cascade] * vec4(fragWorldPosition, 1.0);
+    vec3 projectedCoordinates = positionInLightSpace.xyz / positionInLightSpace.w;
     // While Vulkan NDC Z axis is [0,1] the X and Y axes are [-1,1] which need to be mapped to [0,1]
     projectedCoordinates.x = projectedCoordinates.x * 0.5 + 0.5;
     projectedCoordinates.y = projectedCoordinates.y * 0.5 + 0.5;
@@ -24,12 +48,19 @@ float calculateShadowFactor() {
         projectedCoordinates.y < 0.0) {
         return 0.0;
     }
-    float shadow = 0.0;
+    // Every cascade has its own tile of the shadow map atlas, samples are kept inside of the tile
+    vec2 tileSize = 1.0 / vec2(SHADOW_ATLAS_COLUMNS, SHADOW_ATLAS_ROWS);
+    vec2 tileOffset = vec2(cascade % SHADOW_ATLAS_COLUMNS, cascade / SHADOW_ATLAS_COLUMNS) * tileSize;
     vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 minCoordinates = tileOffset + texelSize * 0.5;
+    vec2 maxCoordinates = tileOffset + tileSize - texelSize * 0.5;
+    vec2 coordinates = tileOffset + projectedCoordinates.xy * tileSize;
+    float shadow = 0.0;
     // PCF implemented by sampling the two neighboring texels also and averaging the result
     for (int x = -1; x <= 1; ++x) {
         for (int y = -1; y <= 1; ++y) {
-            float depth = texture(shadowMap, projectedCoordinates.xy + vec2(x, y) * texelSize).r;
+            vec2 sampleCoordinates = clamp(coordinates + vec2(x, y) * texelSize, minCoordinates, maxCoordinates);
+            float depth = texture(shadowMap, sampleCoordinates).r;
             shadow += currentDepth > depth ? 1.0 : 0.0;
         }
     }
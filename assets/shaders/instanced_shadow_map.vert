@@ -5,14 +5,18 @@ layout(binding = 0) uniform Matrices {
     mat4 viewMatrix;
 } u_Matrices;
 
-layout(location = 0) in vec3 in_Position;
+layout(location = 0) in vec3 in_Position; // Packed, see PackedVertex
 layout(location = 3) in vec3 instance_Position;
 layout(location = 4) in float instance_Rotation;
 
+// Has to match PackedVertex::POSITION_RANGE
+const float POSITION_RANGE = 8.0;
+
 void main() {
+    vec3 localPosition = in_Position * POSITION_RANGE;
     mat3 rotation_matrix = mat3(1.0);
     rotation_matrix[0] = vec3(cos(instance_Rotation), 0.0, sin(instance_Rotation));
     rotation_matrix[2] = vec3(-sin(instance_Rotation), 0.0, cos(instance_Rotation));
-    vec3 position = rotation_matrix * in_Position + instance_Position;
+    vec3 position = rotation_matrix * localPosition + instance_Position;
     gl_Position = u_Matrices.projectionMatrix * u_Matrices.viewMatrix * vec4(position, 1.0);
 }
\ No newline at end of file
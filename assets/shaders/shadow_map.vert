@@ -9,8 +9,12 @@ layout(push_constant) uniform PushConstants {
     mat4 modelMatrix;
 } u_PushConstants;
 
-layout(location = 0) in vec3 in_Position;
+layout(location = 0) in vec3 in_Position; // Packed, see PackedVertex
+
+// Has to match PackedVertex::POSITION_RANGE
+const float POSITION_RANGE = 8.0;
 
 void main() {
-    gl_Position = u_Matrices.projectionMatrix * u_Matrices.viewMatrix * u_PushConstants.modelMatrix * vec4(in_Position, 1.0);
+    vec3 localPosition = in_Position * POSITION_RANGE;
+    gl_Position = u_Matrices.projectionMatrix * u_Matrices.viewMatrix * u_PushConstants.modelMatrix * vec4(localPosition, 1.0);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "weather.h"
+#include "wfc/rule.h"
 
 #include <functional>
 
@@ -29,14 +30,67 @@ namespace inf {
         static constexpr float WEATHER_CHANGE_CHANCE_PERCENTAGE_MIN = 0.0f;
         static constexpr float WEATHER_CHANGE_CHANCE_PERCENTAGE_MAX = 1.0f;
 
+        // How far ahead the camera motion is extrapolated to prefetch districts
+        static constexpr float PREFETCH_HORIZON_SECONDS_INITIAL = 1.0f;
+        static constexpr float PREFETCH_HORIZON_SECONDS_MIN = 0.0f;
+        static constexpr float PREFETCH_HORIZON_SECONDS_MAX = 3.0f;
+
+        // How much the district bounding boxes are enlarged on the ground plane when prefetching
+        static constexpr float PREFETCH_MARGIN_INITIAL = 5.0f;
+        static constexpr float PREFETCH_MARGIN_MIN = 0.0f;
+        static constexpr float PREFETCH_MARGIN_MAX = 50.0f;
+
+        // How much the district bounding boxes are enlarged on the ground plane before a district is evicted. It is
+        // never smaller than the prefetch margin, so small camera movements do not evict and restore the same district.
+        static constexpr float EVICTION_MARGIN_INITIAL = 20.0f;
+        static constexpr float EVICTION_MARGIN_MIN = 0.0f;
+        static constexpr float EVICTION_MARGIN_MAX = 100.0f;
+
+        // Time the main thread may spend on advancing district builds every frame
+        static constexpr float GENERATION_BUDGET_MILLISECONDS_INITIAL = 4.0f;
+        static constexpr float GENERATION_BUDGET_MILLISECONDS_MIN = 1.0f;
+        static constexpr float GENERATION_BUDGET_MILLISECONDS_MAX = 16.0f;
+
+        // Number of shadow cascades, the shadow map atlas has room for ShadowCascades::MAX_CASCADES
+        static constexpr int SHADOW_CASCADES_INITIAL = 4;
+        static constexpr int SHADOW_CASCADES_MIN = 1;
+        static constexpr int SHADOW_CASCADES_MAX = 4;
+
+        // Distance from the camera up to which shadows are rendered
+        static constexpr float SHADOW_DISTANCE_INITIAL = 40.0f;
+        static constexpr float SHADOW_DISTANCE_MIN = 10.0f;
+        static constexpr float SHADOW_DISTANCE_MAX = 100.0f;
+
+        // Blends the shadow cascade splits between uniform (0) and logarithmic (1)
+        static constexpr float SHADOW_SPLIT_LAMBDA_INITIAL = 0.5f;
+        static constexpr float SHADOW_SPLIT_LAMBDA_MIN = 0.0f;
+        static constexpr float SHADOW_SPLIT_LAMBDA_MAX = 1.0f;
+
+        // Width and height of the tile of every shadow cascade in the shadow map atlas, the shadow maps are recreated once it changed
+        static constexpr int SHADOW_CASCADE_RESOLUTION_INITIAL = 1536;
+        static constexpr int SHADOW_CASCADE_RESOLUTION_MIN = 512;
+        static constexpr int SHADOW_CASCADE_RESOLUTION_MAX = 2048;
+
         float time_of_day;
         float camera_speed;
         bool fix_time_of_day;
         bool override_weather;
         float weather_change_frequency_seconds;
         float weather_change_chance_percentage;
+        float prefetch_horizon_seconds;
+        float prefetch_margin;
+        float eviction_margin;
+        float generation_budget_milliseconds;
+        int shadow_cascades;
+        float shadow_distance;
+        float shadow_split_lambda;
+        int shadow_cascade_resolution;
+        bool cache_shadows; // Otherwise the static shadow casters are rendered into the shadow map every frame
+        bool background_generation; // Otherwise districts are built incrementally on the main thread
+        bool parallel_command_recording; // Otherwise the render passes are recorded on the main thread
         bool show_diagnostics;
         bool show_debug_bbs;
+        wfc::WfcSolver wfc_solver;
 
         Context(const std::function<void(bool)>& set_mouse_captured);
 
@@ -5,6 +5,7 @@
 #include "wfc/ground.h"
 #include "road.h"
 #include "vehicle.h"
+#include "gfx/instance_set.h"
 #include "utils/hash_utils.h"
 
 #include <vector>
@@ -42,6 +43,16 @@ namespace inf {
 
     };
 
+    // Directions of the roads on the borders of a district, so that the seams between districts do not need to search the roads
+    struct DistrictEdgeRoads {
+
+        std::vector<std::optional<RoadDirection>> first_column; // x = 0
+        std::vector<std::optional<RoadDirection>> last_column; // x = dimensions.x - 1
+        std::vector<std::optional<RoadDirection>> first_row; // y = 0
+        std::vector<std::optional<RoadDirection>> last_row; // y = dimensions.y - 1
+
+    };
+
     struct District {
     
         static constexpr int DISTRICT_SIZE = 100;
@@ -66,14 +77,18 @@ namespace inf {
 
         BoundingBox3D compute_bounding_box() const;
         const std::vector<DistrictLot>& get_lots() const;
-        const std::unordered_map<glm::ivec2, DistrictRoad>& get_roads() const;
-        std::unordered_map<glm::ivec2, const DistrictRoad*> get_roads_at_edges() const;
+        const RoadGrid& get_roads() const;
+        const DistrictEdgeRoads& get_edge_roads() const;
         const std::vector<Vehicle>& get_vehicles() const;
+        // Rough number of bytes held by the district on the CPU and the GPU, used to bound the district cache
+        std::size_t estimate_memory_usage() const;
         void add_lot(DistrictLot&& lot);
-        void add_road(DistrictRoad&& road);
+        void set_roads(RoadGrid&& roads);
         void add_vehicle(Vehicle&& vehicle);
 
         void render(gfx::Renderer& renderer);
+        // Unregisters the ground instances from the renderer, they are registered again when the district is rendered next time
+        void release_instance_sets();
 
         BoundingBox3D get_left_district_bb() const;
         BoundingBox3D get_right_district_bb() const;
@@ -101,12 +116,21 @@ namespace inf {
         glm::vec3 bb_color;
         BoundingBox3D bounding_box;
         std::vector<DistrictLot> lots;
-        std::unordered_map<glm::ivec2, DistrictRoad> roads;
+        RoadGrid roads;
+        DistrictEdgeRoads edge_roads;
         std::vector<Vehicle> vehicles;
         // Cache positions for instanced rendering
         InstanceData grass_instances;
         std::unordered_map<const gfx::Mesh*, InstanceData> road_instances;
         std::unordered_map<const wfc::GroundPattern*, InstanceData> foliage_instances;
+        // Handles of the cached ground instances in the renderer, empty if they are not registered
+        std::vector<gfx::InstanceSet> ground_instance_sets;
+        // Instances of building cells in visible lots, collected every frame
+        std::unordered_map<const gfx::Mesh*, std::vector<gfx::vk::BuildingInstance>> building_instances;
+        // Instances of building cells in lots outside of the camera frustum that can cast shadows into it
+        std::unordered_map<const gfx::Mesh*, std::vector<gfx::vk::BuildingInstance>> building_caster_instances;
+
+        void update_edge_roads();
 
     };
 
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "common.h"
+#include "district.h"
+#include "vehicle.h"
+#include "wfc/rule.h"
+#include "gfx/vk/device.h"
+#include "gfx/vk/memory_allocator.h"
+#include "utils/thread_pool.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+namespace inf {
+
+    enum class DistrictBuildStage {
+        PARTITION,
+        ROADS,
+        LOTS,
+        VEHICLES,
+        UPLOAD,
+        DONE
+    };
+
+    // Builds a district in small resumable steps, so that generation can be spread across frames or run on a worker.
+    // Every stage up to the upload only touches CPU-side data, the upload stage must be run on the main thread.
+    struct DistrictBuilder {
+
+        DistrictBuilder(
+            std::uint64_t world_seed,
+            const glm::ivec2& grid_position,
+            const glm::vec3& position,
+            wfc::WfcSolver wfc_solver,
+            const gfx::vk::LogicalDevice* device,
+            const gfx::vk::MemoryAllocator* allocator);
+
+        DistrictBuildStage get_stage() const;
+        const glm::ivec2& get_grid_position() const;
+
+        // Runs a single unit of work: partitioning, road post processing, one lot, placing the vehicles or uploading one vehicle
+        void step();
+        // Generates every remaining lot on the thread pool at once, stops early if the build gets cancelled
+        void generate_lots(utils::ThreadPool& thread_pool, const std::atomic<bool>& cancelled);
+        // Orders the remaining lots so that the ones nearest to the camera are generated first
+        void prioritize_lots(const glm::vec3& camera_position);
+        // Hands over the finished district, the build must be done
+        District finish();
+
+    private:
+
+        const gfx::vk::LogicalDevice* device;
+        const gfx::vk::MemoryAllocator* allocator;
+        glm::ivec2 grid_position;
+        glm::vec3 position;
+        wfc::WfcSolver wfc_solver;
+        DistrictBuildStage stage;
+        RandomGenerator district_rng;
+        District district;
+        std::vector<glm::ivec4> partitions;
+        RoadGrid roads;
+        // Every lot has its own random stream, so the result does not depend on the order the lots are generated in
+        std::vector<RandomGenerator> lot_rngs;
+        std::vector<std::optional<DistrictLot>> lots;
+        // Indices of the lots that are not generated yet, the next one to generate is at the back
+        std::vector<std::size_t> remaining_lots;
+        std::vector<VehicleGeometry> vehicles;
+        std::size_t num_uploaded_vehicles;
+
+        void partition();
+        void post_process_roads();
+        void generate_next_lot();
+        void finish_lots();
+        void place_vehicles();
+        void upload_next_vehicle();
+
+        static District create_district(RandomGenerator& rng, const glm::ivec2& grid_position);
+        static DistrictLot generate_lot(RandomGenerator& rng, const glm::ivec4& partition, wfc::WfcSolver wfc_solver);
+        static wfc::Building generate_building(
+            RandomGenerator& rng,
+            const wfc::BuildingPattern& pattern,
+            int max_width,
+            int max_depth,
+            wfc::WfcSolver wfc_solver);
+        static bool has_road_direction(const RoadGrid& roads, const glm::ivec2& position, RoadDirection direction);
+        static void set_road_directions_and_traversability(
+            RandomGenerator& rng,
+            RoadGrid& roads,
+            const std::vector<glm::ivec4>& non_edge_partitions);
+
+    };
+
+}
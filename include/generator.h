@@ -2,35 +2,88 @@
 
 #include "common.h"
 #include "world.h"
+#include "prefetcher.h"
+#include "district_builder.h"
 #include "gfx/renderer.h"
+#include "utils/thread_pool.h"
 
 #include <glm/vec2.hpp>
-#include <glm/vec4.hpp>
+#include <glm/vec3.hpp>
 
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
+#include <cstdint>
+#include <exception>
 #include <unordered_map>
+#include <condition_variable>
 
 namespace inf {
 
     struct WorldGenerator {
 
-        WorldGenerator(Context& context, RandomGenerator& random_engine, const gfx::Renderer& renderer);
+        WorldGenerator(
+            Context& context,
+            std::uint64_t world_seed,
+            RandomGenerator& random_engine,
+            const gfx::Renderer& renderer);
+        ~WorldGenerator();
+        WorldGenerator(const WorldGenerator&) = delete;
+        WorldGenerator& operator=(const WorldGenerator&) = delete;
 
         World generate_initial(const Timer& timer);
-        void populate_world(World& world);
+        // Requests the districts that are visible or predicted to become visible, cancels requests that are not expected
+        // to be visible anymore and advances the district builds on the main thread within the generation budget
+        void populate_world(World& world, float delta_time);
+        // Cancels every request and joins the generation worker, must be called before the ground patterns are deinitialized
+        void stop();
 
     private:
 
+        struct DistrictRequest {
+            glm::ivec2 grid_position;
+            glm::vec3 position;
+            wfc::WfcSolver wfc_solver;
+            float time_to_visible; // Requests that are expected to become visible sooner are generated first
+            std::shared_ptr<std::atomic<bool>> cancelled;
+        };
+
+        struct DistrictBuild {
+            std::shared_ptr<std::atomic<bool>> cancelled;
+            float time_to_visible;
+            DistrictBuilder builder;
+        };
+
         Context& context;
+        std::uint64_t world_seed;
         RandomGenerator& random_engine;
         const gfx::Renderer& renderer;
+        utils::ThreadPool thread_pool;
+        // Districts are placed relative to the initial district at grid position (0, 0)
+        DistrictGrid grid;
+        DistrictPrefetcher prefetcher;
+        // Cancellation flags of requests that have not been added to the world yet, only accessed by the main thread
+        std::unordered_map<glm::ivec2, std::shared_ptr<std::atomic<bool>>> requests;
+        // Builds advanced by the main thread, either from scratch or only their upload stage if the worker generated them
+        std::vector<DistrictBuild> builds;
+        // State shared with the generation worker
+        std::mutex worker_mutex;
+        std::condition_variable worker_condition;
+        std::deque<DistrictRequest> pending_requests;
+        std::vector<DistrictBuild> finished_builds;
+        std::exception_ptr worker_exception;
+        bool stopping;
+        std::thread worker;
 
-        District generate_district(const glm::ivec2& grid_position);
-        wfc::Building generate_building(const wfc::BuildingPattern& pattern, int max_width, int max_depth);
-        bool has_road_direction(const std::unordered_map<glm::ivec2, DistrictRoad>& roads, const glm::ivec2& position, RoadDirection direction);
-        void set_road_directions_and_traversability(
-            std::unordered_map<glm::ivec2, DistrictRoad>& roads,
-            const std::vector<glm::ivec4>& non_edge_partitions);
+        void run_worker();
+        void request_district(const glm::ivec2& grid_position, float time_to_visible);
+        void advance_builds(World& world);
+        DistrictBuilder create_builder(const DistrictRequest& request) const;
+        // Runs the build on the calling thread until it reaches the given stage, generating the lots on the thread pool
+        void build_until(DistrictBuilder& builder, DistrictBuildStage stage, const std::atomic<bool>& cancelled);
 
     };
 
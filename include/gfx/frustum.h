@@ -56,6 +56,12 @@ namespace inf::gfx {
 
         bool is_inside(const OrientedBoundingBox3D& obb) const;
 
+        // Extracts the planes of the frustum of a Vulkan (depth in [0, 1]) view projection matrix as (normal, distance) with
+        // normalized normals pointing inwards, in the order left, right, bottom, top, near, far
+        static std::array<glm::vec4, 6> extract_planes(const glm::mat4& matrix);
+        // Same test as the culling compute shader, kept on the CPU so that it can be tested
+        static bool is_sphere_inside(const std::array<glm::vec4, 6>& planes, const glm::vec3& center, float radius);
+
     private:
 
         static std::array<glm::vec3, 8> extract_points(const glm::mat4& matrix);
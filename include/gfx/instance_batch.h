@@ -0,0 +1,55 @@
+#pragma once
+
+#include "gfx/mesh.h"
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+namespace inf::gfx {
+
+    // Contiguous range of instances of a single mesh in an instance buffer, drawn with a single draw call
+    struct InstanceBatch {
+
+        const Mesh* mesh;
+        std::uint64_t offset; // In bytes
+        std::uint32_t num_instances;
+
+    };
+
+    // Groups entries with a `mesh` member by their mesh, the groups are ordered by the first appearance of their mesh
+    template<typename Entry>
+    std::vector<std::vector<const Entry*>> group_by_mesh(const std::vector<Entry>& entries) {
+        std::vector<std::vector<const Entry*>> result;
+        std::unordered_map<const Mesh*, std::size_t> group_indices;
+        for (const auto& entry : entries) {
+            const auto [it, inserted] = group_indices.emplace(entry.mesh, result.size());
+            if (inserted) {
+                result.emplace_back();
+            }
+            result[it->second].emplace_back(&entry);
+        }
+        return result;
+    }
+
+    // Appends the instances of every entry to data so that the instances of the same mesh are next to each other and
+    // returns one batch per mesh. append(entry, data) appends the instances of a single entry to data.
+    template<typename Instance, typename Entry, typename Append>
+    std::vector<InstanceBatch> batch_instances(const std::vector<Entry>& entries, std::vector<Instance>& data, Append&& append) {
+        std::vector<InstanceBatch> result;
+        for (const auto& group : group_by_mesh(entries)) {
+            const auto first_instance = data.size();
+            for (const auto entry : group) {
+                append(*entry, data);
+            }
+            if (data.size() > first_instance) {
+                result.emplace_back(InstanceBatch{
+                    group.front()->mesh,
+                    first_instance * sizeof(Instance),
+                    static_cast<std::uint32_t>(data.size() - first_instance) });
+            }
+        }
+        return result;
+    }
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace inf::gfx {
+
+    struct Renderer;
+
+    // Handle of instances registered in the renderer, which keeps them in GPU memory and draws them every frame
+    // until the handle is destroyed. Default constructed handles do not refer to any instances.
+    struct InstanceSet {
+
+        InstanceSet();
+        InstanceSet(Renderer* renderer, std::uint32_t id);
+        ~InstanceSet();
+        InstanceSet(const InstanceSet&) = delete;
+        InstanceSet& operator=(const InstanceSet&) = delete;
+        InstanceSet(InstanceSet&& other);
+        InstanceSet& operator=(InstanceSet&& other);
+
+        void update(const std::vector<glm::vec3>& positions, const std::vector<float>& rotations);
+
+    private:
+
+        Renderer* renderer;
+        std::uint32_t id;
+
+        void reset();
+
+    };
+
+}
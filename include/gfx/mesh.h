@@ -7,6 +7,9 @@
 #include <glm/vec3.hpp>
 #include <glm/matrix.hpp>
 
+#include <memory>
+#include <cstdint>
+
 namespace inf::gfx {
 
     struct Mesh {
@@ -16,9 +19,44 @@ namespace inf::gfx {
             std::size_t num_vertices,
             const glm::mat4& model_matrix,
             const BoundingBox3D& bounding_box);
+        // Indexed mesh, the indices are 32-bit
+        Mesh(
+            vk::MappedBuffer&& buffer,
+            vk::MappedBuffer&& index_buffer,
+            std::size_t num_vertices,
+            std::size_t num_indices,
+            const glm::mat4& model_matrix,
+            const BoundingBox3D& bounding_box);
+        // Mesh whose vertices are a range of a buffer shared with other meshes
+        Mesh(
+            std::shared_ptr<vk::MappedBuffer> buffer,
+            std::uint32_t first_vertex,
+            std::size_t num_vertices,
+            const glm::mat4& model_matrix,
+            const BoundingBox3D& bounding_box);
+        // Indexed mesh whose vertices and indices are ranges of buffers shared with other meshes. The indices are relative
+        // to the first vertex of the mesh.
+        Mesh(
+            std::shared_ptr<vk::MappedBuffer> buffer,
+            std::uint32_t first_vertex,
+            std::size_t num_vertices,
+            std::shared_ptr<vk::MappedBuffer> index_buffer,
+            std::uint32_t first_index,
+            std::size_t num_indices,
+            const glm::mat4& model_matrix,
+            const BoundingBox3D& bounding_box);
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+        Mesh(Mesh&&) = default;
+        Mesh& operator=(Mesh&&) = default;
 
         const vk::MappedBuffer& get_buffer() const;
+        std::uint32_t get_first_vertex() const;
         std::size_t get_number_of_vertices() const;
+        bool is_indexed() const;
+        const vk::MappedBuffer& get_index_buffer() const;
+        std::uint32_t get_first_index() const;
+        std::size_t get_number_of_indices() const;
         const glm::mat4& get_model_matrix() const;
         const BoundingBox3D& get_bounding_box_in_model_space() const;
 
@@ -26,8 +64,12 @@ namespace inf::gfx {
 
     private:
 
-        vk::MappedBuffer buffer;
+        std::shared_ptr<vk::MappedBuffer> buffer;
+        std::uint32_t first_vertex;
         std::size_t num_vertices;
+        std::shared_ptr<vk::MappedBuffer> index_buffer; // Null if the mesh is not indexed
+        std::uint32_t first_index;
+        std::size_t num_indices;
         glm::mat4 model_matrix;
         BoundingBox3D bounding_box;
 
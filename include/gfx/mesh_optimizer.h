@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+#include <unordered_map>
+
+namespace inf::gfx {
+
+    template<typename Vertex>
+    struct IndexedGeometry {
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+    };
+
+    // Turns the triangle soups of the assets into indexed triangle lists that are ordered for the post-transform vertex cache
+    struct MeshOptimizer {
+
+        static constexpr std::size_t VERTEX_CACHE_SIZE = 32;
+        static constexpr std::size_t OVERDRAW_CLUSTER_SIZE = 16; // In triangles
+
+        MeshOptimizer() = delete;
+
+        // Merges identical vertices of a triangle list, vertices are compared bitwise
+        template<typename Vertex>
+        static IndexedGeometry<Vertex> deduplicate(const std::vector<Vertex>& vertices) {
+            static_assert(std::is_trivially_copyable_v<Vertex>, "Vertices are compared and hashed by their bytes.");
+            IndexedGeometry<Vertex> result;
+            result.indices.reserve(vertices.size());
+            // Vertices are bucketed by the hash of their bytes, collisions are resolved by comparing the bytes
+            std::unordered_multimap<std::uint64_t, std::uint32_t> unique_indices;
+            for (const auto& vertex : vertices) {
+                const auto hash = hash_bytes(&vertex, sizeof(Vertex));
+                std::uint32_t index = static_cast<std::uint32_t>(result.vertices.size());
+                const auto [first, last] = unique_indices.equal_range(hash);
+                for (auto it = first; it != last; ++it) {
+                    if (std::memcmp(&result.vertices[it->second], &vertex, sizeof(Vertex)) == 0) {
+                        index = it->second;
+                        break;
+                    }
+                }
+                if (index == result.vertices.size()) {
+                    unique_indices.emplace(hash, index);
+                    result.vertices.emplace_back(vertex);
+                }
+                result.indices.emplace_back(index);
+            }
+            return result;
+        }
+
+        // Reorders the triangles so that consecutive triangles reuse the vertices of each other, see Tom Forsyth:
+        // Linear-Speed Vertex Cache Optimisation
+        static void optimize_vertex_cache(std::vector<std::uint32_t>& indices, std::size_t num_vertices);
+
+        // Reorders clusters of triangles so that the ones facing outwards are drawn first, which reduces overdraw from
+        // most view directions. Clusters are kept intact, so most of the vertex cache locality is kept as well.
+        template<typename Vertex>
+        static void optimize_overdraw(const std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+            std::vector<glm::vec3> positions;
+            positions.reserve(vertices.size());
+            for (const auto& vertex : vertices) {
+                positions.emplace_back(vertex.position);
+            }
+            reorder_clusters(positions, indices);
+        }
+
+        // Reorders the vertices by their first use, so that the vertex fetches are mostly sequential
+        template<typename Vertex>
+        static void optimize_vertex_fetch(IndexedGeometry<Vertex>& geometry) {
+            const auto remap = compute_fetch_remap(geometry.indices, geometry.vertices.size());
+            std::vector<Vertex> vertices;
+            vertices.reserve(geometry.vertices.size());
+            for (auto& index : geometry.indices) {
+                if (remap[index] == vertices.size()) {
+                    vertices.emplace_back(geometry.vertices[index]);
+                }
+                index = remap[index];
+            }
+            geometry.vertices = std::move(vertices);
+        }
+
+        // Runs every optimization on a triangle soup
+        template<typename Vertex>
+        static IndexedGeometry<Vertex> optimize(const std::vector<Vertex>& vertices) {
+            auto result = deduplicate(vertices);
+            optimize_vertex_cache(result.indices, result.vertices.size());
+            optimize_overdraw(result.vertices, result.indices);
+            optimize_vertex_fetch(result);
+            return result;
+        }
+
+        // Average cache miss ratio: the number of vertex shader invocations per triangle with a FIFO vertex cache
+        static float compute_acmr(const std::vector<std::uint32_t>& indices, std::size_t cache_size);
+
+    private:
+
+        static std::uint64_t hash_bytes(const void* data, std::size_t size);
+        static void reorder_clusters(const std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices);
+        // New index of every vertex in the order of their first use, vertices that are not referenced are dropped
+        static std::vector<std::uint32_t> compute_fetch_remap(const std::vector<std::uint32_t>& indices, std::size_t num_vertices);
+
+    };
+
+}
@@ -17,25 +17,41 @@
 #include "gfx/vk/semaphore.h"
 #include "gfx/vk/descriptor.h"
 #include "gfx/vk/buffer.h"
+#include "gfx/vk/ring_buffer.h"
 #include "gfx/vk/depth_buffer.h"
 #include "gfx/vk/sampler.h"
 #include "gfx/vk/memory_allocator.h"
+#include "gfx/vk/vertex.h"
 #include "gfx/mesh.h"
+#include "gfx/instance_set.h"
+#include "gfx/instance_batch.h"
+#include "gfx/shadow_cascades.h"
 #include "bounding_box.h"
 #include "frustum.h"
+#include "utils/lru_cache.h"
+#include "utils/thread_pool.h"
 
+#include <map>
+#include <array>
 #include <memory>
 #include <vector>
 #include <cstdint>
+#include <utility>
+#include <functional>
+#include <unordered_map>
 
 namespace inf::gfx {
 
+    static_assert(ShadowCascades::MAX_CASCADES == 4, "The split distances of the cascades are uploaded as a vec4.");
+
     struct Matrices {
         glm::mat4 projection_matrix;
         glm::mat4 view_matrix;
-        glm::mat4 light_space_matrix;
+        std::array<glm::mat4, ShadowCascades::MAX_CASCADES> light_space_matrices;
+        glm::vec4 cascade_split_distances; // Far distance of every cascade from the camera
         glm::vec3 light_direction;
         float ambient_light;
+        std::uint32_t num_shadow_cascades;
     };
 
     struct PushConstants {
@@ -43,6 +59,15 @@ namespace inf::gfx {
         std::int32_t debug_bb; // Boolean, but GLSL bools are 4 bytes
     };
 
+    struct CullingPushConstants {
+        std::array<glm::vec4, 6> frustum_planes;
+        std::uint32_t first_instance;
+        std::uint32_t num_instances;
+        std::uint32_t first_visible_instance;
+        std::uint32_t draw_command_index;
+        float radius;
+    };
+
     struct ParticleMatrices {
         glm::mat4 projection_matrix;
         glm::mat4 view_matrix;
@@ -65,15 +90,34 @@ namespace inf::gfx {
         const vk::LogicalDevice& get_logical_device() const;
         const vk::MemoryAllocator& get_memory_allocator() const;
 
+        // Uploads the colors that building instances look up by their palette index, buildings are only rendered once this is set
+        void set_building_palette(const std::vector<glm::vec4>& palette);
+
         void begin_frame(
             Weather world_weather,
             RainIntensity world_rain_intensity,
             std::size_t num_districts,
-            std::size_t num_buildings);
+            std::size_t num_buildings,
+            const utils::CacheStatistics& district_cache_statistics);
+        // Retained instances are uploaded once and drawn every frame until the returned handle is destroyed,
+        // so instances that rarely change do not have to be submitted every frame
+        InstanceSet create_instance_set(
+            const Mesh& mesh,
+            bool shadow_caster,
+            const std::vector<glm::vec3>& positions,
+            const std::vector<float>& rotations);
+        void update_instance_set(std::uint32_t id, const std::vector<glm::vec3>& positions, const std::vector<float>& rotations);
+        void destroy_instance_set(std::uint32_t id);
+
+        // Meshes are drawn into the shadow map as well if they are inside of the shadow caster volume
         void render(const Mesh& mesh);
+        // Only draws the mesh into the shadow map, for meshes outside of the camera frustum that can still cast shadows into it
+        void render_shadow_caster(const Mesh& mesh);
         void render_instanced(const Mesh& mesh, const std::vector<glm::vec3>& positions, const std::vector<float>& rotations);
         void render_instanced_caster(const Mesh& mesh, const std::vector<glm::vec3>& positions, const std::vector<float>& rotations);
         void render_particles(const Mesh& mesh, const std::vector<glm::vec3>& positions);
+        void render_building_instances(const Mesh& mesh, const std::vector<vk::BuildingInstance>& instances);
+        void render_building_shadow_casters(const Mesh& mesh, const std::vector<vk::BuildingInstance>& instances);
         void render(const BoundingBox3D& bounding_box, const glm::vec3& color);
         void end_frame();
 
@@ -81,6 +125,8 @@ namespace inf::gfx {
         glm::mat4 get_view_matrix() const;
         Frustum get_frustum_in_view_space() const;
         Frustum get_frustum_in_world_space() const;
+        // Volume of the potential shadow casters of the frame, only valid after the frame has begun
+        const ShadowCasterVolume& get_shadow_caster_volume() const;
 
         void destroy_imgui();
 
@@ -92,11 +138,82 @@ namespace inf::gfx {
             const std::vector<float>& rotations;
         };
 
+        struct BuildingMeshToRender {
+            const Mesh* mesh;
+            const std::vector<vk::BuildingInstance>& instances;
+        };
+
+        struct ShadowCasterToRender {
+            const Mesh* mesh;
+            glm::vec3 center; // Of the bounding sphere in world space
+            float radius;
+        };
+
         struct ParticlesToRender {
             const Mesh* mesh;
             const std::vector<glm::vec3>& positions;
         };
 
+        // Instance data and draw commands of building batches, uploaded into the instance data ring
+        struct BuildingDraws {
+            std::vector<InstanceBatch> batches;
+            std::vector<VkDrawIndexedIndirectCommand> draw_commands;
+            vk::RingBufferAllocation instances;
+            vk::RingBufferAllocation draw_commands_allocation;
+        };
+
+        // Shadow casters of individual meshes and of per-frame instance streams, retained instances are culled on the GPU
+        struct ShadowCasterStatistics {
+            std::uint32_t drawn;
+            std::uint32_t culled;
+        };
+
+        // Records a part of a render pass into a secondary command buffer, the jobs of a frame are recorded in parallel.
+        // Everything a job reads has to be uploaded before the recording begins.
+        struct RecordingJob {
+            const vk::RenderPass* render_pass;
+            const vk::Framebuffer* framebuffer;
+            std::function<std::uint32_t(VkCommandBuffer)> record; // Returns the number of draw calls recorded
+        };
+
+        struct RecordedJobs {
+            std::vector<VkCommandBuffer> command_buffers; // In the order of the jobs
+            std::vector<std::uint32_t> num_draw_calls;
+        };
+
+        // Every job has its own command pool, so no two threads ever record into the same pool regardless of which
+        // worker picks up which job
+        struct RecordingContext {
+            vk::CommandPool command_pool;
+            vk::CommandBuffer command_buffer;
+        };
+
+        // Instance sets are keyed by their mesh and whether they cast shadows
+        using RetainedInstancesKey = std::pair<const Mesh*, bool>;
+
+        // The instance sets of the same key are concatenated into a single range of the retained instance data, so they are
+        // culled by a single dispatch and drawn with a single indirect draw call per pass
+        struct RetainedInstances {
+            std::map<std::uint32_t, std::vector<glm::vec4>> sets;
+            float radius; // Of the bounding sphere of the mesh around the instance position, which is independent of the rotation
+            std::uint32_t first_instance;
+            std::uint32_t num_instances;
+            std::uint32_t draw_command_index;
+        };
+
+        // Every frame in flight has its own copy of the culling buffers, the instances are only uploaded after they changed.
+        // The culling shader writes the visible instances of the color pass followed by those of every shadow cascade, and
+        // counts them in the draw commands, which are laid out the same way.
+        struct CullingBuffers {
+            std::unique_ptr<vk::MappedBuffer> instances;
+            std::unique_ptr<vk::MappedBuffer> visible_instances;
+            std::unique_ptr<vk::MappedBuffer> draw_commands;
+            std::size_t instance_capacity;
+            std::size_t draw_command_capacity;
+            std::uint64_t uploaded_version;
+            VkDescriptorSet descriptor_set;
+        };
+
         Context& context;
         const Camera& camera;
         const Timer& timer;
@@ -113,35 +230,49 @@ namespace inf::gfx {
 
         // Shaders and descriptor sets
         std::vector<vk::Shader> shaders;
+        std::vector<vk::Shader> bounding_box_shaders;
         std::vector<vk::Shader> instanced_shaders;
         std::vector<vk::Shader> shadow_map_shaders;
         std::vector<vk::Shader> shadow_map_instanced_shaders;
+        std::vector<vk::Shader> building_shaders;
         std::vector<vk::Shader> particle_shaders;
+        std::unique_ptr<vk::Shader> culling_shader;
         std::unique_ptr<vk::DescriptorPool> descriptor_pool;
         std::unique_ptr<vk::DescriptorSetLayout> descriptor_set_layout;
         std::unique_ptr<vk::DescriptorSetLayout> instanced_descriptor_set_layout;
         std::unique_ptr<vk::DescriptorSetLayout> shadow_map_descriptor_set_layout;
         std::unique_ptr<vk::DescriptorSetLayout> particle_descriptor_set_layout;
+        std::unique_ptr<vk::DescriptorSetLayout> building_descriptor_set_layout;
+        std::unique_ptr<vk::DescriptorSetLayout> culling_descriptor_set_layout;
         std::vector<VkDescriptorSet> descriptor_sets;
-        std::vector<VkDescriptorSet> shadow_map_descriptor_sets;
+        std::vector<VkDescriptorSet> shadow_map_descriptor_sets; // One for every cascade of every frame in flight
         std::vector<VkDescriptorSet> particle_descriptor_sets;
+        std::vector<VkDescriptorSet> building_descriptor_sets;
 
         // Render passes and pipelines
         std::unique_ptr<vk::RenderPass> render_pass;
         std::unique_ptr<vk::RenderPass> shadow_map_render_pass;
+        std::unique_ptr<vk::RenderPass> shadow_map_preserving_render_pass; // Draws on top of the contents of a shadow map
         std::unique_ptr<vk::Pipeline> pipeline;
+        std::unique_ptr<vk::Pipeline> bounding_box_pipeline;
         std::unique_ptr<vk::Pipeline> instanced_pipeline;
         std::unique_ptr<vk::Pipeline> shadow_map_pipeline;
         std::unique_ptr<vk::Pipeline> shadow_map_instanced_pipeline;
         std::unique_ptr<vk::Pipeline> particle_pipeline;
+        std::unique_ptr<vk::Pipeline> building_pipeline;
+        std::unique_ptr<vk::Pipeline> shadow_map_building_pipeline;
+        std::unique_ptr<vk::Pipeline> culling_pipeline;
 
         // Images, frame buffers, samplers
         std::unique_ptr<vk::Image> color_image;
         std::unique_ptr<vk::ImageView> color_image_view;
         std::unique_ptr<vk::DepthBuffer> depth_buffer;
+        std::uint32_t shadow_cascade_resolution; // Of the shadow maps, which are recreated once it changed in the context
         std::unique_ptr<vk::DepthBuffer> shadow_map_depth_buffer;
+        std::unique_ptr<vk::DepthBuffer> static_shadow_map_depth_buffer; // Cached shadow map atlas of the static casters
         std::vector<vk::Framebuffer> framebuffers;
         std::unique_ptr<vk::Framebuffer> shadow_map_framebuffer;
+        std::unique_ptr<vk::Framebuffer> static_shadow_map_framebuffer;
         std::unique_ptr<vk::Sampler> shadow_map_sampler;
 
         // Command pools, semaphores and fences
@@ -150,26 +281,120 @@ namespace inf::gfx {
         std::vector<vk::Semaphore> image_available_semaphores;
         std::vector<vk::Semaphore> render_finished_semaphores;
         std::vector<vk::Fence> in_flight_fences;
+        std::vector<std::vector<RecordingContext>> recording_contexts; // Of every frame in flight, one for every job
+        utils::ThreadPool recording_thread_pool;
 
         // Uniform buffers
         std::vector<vk::MappedBuffer> uniform_buffers;
-        std::vector<vk::MappedBuffer> shadow_map_uniform_buffers;
+        std::vector<vk::MappedBuffer> shadow_map_uniform_buffers; // One for every cascade of every frame in flight
         std::vector<vk::MappedBuffer> particle_uniform_buffers;
+        std::unique_ptr<vk::MappedBuffer> building_palette_buffer;
 
         // Projection matrices
         glm::mat4 projection_matrix;
 
+        // Shadows of the current frame, updated when the frame begins
+        glm::vec3 light_direction;
+        std::vector<ShadowCascade> shadow_cascades;
+        ShadowCasterVolume shadow_caster_volume;
+
+        // When shadows are cached the static casters are only rendered into the static shadow map after a cascade moved,
+        // the light moved or the retained instances changed. It is copied into the shadow map of every frame, and only
+        // the dynamic casters are drawn on top of it.
+        glm::vec3 static_light_direction; // Of the cached cascades
+        std::array<bool, ShadowCascades::MAX_CASCADES> static_cascades_dirty;
+        std::uint64_t static_retained_version; // Of the retained instances in the static shadow map
+
         // Mesh data
-        std::vector<const Mesh*> shadow_casters_to_render;
+        std::vector<const Mesh*> meshes_to_render;
+        std::vector<ShadowCasterToRender> shadow_casters_to_render;
         std::vector<InstancedMeshToRender> instanced_non_casters_to_render;
         std::vector<InstancedMeshToRender> instanced_casters_to_render;
         std::vector<ParticlesToRender> particles_to_render;
+        std::vector<BuildingMeshToRender> buildings_to_render;
+        std::vector<BuildingMeshToRender> building_casters_to_render; // Of lots outside of the camera frustum
         std::vector<gfx::vk::MappedBuffer> bounding_boxes_to_render;
-        std::vector<gfx::vk::MappedBuffer> instanced_data_buffers;
-        std::vector<gfx::vk::MappedBuffer> instanced_shadow_data_buffers;
-        std::vector<gfx::vk::MappedBuffer> particle_data_buffers;
+        std::unique_ptr<vk::RingBuffer> instance_data_ring;
+
+        // Retained instance data
+        std::map<RetainedInstancesKey, RetainedInstances> retained_instances;
+        std::unordered_map<std::uint32_t, RetainedInstancesKey> instance_set_keys;
+        std::uint32_t next_instance_set_id;
+        std::vector<glm::vec4> retained_data;
+        bool retained_dirty;
+        std::uint64_t retained_version;
+        std::vector<CullingBuffers> culling_buffers;
+
+        // Number of draw calls recorded for the previous frame, displayed in the diagnostics
+        std::uint32_t num_shadow_draw_calls;
+        std::uint32_t num_color_draw_calls;
+        ShadowCasterStatistics shadow_caster_statistics; // Of the frame being recorded
+        ShadowCasterStatistics previous_shadow_caster_statistics;
+        std::uint32_t num_static_cascades_rendered; // Re-rendered into the static shadow map in the previous frame
 
         void init_imgui(const Window& window, VkSampleCountFlagBits sample_count);
+        // Creates the shadow map atlases and their framebuffers with the current cascade resolution
+        void create_shadow_maps();
+        // Points the shadow map samplers of the color and the building descriptor sets to the current shadow map
+        void update_shadow_map_descriptor_sets();
+        // Fits the shadow cascades and the shadow caster volume to the camera and the current position of the sun. Cached
+        // cascades are only fit again once they do not cover their slice anymore or the sun moved too far.
+        void update_shadows();
+
+        // Uploads the instances of the entries, shadow casters are culled against the shadow caster volume one by one
+        BuildingDraws upload_building_instances(const std::vector<BuildingMeshToRender>& entries, bool shadow_casters_only);
+
+        void upload_retained_instances();
+        // Culls the retained instances against the camera frustum, and the shadow casters against the volume of every cascade
+        // as well. Has to be recorded outside of render passes, before the retained instances are rendered.
+        void cull_retained_instances(
+            VkCommandBuffer command_buffer,
+            const glm::mat4& view_projection_matrix,
+            const std::vector<ShadowCascade>& cascades) const;
+        // Pass 0 is the color pass, pass 1 + i renders the shadow casters into cascade i. Returns the number of draw calls recorded.
+        std::uint32_t render_retained_instances(VkCommandBuffer command_buffer, std::size_t pass) const;
+        // Static casters are the retained instances and the buildings, they only change as districts are loaded and evicted.
+        // The shadow map pass of the cascade has to be bound already, returns the number of draw calls recorded.
+        std::uint32_t render_static_shadow_casters(
+            VkCommandBuffer command_buffer,
+            std::size_t cascade,
+            const BuildingDraws& building_draws) const;
+        // Dynamic casters are the individual meshes and the instances submitted every frame, such as the vehicles
+        std::uint32_t render_dynamic_shadow_casters(
+            VkCommandBuffer command_buffer,
+            std::size_t cascade,
+            const std::vector<InstanceBatch>& caster_batches,
+            const vk::RingBufferAllocation& caster_allocation) const;
+        // Records the jobs into secondary command buffers of the current frame, in parallel unless disabled in the context
+        RecordedJobs record_jobs(const std::vector<RecordingJob>& jobs);
+        // Copies the tiles of the cascades from the static shadow map into the shadow map sampled by the color pass
+        void copy_static_shadow_map(VkCommandBuffer command_buffer) const;
+        // Draws the batches with a single multi-draw indirect call per vertex buffer if the device supports it,
+        // returns the number of draw calls recorded
+        std::uint32_t render_building_batches(VkCommandBuffer command_buffer, const BuildingDraws& draws) const;
+
+        // Extent of the shadow map atlas that has a tile for every cascade
+        VkExtent2D get_shadow_map_extent() const;
+        // Tile of the cascade in the shadow map atlas
+        VkRect2D get_shadow_cascade_tile(std::size_t cascade) const;
+        // Restricts the viewport and the scissor to the tile of the cascade
+        void set_shadow_cascade_viewport(VkCommandBuffer command_buffer, std::size_t cascade) const;
+        // Records an indexed draw for indexed meshes and a non-indexed one otherwise, vertex buffers have to be bound already
+        static void draw_mesh(VkCommandBuffer command_buffer, const Mesh& mesh, std::uint32_t num_instances, std::uint32_t first_instance = 0);
+        static void draw_indirect(
+            VkCommandBuffer command_buffer,
+            const Mesh& mesh,
+            VkBuffer draw_commands,
+            VkDeviceSize offset,
+            std::uint32_t num_draw_commands);
+        // Indirect draw commands of every mesh have the size of indexed draw commands, so indexed and non-indexed meshes
+        // can share the draw command buffers
+        static VkDrawIndexedIndirectCommand create_draw_command(const Mesh& mesh, std::uint32_t num_instances, std::uint32_t first_instance);
+
+        // Radius of the bounding sphere of the mesh around the instance position, which is independent of the rotation
+        static float compute_instance_radius(const Mesh& mesh);
+        static void append_instances(const InstancedMeshToRender& entry, std::vector<glm::vec4>& data);
+        static std::vector<glm::vec4> interleave_instances(const std::vector<glm::vec3>& positions, const std::vector<float>& rotations);
 
     };
 
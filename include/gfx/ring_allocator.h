@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace inf::gfx {
+
+    struct RingStatistics {
+
+        std::uint64_t capacity; // In bytes
+        std::uint64_t used; // Bytes held by the frames in flight, including alignment padding
+        std::uint64_t high_water_mark; // Highest number of used bytes so far
+
+    };
+
+    // Sub-allocates ranges of a buffer shared by the frames in flight. Allocations are made in a ring, and all of
+    // the allocations of a frame are released at once when the frame is recorded again. Frames have to be begun
+    // in a cyclic order, which is what the renderer does with its frame index.
+    struct RingAllocator {
+
+        RingAllocator(std::uint64_t capacity, std::size_t num_frames);
+
+        // Releases the allocations the frame made the last time it was recorded, the GPU must be done with them
+        void begin_frame(std::size_t frame);
+        // Returns the offset of the allocation or an empty optional if it does not fit into the free space
+        std::optional<std::uint64_t> allocate(std::uint64_t size, std::uint64_t alignment);
+        // Drops every allocation and changes the capacity, used when the buffer behind the allocator is replaced
+        void reset(std::uint64_t capacity);
+
+        RingStatistics get_statistics() const;
+
+    private:
+
+        struct FrameAllocations {
+            std::uint64_t end; // Position of the head after the last allocation of the frame
+            std::uint64_t size;
+        };
+
+        std::uint64_t capacity;
+        std::uint64_t head;
+        std::uint64_t tail;
+        std::uint64_t used;
+        std::uint64_t high_water_mark;
+        std::size_t current_frame;
+        std::vector<FrameAllocations> frames;
+
+    };
+
+}
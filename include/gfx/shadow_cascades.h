@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glm/matrix.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace inf::gfx {
+
+    struct ShadowCascade {
+
+        glm::mat4 view_matrix; // Of the light
+        glm::mat4 projection_matrix;
+        float near_distance; // Distance of the slice of the camera frustum covered by the cascade from the camera
+        float far_distance;
+
+        glm::mat4 get_light_space_matrix() const;
+
+    };
+
+    // Splits the camera frustum into slices along the view direction and fits a shadow map to every slice, so nearby
+    // shadows get more texels than distant ones. See GPU Gems 3: Parallel-Split Shadow Maps on Programmable GPUs.
+    struct ShadowCascades {
+
+        static constexpr std::size_t MAX_CASCADES = 4;
+        // Cascades are rendered into the tiles of a single shadow map atlas, row by row
+        static constexpr std::size_t ATLAS_COLUMNS = 2;
+        static constexpr std::size_t ATLAS_ROWS = (MAX_CASCADES + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+
+        ShadowCascades() = delete;
+
+        // Returns the count + 1 boundaries of the slices between near and far. Lambda blends between a uniform (0) and a
+        // logarithmic (1) distribution of the slices.
+        static std::vector<float> compute_split_distances(float near, float far, std::size_t count, float lambda);
+
+        // Fits an orthographic projection to the bounding sphere of a slice of the camera frustum, so the size of the
+        // projection does not change as the camera rotates. The projection is snapped to the texels of the shadow map,
+        // so the shadows do not shimmer as the camera moves. Casters are included up to caster_distance towards the light.
+        // The radius of the sphere is enlarged by margin times itself, so a cached cascade keeps covering the slice for a while.
+        static ShadowCascade fit(
+            const glm::mat4& view_matrix,
+            float fovy,
+            float aspect,
+            float near,
+            float far,
+            const glm::vec3& light_direction,
+            float caster_distance,
+            float margin,
+            std::uint32_t resolution);
+
+        // Returns whether the cascade still covers the slice of the camera frustum, so its shadow map can be reused
+        static bool covers(
+            const ShadowCascade& cascade,
+            const glm::mat4& view_matrix,
+            float fovy,
+            float aspect,
+            float near,
+            float far);
+
+    };
+
+    // Culling volume of the shadow casters of a directional light: a slice of the camera frustum extruded towards the light.
+    // Nothing outside of it can cast a shadow into the slice. A default constructed volume contains everything.
+    struct ShadowCasterVolume {
+
+        ShadowCasterVolume() = default;
+        ShadowCasterVolume(
+            const glm::mat4& view_matrix,
+            float fovy,
+            float aspect,
+            float near,
+            float far,
+            const glm::vec3& light_direction);
+        // Union of the volumes covered by the cascades, for casters that are drawn into cached cascades which have to
+        // cover every slice they are reused for rather than only the current one
+        explicit ShadowCasterVolume(const std::vector<ShadowCascade>& cascades);
+
+        bool is_sphere_inside(const glm::vec3& center, float radius) const;
+
+    private:
+
+        // Convex volumes as planes of (normal, distance) with normals pointing inwards, the volume is their union
+        std::vector<std::vector<glm::vec4>> convex_volumes;
+
+    };
+
+}
@@ -9,7 +9,14 @@ namespace inf::gfx::vk {
 
     enum class BufferType {
         UNIFORM_BUFFER = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VERTEX_BUFFER = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+        VERTEX_BUFFER = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        INDEX_BUFFER = VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        STORAGE_BUFFER = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        // Written by compute shaders and consumed as vertex input or draw parameters
+        STORAGE_VERTEX_BUFFER = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        STORAGE_INDIRECT_BUFFER = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        // Per-frame instance data together with the draw commands that reference it
+        VERTEX_INDIRECT_BUFFER = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
     };
 
     struct MappedBuffer {
@@ -34,7 +41,9 @@ namespace inf::gfx::vk {
 
         VkBuffer get_buffer() const;
 
-        void upload(const void* data, std::size_t size) const;
+        std::uint64_t get_size() const;
+
+        void upload(const void* data, std::size_t size, std::uint64_t offset = 0) const;
 
     private:
 
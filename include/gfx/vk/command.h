@@ -5,8 +5,14 @@
 
 #include <glad/vulkan.h>
 
+#include <vector>
+
 namespace inf::gfx::vk {
 
+    // We need to forward declare here to avoid cyclic dependencies
+    struct RenderPass;
+    struct Framebuffer;
+
     struct CommandBuffer {
 
         CommandBuffer(const VkCommandBuffer& command_buffer);
@@ -15,7 +21,11 @@ namespace inf::gfx::vk {
 
         void reset() const;
         void begin() const;
+        // Begins a secondary command buffer that records commands into subpass 0 of the render pass
+        void begin(const RenderPass& render_pass, const Framebuffer& framebuffer) const;
         void end() const;
+        // Executes secondary command buffers, the render pass has to be begun with secondary command buffer contents
+        void execute(const std::vector<VkCommandBuffer>& secondary_command_buffers) const;
         void submit(
             VkQueue queue,
             const Semaphore& wait_semaphore,
@@ -43,12 +53,17 @@ namespace inf::gfx::vk {
 
         VkCommandPool get_command_pool() const;
         CommandBuffer allocate_buffer() const;
+        CommandBuffer allocate_secondary_buffer() const;
+        // Resets every command buffer allocated from the pool at once
+        void reset() const;
 
     private:
 
         const LogicalDevice* device;
         VkCommandPool command_pool;
 
+        CommandBuffer allocate_buffer(VkCommandBufferLevel level) const;
+
     };
 
 }
\ No newline at end of file
@@ -12,7 +12,8 @@ namespace inf::gfx::vk {
             const MemoryAllocator* allocator,
             const VkExtent2D& extent,
             VkSampleCountFlagBits samples,
-            bool is_sampled);
+            bool is_sampled,
+            VkImageUsageFlags additional_usage = 0); // E.g. for copying between depth buffers
 
         DepthBuffer(Image&& image, ImageView&& image_view);
 
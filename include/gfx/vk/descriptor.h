@@ -63,6 +63,10 @@ namespace inf::gfx::vk {
             const VkDescriptorBufferInfo& buffer_info,
             std::uint32_t binding);
 
+        static VkWriteDescriptorSet create_for_storage_buffer(
+            const VkDescriptorBufferInfo& buffer_info,
+            std::uint32_t binding);
+
         static VkWriteDescriptorSet create_for_sampler(
             const VkDescriptorImageInfo& image_info,
             std::uint32_t binding);
@@ -81,11 +81,14 @@ namespace inf::gfx::vk {
         SwapChainSupport query_swap_chain_support(const Surface& surface) const;
 
         bool is_sample_count_supported(VkSampleCountFlagBits sample_count_bits) const;
+        // Whether several indirect draws with non-zero first instances can be recorded with a single command
+        bool is_multi_draw_indirect_supported() const;
 
     private:
 
         VkPhysicalDevice device;
         VkPhysicalDeviceProperties properties;
+        VkPhysicalDeviceFeatures features;
         bool supports_required_extensions;
         QueueFamilyIndices queue_family_indices;
 
@@ -20,7 +20,8 @@ namespace inf::gfx::vk {
             const LogicalDevice* device,
             VkFormat swap_chain_format,
             VkSampleCountFlagBits samples);
-        static RenderPass create_shadow_render_pass(const LogicalDevice* device);
+        // Render passes that preserve the contents draw on top of a shadow map in the depth stencil read only layout
+        static RenderPass create_shadow_render_pass(const LogicalDevice* device, bool preserve_contents);
 
         RenderPass(const LogicalDevice* device, const VkRenderPass& render_pass);
         ~RenderPass();
@@ -31,11 +32,13 @@ namespace inf::gfx::vk {
 
         VkRenderPass get_render_pass() const;
 
+        // The contents of the render pass are either recorded inline or executed from secondary command buffers
         void begin(
             const Framebuffer& framebuffer,
             const VkExtent2D& swap_chain_extent,
             const CommandBuffer& command_buffer,
-            const std::vector<VkClearValue>& clear_values) const;
+            const std::vector<VkClearValue>& clear_values,
+            VkSubpassContents contents) const;
         void end(const CommandBuffer& command_buffer) const;
 
     private:
@@ -64,6 +67,11 @@ namespace inf::gfx::vk {
             const VkVertexInputAttributeDescription* attribute_descriptions,
             VkSampleCountFlagBits samples,
             const std::optional<PipelineDepthBias>& depth_bias);
+        static Pipeline create_compute_pipeline(
+            const LogicalDevice* device,
+            const DescriptorSetLayout& descriptor_set_layout,
+            const Shader& shader,
+            std::uint32_t push_constants_size);
         
         Pipeline(const LogicalDevice* device, const VkPipelineLayout& layout, const VkPipeline& pipeline);
         ~Pipeline();
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "gfx/vk/buffer.h"
+#include "gfx/vk/device.h"
+#include "gfx/vk/memory_allocator.h"
+#include "gfx/ring_allocator.h"
+
+#include <glad/vulkan.h>
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace inf::gfx::vk {
+
+    struct RingBufferAllocation {
+
+        VkBuffer buffer;
+        std::uint64_t offset;
+
+    };
+
+    // Mapped buffer shared by the frames in flight through a ring allocator. When an allocation does not fit, the ring
+    // moves to a larger buffer and the previous one is kept alive until every frame that might still use it retires.
+    struct RingBuffer {
+
+        RingBuffer(
+            const LogicalDevice* device,
+            const MemoryAllocator* allocator,
+            BufferType type,
+            std::uint64_t initial_capacity,
+            std::size_t num_frames);
+
+        // Has to be called after the fence of the frame has been waited on
+        void begin_frame(std::size_t frame);
+        RingBufferAllocation upload(const void* data, std::uint64_t size, std::uint64_t alignment);
+
+        RingStatistics get_statistics() const;
+
+    private:
+
+        struct RetiredBuffer {
+            std::unique_ptr<MappedBuffer> buffer;
+            std::size_t remaining_frames;
+        };
+
+        const LogicalDevice* device;
+        const MemoryAllocator* allocator;
+        BufferType type;
+        std::size_t num_frames;
+        std::unique_ptr<MappedBuffer> buffer;
+        RingAllocator ring;
+        std::vector<RetiredBuffer> retired_buffers;
+
+    };
+
+}
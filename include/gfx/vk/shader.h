@@ -10,7 +10,8 @@ namespace inf::gfx::vk {
 
     enum class ShaderType {
         VERTEX = VK_SHADER_STAGE_VERTEX_BIT,
-        FRAGMENT = VK_SHADER_STAGE_FRAGMENT_BIT
+        FRAGMENT = VK_SHADER_STAGE_FRAGMENT_BIT,
+        COMPUTE = VK_SHADER_STAGE_COMPUTE_BIT
     };
 
     struct Shader {
@@ -1,30 +1,39 @@
 #pragma once
 
 #include "bounding_box.h"
+#include "utils/symbol_table.h"
 
 #include <glm/vec3.hpp>
 #include <glad/vulkan.h>
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace inf::gfx::vk {
 
     // This is an intermediate structure that is "almost a vertex". It's material data needs to be filled out
-    // from the chosen material for the given material name of the building that the vertex belongs to.
-    struct VertexWithMaterialName {
+    // from the chosen material for the given material of the building that the vertex belongs to.
+    struct VertexWithMaterial {
 
         glm::vec3 position;
         glm::vec3 normal;
-        std::string material_name;
+        utils::SymbolId material; // Interned material name
 
-        VertexWithMaterialName(const glm::vec3& position, const glm::vec3& normal, const std::string& material_name);
+        VertexWithMaterial(const glm::vec3& position, const glm::vec3& normal, utils::SymbolId material);
 
-        static std::vector<VertexWithMaterialName> from_bytes(const std::string& bytes);
+        static std::vector<VertexWithMaterial> from_bytes(const std::string& bytes);
 
     };
 
+    // Per-instance data of building cells. The palette is the index of the first color of the building's palette.
+    struct BuildingInstance {
+        glm::vec3 position;
+        float rotation;
+        std::uint32_t palette;
+    };
+
     struct Vertex {
 
         glm::vec3 position;
@@ -32,15 +41,47 @@ namespace inf::gfx::vk {
         glm::vec3 color;
 
         Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& color);
-        Vertex(const VertexWithMaterialName& other, const glm::vec3& color);
+        Vertex(const VertexWithMaterial& other, const glm::vec3& color);
 
         static VkVertexInputBindingDescription get_default_binding_description();
         static std::array<VkVertexInputAttributeDescription, 3> get_default_attribute_descriptions();
-        static std::array<VkVertexInputBindingDescription, 2> get_instanced_binding_descriptions();
-        static std::array<VkVertexInputAttributeDescription, 5> get_instanced_attribute_descriptions();
         static std::vector<Vertex> from_bytes(const std::string& bytes);
         static BoundingBox3D compute_bounding_box(const std::vector<Vertex>& vertices);
 
     };
 
+    // Vertex format of the meshes loaded from assets. Positions are 16-bit normalized integers scaled by POSITION_RANGE,
+    // normals are octahedral encoded into two 16-bit normalized integers and colors are 8-bit. Colors are stored as their
+    // square root, which keeps more precision for dark colors. The vertex shaders decode the attributes.
+    struct PackedVertex {
+
+        static constexpr float POSITION_RANGE = 8.0f; // Positions have to be within [-POSITION_RANGE, POSITION_RANGE]
+
+        std::array<std::int16_t, 4> position; // The last component is padding
+        std::array<std::int16_t, 2> normal;
+        std::array<std::uint8_t, 4> color; // The alpha channel is padding
+
+        explicit PackedVertex(const Vertex& vertex);
+        // Building cells look up their colors from palettes, so the red channel holds the material slot of the vertex
+        PackedVertex(const VertexWithMaterial& vertex, std::uint8_t material_slot);
+
+        // These decode the attributes the same way as the vertex shaders
+        glm::vec3 get_position() const;
+        glm::vec3 get_normal() const;
+        glm::vec3 get_color() const;
+
+        static VkVertexInputBindingDescription get_default_binding_description();
+        static std::array<VkVertexInputAttributeDescription, 3> get_default_attribute_descriptions();
+        static std::array<VkVertexInputBindingDescription, 2> get_instanced_binding_descriptions();
+        static std::array<VkVertexInputAttributeDescription, 5> get_instanced_attribute_descriptions();
+        static std::array<VkVertexInputBindingDescription, 2> get_building_binding_descriptions();
+        static std::array<VkVertexInputAttributeDescription, 6> get_building_attribute_descriptions();
+        static std::vector<PackedVertex> pack(const std::vector<Vertex>& vertices);
+
+    private:
+
+        PackedVertex(const glm::vec3& position, const glm::vec3& normal);
+
+    };
+
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "camera.h"
+#include "bounding_box.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/matrix.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <optional>
+
+namespace inf {
+
+    // Maps district grid positions to world space. Districts are laid out relative to the one at grid position (0, 0),
+    // increasing grid x moves along +x and increasing grid y moves along -z.
+    struct DistrictGrid {
+
+        glm::vec3 origin;
+        float district_size;
+        float district_height;
+        float road_gap;
+
+        glm::vec3 get_position(const glm::ivec2& grid_position) const;
+        BoundingBox3D get_bounding_box(const glm::ivec2& grid_position) const;
+        // Returns the grid positions of every district that can overlap the given box on the ground plane
+        std::vector<glm::ivec2> get_overlapping(const BoundingBox3D& bounding_box) const;
+
+    };
+
+    struct PrefetchCandidate {
+        glm::ivec2 grid_position;
+        float time_to_visible; // Zero if the district is already visible
+    };
+
+    // Extrapolates the camera motion to find the districts that are going to become visible soon
+    struct DistrictPrefetcher {
+
+        // Number of points in time the frustum is tested at within the horizon
+        static constexpr std::size_t NUM_SAMPLES = 8;
+        static constexpr float VELOCITY_SMOOTHING_SECONDS = 0.1f;
+
+        DistrictPrefetcher();
+
+        // Tracks the velocity of the camera, should be called once every frame
+        void update(const Camera& camera, float delta_time);
+        const glm::vec3& get_velocity() const;
+
+        // Returns the districts whose bounding box, enlarged by the margin on the ground plane, is inside the
+        // frustum now or at any point within the horizon, ordered by the expected time until they become visible
+        std::vector<PrefetchCandidate> predict(
+            const Camera& camera,
+            const glm::mat4& projection_matrix,
+            const DistrictGrid& grid,
+            float horizon_seconds,
+            float margin) const;
+
+    private:
+
+        std::optional<glm::vec3> last_position;
+        glm::vec3 velocity;
+
+    };
+
+}
@@ -1,16 +1,15 @@
 #pragma once
 
-#include "bounding_box.h"
 #include "gfx/mesh.h"
 
 #include <glm/vec2.hpp>
 
 #include <vector>
-#include <unordered_map>
+#include <cstdint>
 
 namespace inf {
 
-    enum class RoadDirection {
+    enum class RoadDirection : std::uint8_t {
         HORIZONTAL_UP,
         HORIZONTAL_DOWN,
         VERTICAL_LEFT,
@@ -21,17 +20,72 @@ namespace inf {
         CROSSING_DOWN_LEFT
     };
 
+    // Compact road record, the position of a road is implied by the cell of the road grid it is stored in
     struct DistrictRoad {
 
         RoadDirection direction;
-        glm::ivec2 position;
         bool traversable;
-        const gfx::Mesh* mesh;
-
-        DistrictRoad(RoadDirection direction, const glm::ivec2& position, bool traversable, const gfx::Mesh* mesh);
+        std::uint8_t mesh; // Index into the mesh table of the road grid
 
         bool is_crossing() const;
-        BoundingBox3D get_bounding_box(const glm::vec3& district_position) const;
+
+    };
+
+    // Dense grid of the roads of a district, so that looking up a road or its neighbours is plain index arithmetic
+    struct RoadGrid {
+
+        RoadGrid(const glm::ivec2& dimensions);
+
+        const glm::ivec2& get_dimensions() const;
+        std::size_t size() const;
+
+        // Returns nullptr if the position is out of bounds or there is no road at it
+        const DistrictRoad* find(const glm::ivec2& position) const;
+        DistrictRoad* find(const glm::ivec2& position);
+        const DistrictRoad& at(const glm::ivec2& position) const;
+        // Keeps the existing road if there is already one at the position
+        void add(const glm::ivec2& position, RoadDirection direction, bool traversable, const gfx::Mesh* mesh);
+
+        const gfx::Mesh* get_mesh(const DistrictRoad& road) const;
+        void set_mesh(DistrictRoad& road, const gfx::Mesh* mesh);
+
+        // Calls callback(position, road) for every road in row-major order
+        template<typename Callback>
+        void for_each(Callback&& callback) const {
+            for (int y = 0; y < dimensions.y; ++y) {
+                for (int x = 0; x < dimensions.x; ++x) {
+                    const auto& road = cells[y * dimensions.x + x];
+                    if (road.mesh != EMPTY) {
+                        callback(glm::ivec2(x, y), road);
+                    }
+                }
+            }
+        }
+
+        template<typename Callback>
+        void for_each(Callback&& callback) {
+            for (int y = 0; y < dimensions.y; ++y) {
+                for (int x = 0; x < dimensions.x; ++x) {
+                    auto& road = cells[y * dimensions.x + x];
+                    if (road.mesh != EMPTY) {
+                        callback(glm::ivec2(x, y), road);
+                    }
+                }
+            }
+        }
+
+    private:
+
+        // Mesh index of cells without a road
+        static constexpr std::uint8_t EMPTY = 0xFF;
+
+        glm::ivec2 dimensions;
+        std::vector<DistrictRoad> cells;
+        std::vector<const gfx::Mesh*> meshes;
+        std::size_t num_roads;
+
+        bool is_in_bounds(const glm::ivec2& position) const;
+        std::uint8_t get_mesh_index(const gfx::Mesh* mesh);
 
     };
 
@@ -41,7 +95,7 @@ namespace inf {
 
         static glm::ivec2 road_direction_to_grid_direction(RoadDirection direction);
         static std::vector<std::vector<glm::ivec2>> get_possible_continuations(
-            const std::unordered_map<glm::ivec2, DistrictRoad>& roads,
+            const RoadGrid& roads,
             const glm::ivec2& current_position,
             RoadDirection direction);
 
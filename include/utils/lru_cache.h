@@ -0,0 +1,90 @@
+#pragma once
+
+#include <list>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <unordered_map>
+
+namespace inf::utils {
+
+    struct CacheStatistics {
+        std::size_t num_entries;
+        std::size_t cost;
+        std::size_t hits;
+        std::size_t misses;
+    };
+
+    // Least recently used cache bounded by both the number of entries and their total cost. Values are moved
+    // out of the cache when they are taken, so every entry is used at most once.
+    template<typename Key, typename Value>
+    struct LruCache {
+
+        LruCache(std::size_t max_entries, std::size_t max_cost) :
+            max_entries(max_entries), max_cost(max_cost), cost(0), hits(0), misses(0) {}
+
+        // Evicts the least recently inserted entries until both limits hold. Values that would not fit on their own are dropped.
+        void insert(const Key& key, Value&& value, std::size_t value_cost) {
+            erase(key);
+            if (max_entries == 0 || value_cost > max_cost) {
+                return;
+            }
+            while (entries.size() >= max_entries || cost + value_cost > max_cost) {
+                erase(entries.back().key);
+            }
+            entries.emplace_front(Entry{ key, std::move(value), value_cost });
+            lookup.emplace(key, entries.begin());
+            cost += value_cost;
+        }
+
+        // Removes the entry from the cache and returns its value, counting it as a hit or a miss
+        std::optional<Value> take(const Key& key) {
+            const auto it = lookup.find(key);
+            if (it == lookup.cend()) {
+                ++misses;
+                return std::nullopt;
+            }
+            ++hits;
+            auto value = std::make_optional(std::move(it->second->value));
+            erase(key);
+            return value;
+        }
+
+        bool contains(const Key& key) const {
+            return lookup.find(key) != lookup.cend();
+        }
+
+        CacheStatistics get_statistics() const {
+            return CacheStatistics{ entries.size(), cost, hits, misses };
+        }
+
+    private:
+
+        struct Entry {
+            Key key;
+            Value value;
+            std::size_t cost;
+        };
+
+        std::size_t max_entries;
+        std::size_t max_cost;
+        std::size_t cost;
+        std::size_t hits;
+        std::size_t misses;
+        // Most recently inserted entries are at the front
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator> lookup;
+
+        void erase(const Key& key) {
+            const auto it = lookup.find(key);
+            if (it == lookup.cend()) {
+                return;
+            }
+            cost -= it->second->cost;
+            entries.erase(it->second);
+            lookup.erase(it);
+        }
+
+    };
+
+}
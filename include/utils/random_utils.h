@@ -2,12 +2,14 @@
 
 #include "common.h"
 
+#include <glm/vec2.hpp>
 #include <magic_enum.hpp>
 
 #include <deque>
 #include <cstdint>
 #include <numeric>
 #include <string>
+#include <vector>
 #include <stdexcept>
 #include <type_traits>
 
@@ -35,6 +37,37 @@ namespace inf::utils {
             return result;
         }
 
+        // Derives independent streams (e.g. for tasks running in parallel) from the current state of the generator without advancing
+        // it. The streams start after a long jump so they do not overlap the generator, and each of them is a jump apart from the next.
+        static std::vector<RandomGenerator> split(const RandomGenerator& rng, std::size_t count) {
+            std::vector<RandomGenerator> result;
+            result.reserve(count);
+            auto stream = rng;
+            stream.longJump();
+            for (std::size_t i = 0; i < count; ++i) {
+                result.emplace_back(stream);
+                stream.jump();
+            }
+            return result;
+        }
+
+        // Derives the seed of a district from the world seed and the grid position of the district, so that
+        // every district is generated the same way no matter when (or how many times) it is generated
+        static std::uint64_t derive_seed(std::uint64_t world_seed, const glm::ivec2& grid_position) {
+            const auto packed_position =
+                (static_cast<std::uint64_t>(static_cast<std::uint32_t>(grid_position.x)) << 32) |
+                static_cast<std::uint64_t>(static_cast<std::uint32_t>(grid_position.y));
+            return mix(world_seed ^ mix(packed_position));
+        }
+
+        // SplitMix64 finalizer, a cheap bijective mixer where every input bit affects every output bit
+        static std::uint64_t mix(std::uint64_t value) {
+            value += 0x9e3779b97f4a7c15;
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+            return value ^ (value >> 31);
+        }
+
         template<typename T>
         static std::enable_if_t<std::is_enum_v<T>, T> random_enum(RandomGenerator& rng) {
             std::uniform_int_distribution<std::size_t> enum_distribution(0, magic_enum::enum_count<T>() - 1);
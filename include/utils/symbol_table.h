@@ -0,0 +1,32 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace inf::utils {
+
+    // Dense integer identifier of an interned string
+    using SymbolId = std::uint32_t;
+
+    // Global table of interned names (meshes, materials, etc.). Names are interned once while assets are loaded,
+    // so generation can work on dense integer identifiers instead of hashing and comparing strings.
+    struct SymbolTable {
+
+        static SymbolId intern(std::string_view name);
+        static const std::string& get_name(SymbolId id);
+        static std::size_t size();
+
+        SymbolTable() = delete;
+
+    private:
+
+        static std::unordered_map<std::string, SymbolId> ids;
+        // Deque keeps references returned by get_name() valid while new names are interned
+        static std::deque<std::string> names;
+
+    };
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace inf::utils {
+
+    // Fixed size pool of worker threads that runs data parallel loops. The thread calling parallel_for()
+    // also executes tasks, so a pool of one thread runs everything serially on the calling thread.
+    struct ThreadPool {
+
+        ThreadPool(std::size_t num_threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::size_t get_number_of_threads() const;
+
+        // Calls task(index) for every index in [0, count) and blocks until all of them have finished. The first
+        // exception thrown by a task is rethrown on the calling thread. Must not be called from multiple threads at once.
+        void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    private:
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable work_available;
+        std::condition_variable work_finished;
+        const std::function<void(std::size_t)>* current_task;
+        std::size_t task_count;
+        std::size_t next_index;
+        std::size_t remaining;
+        std::uint64_t generation;
+        std::exception_ptr exception;
+        bool stopping;
+
+        void run_worker();
+        void execute_tasks();
+
+    };
+
+}
@@ -6,10 +6,12 @@
 #include "gfx/vk/memory_allocator.h"
 #include "road.h"
 #include "common.h"
+#include "bounding_box.h"
 
 #include <glm/vec2.hpp>
 
 #include <deque>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <filesystem>
@@ -23,6 +25,15 @@ namespace inf {
         VERTICAL_DOWN
     };
 
+    // Vehicle whose mesh has been baked on the CPU, but not uploaded to the GPU yet
+    struct VehicleGeometry {
+        glm::ivec2 position;
+        std::deque<glm::ivec2> targets;
+        std::vector<gfx::vk::PackedVertex> vertices;
+        std::vector<std::uint32_t> indices;
+        BoundingBox3D bounding_box;
+    };
+
     struct Vehicle {
 
         glm::ivec2 position;
@@ -36,9 +47,14 @@ namespace inf {
             const std::deque<glm::ivec2>& targets,
             gfx::Mesh&& mesh);
 
+        static Vehicle upload(
+            const gfx::vk::LogicalDevice* device,
+            const gfx::vk::MemoryAllocator* allocator,
+            const VehicleGeometry& geometry);
+
         void update(
             RandomGenerator& rng,
-            const std::unordered_map<glm::ivec2, DistrictRoad>& roads,
+            const RoadGrid& roads,
             float delta_time);
         std::pair<glm::vec3, float> get_world_position_and_rotation(const glm::vec3& district_position) const;
 
@@ -48,25 +64,28 @@ namespace inf {
 
     };
 
-    using VehicleMaterials = std::unordered_map<std::string, std::vector<glm::vec3>>;
+    using VehicleMaterials = std::unordered_map<utils::SymbolId, std::vector<glm::vec3>>;
 
     struct VehiclePattern {
 
         VehiclePattern(
-            std::vector<gfx::vk::VertexWithMaterialName>&& vertices,
+            std::vector<gfx::vk::VertexWithMaterial>&& vertices,
+            std::vector<std::uint32_t>&& indices,
             VehicleMaterials&& materials);
 
-        Vehicle instantiate(
+        // Only touches CPU-side data, so it is safe to call from any thread
+        VehicleGeometry generate(
             RandomGenerator& rng,
-            const gfx::vk::LogicalDevice* device,
-            const gfx::vk::MemoryAllocator* allocator,
             const glm::ivec2& position,
             const std::deque<glm::ivec2>& targets) const;
 
     private:
 
-        std::vector<gfx::vk::VertexWithMaterialName> vertices;
-        VehicleMaterials materials;
+        std::vector<gfx::vk::VertexWithMaterial> vertices;
+        std::vector<std::uint32_t> indices;
+        // Materials are indexed densely at load time, so generation does not depend on the size of the symbol table
+        std::vector<std::vector<glm::vec3>> material_candidates;
+        std::vector<std::uint32_t> vertex_materials; // Index of the material of every vertex
 
     };
 
@@ -6,9 +6,16 @@
 #include "gfx/vk/vertex.h"
 #include "wfc/rule.h"
 #include "bounding_box.h"
+#include "utils/hash_utils.h"
+#include "utils/symbol_table.h"
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <mutex>
 #include <memory>
 #include <string>
 #include <vector>
@@ -33,20 +40,38 @@ namespace inf::wfc {
         bool is_edge;
         float rotate_y;
         const BuildingMesh* mesh;
+        // Indices of the left, right, top and bottom neighbours, or BuildingContext::NO_CELL if there are none
+        std::array<std::size_t, 4> neighbors;
     };
 
     struct BuildingContext {
 
         using InstanceType = BuildingCell;
 
+        static constexpr std::size_t NO_CELL = std::numeric_limits<std::size_t>::max();
+
         int width;
         int height;
         int depth;
+        // Dense grid of cells laid out in x, y, z order, see index_of()
         std::vector<BuildingCell> cells;
+        // Meshes allowed by the static filters for each cell, if the pattern has been compiled for these dimensions
+        const CandidateSets* static_masks;
 
         BuildingContext(int width, int height, int depth);
 
-        bool cell_contains(const glm::ivec3& position, std::string_view name) const;
+        std::size_t index_of(const glm::ivec3& position) const;
+        bool cell_contains(std::size_t index, utils::SymbolId name) const;
+
+        // Lists the horizontal neighbours of a cell, which are the only cells whose filters can observe it
+        template<typename Callback>
+        void for_each_neighbor(std::size_t index, Callback&& callback) const {
+            for (const auto neighbor : cells[index].neighbors) {
+                if (neighbor != NO_CELL) {
+                    callback(neighbor);
+                }
+            }
+        }
 
     };
 
@@ -60,9 +85,9 @@ namespace inf::wfc {
 
     struct NextToBuildingPatternFilter {
 
-        std::string mesh_name;
+        utils::SymbolId mesh_name;
 
-        NextToBuildingPatternFilter(const std::string& mesh_name);
+        NextToBuildingPatternFilter(utils::SymbolId mesh_name);
 
         bool operator()(const BuildingContext&, const BuildingCell&) const;
 
@@ -86,17 +111,33 @@ namespace inf::wfc {
         bool operator()(const BuildingContext&, const BuildingCell&) const;
     };
 
+    // Static filters only depend on the cell position and the building dimensions, so they can be precompiled
+    bool is_static_filter(const BuildingPatternFilter& filter);
+
+    // A single collapsed cell of a building, drawn as an instance of the cell's mesh
+    struct BuildingCellInstance {
+        const BuildingMesh* mesh;
+        glm::vec3 position; // Relative to the building position
+        float rotation; // Counter-clockwise rotation around the Y axis, as expected by the instanced shaders
+    };
+
+    // CPU-side result of generating a building. It does not depend on a Vulkan device, so it can be
+    // created off the render thread (or without a device at all). Rendering only needs the meshes of
+    // the pattern to be uploaded once via BuildingPatterns::upload().
+    struct BuildingGeometry {
+        std::vector<BuildingCellInstance> cells;
+        std::uint32_t palette; // Index of the first color of the chosen palette, see BuildingPatterns::get_palette()
+        BoundingBox3D bounding_box;
+        glm::ivec3 dimensions;
+    };
+
     struct Building {
 
-        Building(
-            gfx::Mesh&& mesh,
-            const glm::ivec3& dimensions);
-        Building(
-            gfx::Mesh&& mesh,
-            const glm::ivec3& dimensions,
-            const glm::vec3& position);
+        Building(BuildingGeometry&& geometry);
+        Building(BuildingGeometry&& geometry, const glm::vec3& position);
 
-        const gfx::Mesh& get_mesh() const;
+        const std::vector<BuildingCellInstance>& get_cells() const;
+        std::uint32_t get_palette() const;
         const BoundingBox3D& get_bounding_box_in_model_space() const;
         BoundingBox3D get_bounding_box_in_world_space() const;
 
@@ -106,8 +147,7 @@ namespace inf::wfc {
 
     private:
 
-        gfx::Mesh mesh;
-        glm::ivec3 dimensions;
+        BuildingGeometry geometry;
         glm::vec3 position;
 
     };
@@ -128,20 +168,30 @@ namespace inf::wfc {
 
     struct BuildingMesh {
 
-        std::string name;
-        std::vector<gfx::vk::VertexWithMaterialName> vertices;
+        std::size_t index; // Index of the mesh within its pattern
+        utils::SymbolId name;
+        std::vector<gfx::vk::VertexWithMaterial> vertices;
+        std::vector<std::uint32_t> indices;
         std::vector<BuildingPatternFilter> filters;
         std::vector<BuildingMeshHeightRestriction> height_restrictions;
+        BoundingBox3D bounding_box;
 
         BuildingMesh(
-            const std::string& name,
-            std::vector<gfx::vk::VertexWithMaterialName>&& vertices,
+            std::size_t index,
+            utils::SymbolId name,
+            std::vector<gfx::vk::VertexWithMaterial>&& vertices,
+            std::vector<std::uint32_t>&& indices,
             std::vector<BuildingPatternFilter>&& filters,
             std::vector<BuildingMeshHeightRestriction>&& height_restrictions);
 
         bool matches(const BuildingContext& context, const BuildingCell& cell) const;
+        bool matches_static(const BuildingContext& context, const BuildingCell& cell) const;
         void apply(BuildingContext& context, BuildingCell& cell) const;
 
+    private:
+
+        std::vector<std::size_t> dynamic_filter_indices;
+
     };
 
     struct AnyBuildingDimensions{};
@@ -160,7 +210,7 @@ namespace inf::wfc {
 
     using BuildingDimensions = std::variant<AnyBuildingDimensions, AbsoluteBuildingDimensions>;
 
-    using BuildingMaterials = std::unordered_map<std::string, std::vector<glm::vec3>>;
+    using BuildingMaterials = std::unordered_map<utils::SymbolId, std::vector<glm::vec3>>;
 
     struct BuildingPattern {
 
@@ -169,6 +219,10 @@ namespace inf::wfc {
         BuildingMaterials materials;
         int weight;
         std::vector<BuildingMesh> meshes;
+        // Order in which the materials are chosen, the index of a material in it is its slot within a palette
+        std::vector<utils::SymbolId> material_slots;
+        // Index of the first color of the pattern in the global palette
+        std::uint32_t palette_offset;
 
         BuildingPattern(
             const std::string& name,
@@ -176,12 +230,25 @@ namespace inf::wfc {
             BuildingMaterials&& materials,
             int weight);
 
-        Building instantiate(
+        BuildingGeometry generate(
             RandomGenerator& rng,
-            const gfx::vk::LogicalDevice* logical_device,
-            const gfx::vk::MemoryAllocator* allocator,
             int max_width,
-            int max_depth) const;
+            int max_depth,
+            WfcSolver solver = WfcSolver::PROPAGATING) const;
+
+        std::uint32_t get_material_slot(utils::SymbolId material) const;
+        // Number of possible material combinations, each of which has its own palette
+        std::uint32_t get_number_of_palettes() const;
+        void append_palettes(std::vector<glm::vec4>& palette) const;
+
+        // Returns the per-cell allowed mesh masks for the given dimensions, compiling them on first use
+        const CandidateSets& get_static_masks(int width, int height, int depth) const;
+
+    private:
+
+        mutable std::unordered_map<glm::ivec3, CandidateSets> static_masks;
+        // Buildings are generated on multiple threads, which all share the caches of the patterns
+        static std::mutex static_masks_mutex;
 
     };
 
@@ -192,10 +259,23 @@ namespace inf::wfc {
         static void initialize(const std::filesystem::path& buildings_path);
         static std::vector<const BuildingPattern*> get_patterns(int max_width, int max_depth);
         static const BuildingPattern* get_pattern(const std::string& name);
+        // Colors of every material combination of every pattern, indexed by BuildingGeometry::palette + material slot
+        static const std::vector<glm::vec4>& get_palette();
+
+        // Uploads the meshes of every pattern, buildings are rendered as instances of them
+        static void upload(
+            const gfx::vk::LogicalDevice* logical_device,
+            const gfx::vk::MemoryAllocator* allocator);
+        static void deinitialize();
+        // Returns the uploaded mesh of a building cell or nullptr if the meshes have not been uploaded
+        static const gfx::Mesh* get_mesh(const BuildingMesh* mesh);
 
     private:
 
         static std::unordered_map<std::string, BuildingPattern> patterns;
+        static std::vector<glm::vec4> palette;
+        // Uploaded vertices have their material slot in the red channel, see BuildingPattern::get_material_slot()
+        static std::unordered_map<const BuildingMesh*, gfx::Mesh> meshes;
 
     };
 
@@ -3,14 +3,145 @@
 #include "common.h"
 
 #include <limits>
+#include <bitset>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
 #include <functional>
+#include <type_traits>
 #include <unordered_set>
 #include <unordered_map>
 
 namespace inf::wfc {
 
+    enum class WfcSolver {
+        // Re-evaluates every rule against every uncollapsed cell on each iteration
+        NAIVE,
+        // Keeps per-cell candidate sets and only re-evaluates the neighbours of collapsed cells
+        PROPAGATING
+    };
+
+    // Fixed size bitsets of candidate rules for every cell of a context, stored in a single flat array
+    struct CandidateSets {
+
+        CandidateSets(std::size_t num_cells, std::size_t num_rules) :
+            words_per_cell((num_rules + 63) / 64), words(num_cells * words_per_cell, 0) {}
+
+        void set(std::size_t cell, std::size_t rule) {
+            words[cell * words_per_cell + rule / 64] |= std::uint64_t(1) << (rule % 64);
+        }
+
+        bool test(std::size_t cell, std::size_t rule) const {
+            return words[cell * words_per_cell + rule / 64] & (std::uint64_t(1) << (rule % 64));
+        }
+
+        void clear(std::size_t cell) {
+            std::fill_n(words.begin() + cell * words_per_cell, words_per_cell, 0);
+        }
+
+        std::size_t count(std::size_t cell) const {
+            std::size_t result = 0;
+            for (std::size_t i = 0; i < words_per_cell; ++i) {
+                result += std::bitset<64>(words[cell * words_per_cell + i]).count();
+            }
+            return result;
+        }
+
+        // Returns the index of the n-th (zero based) set bit of the cell
+        std::size_t nth(std::size_t cell, std::size_t n) const {
+            for (std::size_t i = 0; i < words_per_cell; ++i) {
+                auto word = words[cell * words_per_cell + i];
+                const auto word_count = std::bitset<64>(word).count();
+                if (n >= word_count) {
+                    n -= word_count;
+                    continue;
+                }
+                for (std::size_t bit = 0; word; ++bit, word >>= 1) {
+                    if ((word & 1) && n-- == 0) {
+                        return i * 64 + bit;
+                    }
+                }
+            }
+            return std::numeric_limits<std::size_t>::max();
+        }
+
+    private:
+
+        std::size_t words_per_cell;
+        std::vector<std::uint64_t> words;
+
+    };
+
+    // Min-entropy priority queue that buckets cells by their number of candidates. Cells with zero
+    // candidates are tracked, but never picked, because they might gain candidates later on.
+    struct EntropyQueue {
+
+        EntropyQueue(std::size_t num_cells, std::size_t num_rules) :
+            buckets(num_rules + 1),
+            cell_buckets(num_cells, NOT_QUEUED),
+            cell_slots(num_cells, 0) {}
+
+        void update(std::size_t cell, std::size_t entropy) {
+            if (cell_buckets[cell] == entropy) {
+                return;
+            }
+            remove(cell);
+            auto& bucket = buckets[entropy];
+            cell_buckets[cell] = entropy;
+            cell_slots[cell] = bucket.size();
+            bucket.emplace_back(cell);
+        }
+
+        void remove(std::size_t cell) {
+            const auto entropy = cell_buckets[cell];
+            if (entropy == NOT_QUEUED) {
+                return;
+            }
+            // Swap the cell with the last one in the bucket so that removal is constant time
+            auto& bucket = buckets[entropy];
+            const auto last = bucket.back();
+            bucket[cell_slots[cell]] = last;
+            cell_slots[last] = cell_slots[cell];
+            bucket.pop_back();
+            cell_buckets[cell] = NOT_QUEUED;
+        }
+
+        // Returns the lowest non-zero entropy that has any cells or zero if there are none
+        std::size_t min_entropy() const {
+            for (std::size_t entropy = 1; entropy < buckets.size(); ++entropy) {
+                if (!buckets[entropy].empty()) {
+                    return entropy;
+                }
+            }
+            return 0;
+        }
+
+        const std::vector<std::size_t>& cells_with_entropy(std::size_t entropy) const {
+            return buckets[entropy];
+        }
+
+    private:
+
+        static constexpr std::size_t NOT_QUEUED = std::numeric_limits<std::size_t>::max();
+
+        std::vector<std::vector<std::size_t>> buckets;
+        std::vector<std::size_t> cell_buckets;
+        std::vector<std::size_t> cell_slots;
+
+    };
+
+    // Contexts can optionally provide a for_each_neighbor(cell_index, callback) method that lists every cell whose
+    // rule matches can change when the given cell collapses. Without it every uncollapsed cell is re-evaluated.
+    template<typename ContextType, typename = void>
+    struct HasNeighbors : std::false_type {};
+
+    template<typename ContextType>
+    struct HasNeighbors<ContextType, std::void_t<decltype(std::declval<const ContextType&>().for_each_neighbor(
+        std::size_t{}, std::declval<std::function<void(std::size_t)>>()))>> : std::true_type {};
+
     template<typename ContextType, typename RuleType>
-    void wfc_collapse(
+    void wfc_collapse_naive(
         RandomGenerator& rng,
         ContextType& context,
         const std::vector<RuleType>& rules) {
@@ -66,4 +197,81 @@ namespace inf::wfc {
         }
     }
 
-}
\ No newline at end of file
+    template<typename ContextType, typename RuleType>
+    void wfc_collapse_propagating(
+        RandomGenerator& rng,
+        ContextType& context,
+        const std::vector<RuleType>& rules) {
+        const auto num_cells = context.cells.size();
+        CandidateSets candidates(num_cells, rules.size());
+        EntropyQueue queue(num_cells, rules.size());
+        std::vector<bool> collapsed(num_cells, false);
+
+        const auto evaluate = [&](std::size_t cell) {
+            candidates.clear(cell);
+            std::size_t entropy = 0;
+            for (std::size_t rule = 0; rule < rules.size(); ++rule) {
+                if (rules[rule].matches(context, context.cells[cell])) {
+                    candidates.set(cell, rule);
+                    ++entropy;
+                }
+            }
+            queue.update(cell, entropy);
+        };
+        for (std::size_t cell = 0; cell < num_cells; ++cell) {
+            evaluate(cell);
+        }
+
+        while (true) {
+            // If there are no matching rules for the rest of the cells exit early
+            const auto min_entropy = queue.min_entropy();
+            if (min_entropy == 0) {
+                break;
+            }
+
+            // Cells and rules are picked uniformly the same way as in the naive solver to keep the distribution intact
+            const auto& min_entropy_cells = queue.cells_with_entropy(min_entropy);
+            std::uniform_int_distribution<std::size_t> cell_distribution(0, min_entropy_cells.size() - 1);
+            const auto cell = min_entropy_cells[cell_distribution(rng)];
+
+            std::uniform_int_distribution<std::size_t> rule_distribution(0, min_entropy - 1);
+            const auto rule = candidates.nth(cell, rule_distribution(rng));
+            rules[rule].apply(context, context.cells[cell]);
+            queue.remove(cell);
+            collapsed[cell] = true;
+
+            // Only the cells that can observe the collapsed cell need to be re-evaluated
+            if constexpr (HasNeighbors<ContextType>::value) {
+                context.for_each_neighbor(cell, [&](std::size_t neighbor) {
+                    if (!collapsed[neighbor]) {
+                        evaluate(neighbor);
+                    }
+                });
+            }
+            else {
+                for (std::size_t other = 0; other < num_cells; ++other) {
+                    if (!collapsed[other]) {
+                        evaluate(other);
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename ContextType, typename RuleType>
+    void wfc_collapse(
+        RandomGenerator& rng,
+        ContextType& context,
+        const std::vector<RuleType>& rules,
+        WfcSolver solver = WfcSolver::PROPAGATING) {
+        switch (solver) {
+            case WfcSolver::NAIVE:
+                wfc_collapse_naive(rng, context, rules);
+                break;
+            case WfcSolver::PROPAGATING:
+                wfc_collapse_propagating(rng, context, rules);
+                break;
+        }
+    }
+
+}
@@ -6,22 +6,33 @@
 #include "weather.h"
 #include "gfx/renderer.h"
 #include "gfx/particles.h"
+#include "utils/lru_cache.h"
 
 #include <memory>
 #include <functional>
+#include <unordered_set>
 #include <unordered_map>
 
 namespace inf {
 
     struct World {
 
+        // Limits of the cache that keeps evicted districts around in case they become visible again
+        static constexpr std::size_t MAX_CACHED_DISTRICTS = 32;
+        static constexpr std::size_t MAX_CACHED_DISTRICT_BYTES = 256 * 1024 * 1024;
+
         World(const Timer& timer, Context& context, std::function<gfx::ParticleSystem(int)> rain_particle_factory);
 
-        void update_caches();
+        void update_caches(gfx::Renderer& renderer);
 
         bool has_district_at(const glm::ivec2& position) const;
         District& add_district(const glm::ivec2& position, District&& district);
         const std::unordered_map<glm::ivec2, District>& get_districts() const;
+        // Districts that are not visible, but are expected to become visible soon, are not evicted on update
+        void set_retained_districts(std::unordered_set<glm::ivec2>&& grid_positions);
+        // Moves the district back from the cache of evicted districts, returns false if it was not cached
+        bool restore_district(const glm::ivec2& position);
+        utils::CacheStatistics get_district_cache_statistics() const;
 
         std::size_t get_number_of_districts() const;
         std::size_t get_number_of_buildings() const;
@@ -34,29 +45,49 @@ namespace inf {
         bool is_dirty() const;
 
     private:
+
+        // Roads and crossings that connect neighbouring districts
+        struct SeamGeometry {
+
+            std::vector<glm::vec3> road_positions;
+            std::vector<float> road_rotations;
+            std::vector<glm::vec3> crossing_positions;
+            std::vector<float> crossing_rotations;
+
+        };
+
+        // Instances of a seam that are retained by the renderer
+        struct Seam {
+
+            gfx::InstanceSet roads;
+            gfx::InstanceSet crossings;
+
+        };
     
         const Timer& timer;
         Context& context;
         std::function<gfx::ParticleSystem(int)> rain_particle_factory;
         std::unordered_map<glm::ivec2, District> districts;
-        std::vector<glm::vec3> road_positions;
-        std::vector<float> road_rotations;
-        std::vector<glm::vec3> crossing_positions;
-        std::vector<float> crossing_rotations;
-        bool dirty; // Indicates whether caches need to be updated before rendering
+        std::unordered_set<glm::ivec2> retained_districts;
+        utils::LruCache<glm::ivec2, District> district_cache;
+        // Seams are keyed by the grid position of the district that owns them: the left district of vertical seams,
+        // the bottom district of horizontal seams and the district itself for the crossings sealing its corners
+        std::unordered_map<glm::ivec2, Seam> vertical_seams;
+        std::unordered_map<glm::ivec2, Seam> horizontal_seams;
+        std::unordered_map<glm::ivec2, Seam> corner_seams;
+        // Districts added or removed since the last cache update, only the seams touching them are rebuilt
+        std::unordered_set<glm::ivec2> changed_districts;
         Weather weather;
         RainIntensity rain_intensity;
         float last_weather_change_check;
         std::unique_ptr<gfx::ParticleSystem> rain_particles;
 
-        void place_vertical_road(
-            const District* left,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& left_roads_at_edges,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& right_roads_at_edges);
-        void place_horizontal_road(
-            const District* bottom,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& top_roads_at_edges,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& bottom_roads_at_edges);
+        const District* find_district(const glm::ivec2& position) const;
+        // Rebuilds the seam owned by the district at the given position, or removes it if there is no such district
+        void update_vertical_seam(gfx::Renderer& renderer, const glm::ivec2& left_grid_position);
+        void update_horizontal_seam(gfx::Renderer& renderer, const glm::ivec2& bottom_grid_position);
+        void update_corner_seam(gfx::Renderer& renderer, const glm::ivec2& position);
+        static Seam register_seam(gfx::Renderer& renderer, const SeamGeometry& geometry);
 
         std::vector<std::pair<Weather, RainIntensity>> get_possible_new_weathers() const;
         void on_weather_change(Weather new_weather, RainIntensity new_rain_intensity);
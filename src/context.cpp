@@ -1,6 +1,7 @@
 #include "context.h"
 
 #include <cmath>
+#include <thread>
 
 namespace inf {
 
@@ -8,8 +9,20 @@ namespace inf {
         time_of_day(0.5f), camera_speed(CAMERA_SPEED_INIITAL), fix_time_of_day(false), override_weather(false),
         weather_change_frequency_seconds(WEATHER_CHANGE_FREQUENCY_SECONDS_INITIAL),
         weather_change_chance_percentage(WEATHER_CHANGE_CHANCE_PERCENTAGE_INITIAL),
+        prefetch_horizon_seconds(PREFETCH_HORIZON_SECONDS_INITIAL),
+        prefetch_margin(PREFETCH_MARGIN_INITIAL),
+        eviction_margin(EVICTION_MARGIN_INITIAL),
+        generation_budget_milliseconds(GENERATION_BUDGET_MILLISECONDS_INITIAL),
+        shadow_cascades(SHADOW_CASCADES_INITIAL),
+        shadow_distance(SHADOW_DISTANCE_INITIAL),
+        shadow_split_lambda(SHADOW_SPLIT_LAMBDA_INITIAL),
+        shadow_cascade_resolution(SHADOW_CASCADE_RESOLUTION_INITIAL),
+        cache_shadows(true),
+        background_generation(std::thread::hardware_concurrency() > 1),
+        parallel_command_recording(std::thread::hardware_concurrency() > 1),
         show_diagnostics(false),
         show_debug_bbs(false),
+        wfc_solver(wfc::WfcSolver::PROPAGATING),
         state(State::PANNING), set_mouse_captured(set_mouse_captured),
         weather_change_force_flag(false), weather(Weather::SUNNY), rain_intensity(RainIntensity::LIGHT) {}
 
@@ -29,7 +29,10 @@ namespace inf {
         type(type), grid_position(grid_position), dimensions(dimensions),
         position(), bb_color(bb_color), bounding_box(
             glm::vec3(position.x, 0.0f, position.z),
-            glm::vec3(position.x + dimensions.x, DISTRICT_BB_HEIGHT, position.z + dimensions.y)) {}
+            glm::vec3(position.x + dimensions.x, DISTRICT_BB_HEIGHT, position.z + dimensions.y)),
+        roads(dimensions) {
+        update_edge_roads();
+    }
 
     void District::update(RandomGenerator& rng, float delta_time) {
         for (auto& vehicle : vehicles) {
@@ -38,6 +41,9 @@ namespace inf {
     }
 
     void District::update_caches() {
+        // Registered ground instances are outdated, they are registered again with the new data on the next render
+        release_instance_sets();
+
         // Update grass data
         grass_instances.clear();
         for (const auto& lot : lots) {
@@ -54,32 +60,33 @@ namespace inf {
 
         // Update road positions
         road_instances.clear();
-        for (const auto& [_, road] : roads) {
+        roads.for_each([&](const glm::ivec2& road_position_in_district, const DistrictRoad& road) {
             const auto& direction = road.direction;
             const auto road_position =  glm::vec3(
-                position.x + road.position.x + 0.5f,
+                position.x + road_position_in_district.x + 0.5f,
                 position.y + 0.5f,
-                position.z + road.position.y + 0.5f);
-            road_instances[road.mesh].positions.emplace_back(road_position);
+                position.z + road_position_in_district.y + 0.5f);
+            auto& instances = road_instances[roads.get_mesh(road)];
+            instances.positions.emplace_back(road_position);
             switch (direction) {
                 case RoadDirection::VERTICAL_LEFT:
                 case RoadDirection::CROSSING_DOWN_LEFT:
-                    road_instances[road.mesh].rotations.emplace_back(0.0f);
+                    instances.rotations.emplace_back(0.0f);
                     break;
                 case RoadDirection::VERTICAL_RIGHT:
                 case RoadDirection::CROSSING_UP_RIGHT:
-                    road_instances[road.mesh].rotations.emplace_back(glm::radians(180.f));
+                    instances.rotations.emplace_back(glm::radians(180.f));
                     break;
                 case RoadDirection::HORIZONTAL_UP:
                 case RoadDirection::CROSSING_UP_LEFT:
-                    road_instances[road.mesh].rotations.emplace_back(glm::radians(90.0f));
+                    instances.rotations.emplace_back(glm::radians(90.0f));
                     break;
                 case RoadDirection::HORIZONTAL_DOWN:
                 case RoadDirection::CROSSING_DOWN_RIGHT:
-                    road_instances[road.mesh].rotations.emplace_back(glm::radians(270.0f));
+                    instances.rotations.emplace_back(glm::radians(270.0f));
                     break;
             }
-        }
+        });
 
         // Update foliage data
         foliage_instances.clear();
@@ -135,34 +142,74 @@ namespace inf {
         return lots;
     }
 
-    const std::unordered_map<glm::ivec2, DistrictRoad>& District::get_roads() const {
+    const RoadGrid& District::get_roads() const {
         return roads;
     }
 
-    std::unordered_map<glm::ivec2, const DistrictRoad*> District::get_roads_at_edges() const {
-        std::unordered_map<glm::ivec2, const DistrictRoad*> result;
-        for (const auto& [position, road] : roads) {
-            if (position.x == 0 ||
-                position.x == dimensions.x - 1 ||
-                position.y == 0 ||
-                position.y == dimensions.y - 1) {
-                result.emplace(position, &road);
-            }
-        }
-        return result;
+    const DistrictEdgeRoads& District::get_edge_roads() const {
+        return edge_roads;
     }
 
     const std::vector<Vehicle>& District::get_vehicles() const {
         return vehicles;
     }
 
+    std::size_t District::estimate_memory_usage() const {
+        std::size_t result = sizeof(District);
+        for (const auto& lot : lots) {
+            result += sizeof(DistrictLot);
+            if (lot.building) {
+                result += lot.building->get_cells().size() * sizeof(wfc::BuildingCellInstance);
+            }
+            for (const auto& [_, positions] : lot.foliage) {
+                result += positions.size() * sizeof(glm::vec3);
+            }
+        }
+        result += roads.size() * sizeof(DistrictRoad);
+        for (const auto& vehicle : vehicles) {
+            result += sizeof(Vehicle) +
+                vehicle.mesh.get_number_of_vertices() * sizeof(gfx::vk::PackedVertex) +
+                vehicle.mesh.get_number_of_indices() * sizeof(std::uint32_t);
+        }
+        // Instance caches
+        result += grass_instances.positions.size() * (sizeof(glm::vec3) + sizeof(float));
+        for (const auto& [_, instances] : road_instances) {
+            result += instances.positions.size() * (sizeof(glm::vec3) + sizeof(float));
+        }
+        for (const auto& [_, instances] : foliage_instances) {
+            result += instances.positions.size() * (sizeof(glm::vec3) + sizeof(float));
+        }
+        return result;
+    }
+
     void District::add_lot(DistrictLot&& lot) {
         lots.emplace_back(std::move(lot));
     }
 
-    void District::add_road(DistrictRoad&& road) {
-        const auto position = road.position;
-        roads.emplace(position, std::move(road));
+    void District::set_roads(RoadGrid&& roads) {
+        this->roads = std::move(roads);
+        update_edge_roads();
+    }
+
+    void District::update_edge_roads() {
+        // Summarize the borders once, they are looked up every time a neighbouring district is added or removed
+        const auto get_direction = [this](const glm::ivec2& position) -> std::optional<RoadDirection> {
+            const auto road = this->roads.find(position);
+            return road ? std::optional<RoadDirection>(road->direction) : std::nullopt;
+        };
+        edge_roads = DistrictEdgeRoads{};
+        for (int y = 0; y < dimensions.y; ++y) {
+            edge_roads.first_column.emplace_back(get_direction(glm::ivec2(0, y)));
+            edge_roads.last_column.emplace_back(get_direction(glm::ivec2(dimensions.x - 1, y)));
+        }
+        for (int x = 0; x < dimensions.x; ++x) {
+            edge_roads.first_row.emplace_back(get_direction(glm::ivec2(x, 0)));
+            edge_roads.last_row.emplace_back(get_direction(glm::ivec2(x, dimensions.y - 1)));
+        }
+    }
+
+    void District::release_instance_sets() {
+        ground_instance_sets.clear();
     }
 
     void District::add_vehicle(Vehicle&& vehicle) {
@@ -170,12 +217,19 @@ namespace inf {
     }
 
     void District::render(gfx::Renderer& renderer) {
-        // Render ground objects (such as roads and foliage)
-        const auto& grass_mesh = wfc::GroundPatterns::get_pattern("grass").mesh;
-
-        renderer.render_instanced(grass_mesh, grass_instances.positions, grass_instances.rotations);
-        for (const auto& [mesh_ptr, instance_data] : road_instances) {
-            renderer.render_instanced_caster(*mesh_ptr, instance_data.positions, instance_data.rotations);
+        // Ground objects (such as roads and foliage) only change with the caches, so they are registered once and retained by the renderer
+        if (ground_instance_sets.empty()) {
+            const auto& grass_mesh = wfc::GroundPatterns::get_pattern("grass").mesh;
+            ground_instance_sets.emplace_back(renderer.create_instance_set(
+                grass_mesh, false, grass_instances.positions, grass_instances.rotations));
+            for (const auto& [mesh_ptr, instance_data] : road_instances) {
+                ground_instance_sets.emplace_back(renderer.create_instance_set(
+                    *mesh_ptr, true, instance_data.positions, instance_data.rotations));
+            }
+            for (const auto& [ptr, instance_data] : foliage_instances) {
+                ground_instance_sets.emplace_back(renderer.create_instance_set(
+                    ptr->mesh, true, instance_data.positions, instance_data.rotations));
+            }
         }
 
         // Render vehicles
@@ -194,30 +248,57 @@ namespace inf {
             const auto obb = vehicle.mesh.get_bounding_box_in_model_space()
                 .apply(model_matrix)
                 .to_oriented(transformation);
+            // Vehicles outside of the camera frustum can still cast shadows into it, the renderer culls them by the light
             if (frustum.is_inside(obb)) {
                 renderer.render(vehicle.mesh);
             }
+            else {
+                renderer.render_shadow_caster(vehicle.mesh);
+            }
         }
 
-        // Render lot buildings and collect foliage data
+        // Collect building cell instances of visible lots, and of the lots that can cast shadows into the camera frustum.
+        // Each cell mesh is rendered once for every building.
+        for (auto& [_, instances] : building_instances) {
+            instances.clear();
+        }
+        for (auto& [_, instances] : building_caster_instances) {
+            instances.clear();
+        }
         const auto transform = renderer.get_view_matrix();
+        const auto& shadow_caster_volume = renderer.get_shadow_caster_volume();
         for (const auto& lot : lots) {
             const auto lot_bb = lot.get_bounding_box(position);
             const auto obb = lot_bb.to_oriented(transform);
-            if (!frustum.is_inside(obb)) {
+            const auto is_visible = frustum.is_inside(obb);
+            if (!is_visible &&
+                !shadow_caster_volume.is_sphere_inside(lot_bb.center(), glm::length(lot_bb.max - lot_bb.min) * 0.5f)) {
                 continue;
             }
             const auto& building = lot.building;
-            renderer.render(lot_bb, lot.bb_color);
+            if (is_visible) {
+                renderer.render(lot_bb, lot.bb_color);
+            }
+            auto& instances = is_visible ? building_instances : building_caster_instances;
             if (building) {
-                renderer.render(building->get_mesh());
+                const auto& building_position = building->get_position();
+                const auto palette = building->get_palette();
+                for (const auto& cell : building->get_cells()) {
+                    const auto mesh = wfc::BuildingPatterns::get_mesh(cell.mesh);
+                    if (!mesh) {
+                        continue;
+                    }
+                    instances[mesh].emplace_back(
+                        gfx::vk::BuildingInstance{ building_position + cell.position, cell.rotation, palette });
+                }
                 // renderer.render(building->get_bounding_box(), glm::vec3(1.0f, 0.0f, 0.0f));
             }
         }
-
-        // Render foliage
-        for (const auto& [ptr, instance_data] : foliage_instances) {
-            renderer.render_instanced_caster(ptr->mesh, instance_data.positions, instance_data.rotations);
+        for (const auto& [mesh_ptr, instances] : building_instances) {
+            renderer.render_building_instances(*mesh_ptr, instances);
+        }
+        for (const auto& [mesh_ptr, instances] : building_caster_instances) {
+            renderer.render_building_shadow_casters(*mesh_ptr, instances);
         }
 
         renderer.render(compute_bounding_box(), bb_color);
@@ -0,0 +1,404 @@
+#include "district_builder.h"
+#include "wfc/ground.h"
+#include "utils/random_utils.h"
+
+#include <glm/glm.hpp>
+
+#include <deque>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+namespace inf {
+
+    DistrictBuilder::DistrictBuilder(
+        std::uint64_t world_seed,
+        const glm::ivec2& grid_position,
+        const glm::vec3& position,
+        wfc::WfcSolver wfc_solver,
+        const gfx::vk::LogicalDevice* device,
+        const gfx::vk::MemoryAllocator* allocator) :
+        device(device), allocator(allocator), grid_position(grid_position), position(position), wfc_solver(wfc_solver),
+        stage(DistrictBuildStage::PARTITION),
+        // Districts only depend on the world seed and their position, so a district is the same every time it is generated
+        district_rng(utils::RandomUtils::derive_seed(world_seed, grid_position)),
+        district(create_district(district_rng, grid_position)),
+        roads(glm::ivec2(District::DISTRICT_SIZE, District::DISTRICT_SIZE)),
+        num_uploaded_vehicles(0) {}
+
+    DistrictBuildStage DistrictBuilder::get_stage() const {
+        return stage;
+    }
+
+    const glm::ivec2& DistrictBuilder::get_grid_position() const {
+        return grid_position;
+    }
+
+    void DistrictBuilder::step() {
+        switch (stage) {
+            case DistrictBuildStage::PARTITION:
+                partition();
+                break;
+            case DistrictBuildStage::ROADS:
+                post_process_roads();
+                break;
+            case DistrictBuildStage::LOTS:
+                generate_next_lot();
+                break;
+            case DistrictBuildStage::VEHICLES:
+                place_vehicles();
+                break;
+            case DistrictBuildStage::UPLOAD:
+                upload_next_vehicle();
+                break;
+            case DistrictBuildStage::DONE:
+                break;
+        }
+    }
+
+    void DistrictBuilder::generate_lots(utils::ThreadPool& thread_pool, const std::atomic<bool>& cancelled) {
+        if (stage != DistrictBuildStage::LOTS) {
+            return;
+        }
+        thread_pool.parallel_for(remaining_lots.size(), [&](std::size_t index) {
+            if (!cancelled) {
+                const auto lot_index = remaining_lots[index];
+                lots[lot_index].emplace(generate_lot(lot_rngs[lot_index], partitions[lot_index], wfc_solver));
+            }
+        });
+        if (cancelled) {
+            return;
+        }
+        remaining_lots.clear();
+        finish_lots();
+    }
+
+    void DistrictBuilder::prioritize_lots(const glm::vec3& camera_position) {
+        const auto distance_to_camera = [&](std::size_t lot_index) {
+            const auto& partition = partitions[lot_index];
+            const auto center = position + glm::vec3(partition.x + partition.z, 0.0f, partition.y + partition.w) * 0.5f;
+            return glm::distance(center, camera_position);
+        };
+        // The nearest lot is moved to the back, because that is where the next lot is taken from
+        std::sort(remaining_lots.begin(), remaining_lots.end(), [&](std::size_t a, std::size_t b) {
+            return distance_to_camera(a) > distance_to_camera(b);
+        });
+    }
+
+    District DistrictBuilder::finish() {
+        if (stage != DistrictBuildStage::DONE) {
+            throw std::runtime_error("Cannot finish a district build that is not done.");
+        }
+        return std::move(district);
+    }
+
+    void DistrictBuilder::partition() {
+        // Slice up the district into lots
+        static constexpr auto min_lot_width = 8;
+        static constexpr auto max_lot_width = 10;
+        std::uniform_int_distribution<int> lot_width_distribution(min_lot_width, max_lot_width);
+        static constexpr auto min_lot_depth = 6;
+        static constexpr auto max_lot_depth = 8;
+        std::uniform_int_distribution<int> lot_depth_distribution(min_lot_depth, max_lot_depth);
+        partitions = { glm::vec4{ 0, 0, District::DISTRICT_SIZE, District::DISTRICT_SIZE } };
+        const auto is_partition_sufficiently_sized = [](const glm::ivec4& partition) {
+            const auto width = partition.z - partition.x;
+            if (width > max_lot_width) {
+                return false;
+            }
+            const auto depth = partition.w - partition.y;
+            if (depth > max_lot_depth) {
+                return false;
+            }
+            // We do not need to check for smaller than minimum sizes, because the slicing
+            // algorithm should guarantee that we never slice into smaller partitions than
+            // what is the minimum size for a lot.
+            return true;
+        };
+        const auto are_partitions_sufficiently_sized = [&]() {
+            for (const auto& partition : partitions) {
+                if (!is_partition_sufficiently_sized(partition)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        // Road gap is used to introduce gaps between lots where roads will be placed
+        static constexpr auto road_gap = 2;
+        const auto road_mesh = &wfc::GroundPatterns::get_pattern("road").mesh;
+        while (!are_partitions_sufficiently_sized()) {
+            std::vector<glm::ivec4> new_partitions;
+            for (const auto& partition : partitions) {
+                const auto width = partition.z - partition.x;
+                const auto depth = partition.w - partition.y;
+                // Cut partition vertically if needed
+                if (width > max_lot_width) {
+                    std::uniform_int_distribution<int> slice_distribution(
+                        static_cast<int>(width * 0.4f),
+                        static_cast<int>(width * 0.6f));
+                    const auto slice_at = slice_distribution(district_rng);
+                    new_partitions.emplace_back(partition.x, partition.y, partition.x + slice_at, partition.w);
+                    new_partitions.emplace_back(partition.x + slice_at + road_gap, partition.y, partition.z, partition.w);
+                    // Add a vertical road strip along the created gap
+                    for (int offset = partition.y; offset < partition.w; ++offset) {
+                        const auto road_position_left = glm::ivec2(partition.x + slice_at, offset);
+                        const auto road_position_right = road_position_left + glm::ivec2(1, 0);
+                        roads.add(road_position_left, RoadDirection::VERTICAL_LEFT, false, road_mesh);
+                        roads.add(road_position_right, RoadDirection::VERTICAL_RIGHT, false, road_mesh);
+                    }
+                }
+                // Cut partition horizontally if needed
+                else if (depth > max_lot_depth) {
+                    std::uniform_int_distribution<int> slice_distribution(
+                        static_cast<int>(depth * 0.4f),
+                        static_cast<int>(depth * 0.6f));
+                    const auto slice_at = slice_distribution(district_rng);
+                    new_partitions.emplace_back(partition.x, partition.y, partition.z, partition.y + slice_at);
+                    new_partitions.emplace_back(partition.x, partition.y + slice_at + road_gap, partition.z, partition.w);
+                    // Add a horizontal road strip along the created gap
+                    for (int offset = partition.x; offset < partition.z; ++offset) {
+                        const auto road_position_up = glm::ivec2(offset, partition.y + slice_at);
+                        const auto road_position_down = road_position_up + glm::ivec2(0, 1);
+                        roads.add(road_position_up, RoadDirection::HORIZONTAL_UP, false, road_mesh);
+                        roads.add(road_position_down, RoadDirection::HORIZONTAL_DOWN, false, road_mesh);
+                    }
+                }
+                // Otherwise the partition is sufficiently sized and we simply move it the list of new partitions
+                else {
+                    new_partitions.emplace_back(partition);
+                }
+            }
+            partitions = std::move(new_partitions);
+        }
+        stage = DistrictBuildStage::ROADS;
+    }
+
+    void DistrictBuilder::post_process_roads() {
+        // Post process roads to set their directions (which is not trivial to do before, because we need to account for crossings)
+        // and to set their traversability depending on whether they are located on the edges of a district.
+        std::vector<glm::ivec4> non_edge_partitions;
+        for (const auto& partition : partitions) {
+            if (partition.x != 0 &&
+                partition.y != 0 &&
+                partition.z != District::DISTRICT_SIZE &&
+                partition.w != District::DISTRICT_SIZE) {
+                non_edge_partitions.emplace_back(partition);
+            }
+        }
+        set_road_directions_and_traversability(district_rng, roads, non_edge_partitions);
+
+        lot_rngs = utils::RandomUtils::split(district_rng, partitions.size());
+        lots.resize(partitions.size());
+        remaining_lots.resize(partitions.size());
+        for (std::size_t i = 0; i < remaining_lots.size(); ++i) {
+            remaining_lots[i] = remaining_lots.size() - i - 1;
+        }
+        stage = DistrictBuildStage::LOTS;
+    }
+
+    void DistrictBuilder::generate_next_lot() {
+        if (!remaining_lots.empty()) {
+            const auto lot_index = remaining_lots.back();
+            remaining_lots.pop_back();
+            lots[lot_index].emplace(generate_lot(lot_rngs[lot_index], partitions[lot_index], wfc_solver));
+        }
+        if (remaining_lots.empty()) {
+            finish_lots();
+        }
+    }
+
+    void DistrictBuilder::finish_lots() {
+        for (auto& lot : lots) {
+            district.add_lot(std::move(lot.value()));
+        }
+        lots.clear();
+        stage = DistrictBuildStage::VEHICLES;
+    }
+
+    void DistrictBuilder::place_vehicles() {
+        // Place vehicles randomly onto traversable roads that are not crossings
+        static constexpr auto num_vehicles_per_district = 50;
+        std::vector<glm::ivec2> road_positions;
+        road_positions.reserve(roads.size());
+        roads.for_each([&road_positions](const glm::ivec2& road_position, const DistrictRoad& road) {
+            if (road.traversable && !road.is_crossing()) {
+                road_positions.emplace_back(road_position);
+            }
+        });
+        const auto positions_to_place_vehicles_on = utils::RandomUtils::choose(district_rng, road_positions, num_vehicles_per_district);
+        for (const auto& road_position : positions_to_place_vehicles_on) {
+            const auto& road = roads.at(*road_position);
+            std::deque<glm::ivec2> targets = { *road_position + RoadUtils::road_direction_to_grid_direction(road.direction) };
+            const auto& vehicle_pattern = VehiclePatterns::get_random_pattern(district_rng);
+            vehicles.emplace_back(vehicle_pattern.generate(district_rng, *road_position, targets));
+        }
+
+        // Hand the created roads over to the district
+        district.set_roads(std::move(roads));
+
+        // The district is complete apart from its vehicles, so its caches can be built before the upload
+        district.set_position(position);
+        district.update_caches();
+        stage = vehicles.empty() ? DistrictBuildStage::DONE : DistrictBuildStage::UPLOAD;
+    }
+
+    void DistrictBuilder::upload_next_vehicle() {
+        district.add_vehicle(Vehicle::upload(device, allocator, vehicles[num_uploaded_vehicles++]));
+        if (num_uploaded_vehicles == vehicles.size()) {
+            vehicles.clear();
+            stage = DistrictBuildStage::DONE;
+        }
+    }
+
+    District DistrictBuilder::create_district(RandomGenerator& rng, const glm::ivec2& grid_position) {
+        std::uniform_real_distribution<float> color_distribution(0.0f, 1.0f);
+        const auto bb_color = glm::vec3(color_distribution(rng), color_distribution(rng), color_distribution(rng));
+        return District(DistrictType::RESIDENTAL, grid_position, glm::ivec2(District::DISTRICT_SIZE, District::DISTRICT_SIZE), bb_color);
+    }
+
+    DistrictLot DistrictBuilder::generate_lot(RandomGenerator& rng, const glm::ivec4& partition, wfc::WfcSolver wfc_solver) {
+        const auto width = partition.z - partition.x;
+        const auto depth = partition.w - partition.y;
+        const auto patterns = wfc::BuildingPatterns::get_patterns(width, depth);
+        const wfc::BuildingPattern* pattern = nullptr;
+        if (!patterns.empty()) {
+            // Sum the weights and use them to form a distribution
+            int sum_weights = 0;
+            for (const auto& entry : patterns) {
+                sum_weights += entry->weight;
+            }
+            std::uniform_int_distribution<int> pattern_distribution(1, sum_weights);
+            int result = pattern_distribution(rng);
+            int accumulator = 0;
+            for (const auto& entry : patterns) {
+                if (result > accumulator && result <= entry->weight + accumulator) {
+                    pattern = entry;
+                    break;
+                }
+                accumulator += entry->weight;
+            }
+        }
+        // If the dimensions are not suitable for any pattern for the district the lot remains vacant, otherwise generate building that is guaranteed to fit
+        auto building = pattern
+                ? std::make_optional(generate_building(rng, *pattern, width - 1, depth - 1, wfc_solver))
+                : std::nullopt;
+        
+        DistrictFoliage foliage;
+        const auto building_dimensions = building ? building->get_dimensions() : glm::ivec3();
+        // TODO: Foliage placement logic could be improved quite a bit, but this works for now
+        static constexpr auto foliage_chance = 0.25f;
+        std::uniform_real_distribution<float> random_dist(0.0f, 1.0f);
+        if (building_dimensions.x < width - 2) {
+            std::uniform_int_distribution<int> vertical_dist(1, depth - 1);
+            // Potentially put foliage on the left
+            if (random_dist(rng) < foliage_chance) {
+                const auto& foliage_pattern = wfc::GroundPatterns::get_random_foliage_pattern(rng);
+                foliage[&foliage_pattern].emplace_back(glm::vec3(1.0f, 0.0f, vertical_dist(rng)));
+            }
+            // Potentially to put foliage on the right
+            if (random_dist(rng) < foliage_chance) {
+                const auto& foliage_pattern = wfc::GroundPatterns::get_random_foliage_pattern(rng);
+                foliage[&foliage_pattern].emplace_back(glm::vec3(width - 1.0f, 0.0f, vertical_dist(rng)));
+            }
+        }
+        if (building_dimensions.z < depth - 2) {
+            std::uniform_int_distribution<int> horizontal_dist(1, width - 1);
+            // Potentially put foliage on top
+            if (random_dist(rng) < foliage_chance) {
+                const auto& foliage_pattern = wfc::GroundPatterns::get_random_foliage_pattern(rng);
+                foliage[&foliage_pattern].emplace_back(glm::vec3(horizontal_dist(rng), 0.0f, 1.0f));
+            }
+            // Potentially put foliage on bottom
+            if (random_dist(rng) < foliage_chance) {
+                const auto& foliage_pattern = wfc::GroundPatterns::get_random_foliage_pattern(rng);
+                foliage[&foliage_pattern].emplace_back(glm::vec3(horizontal_dist(rng), 0.0f, depth - 1.0f));
+            }
+        }
+
+        std::uniform_real_distribution<float> color_distribution(0.0f, 1.0f);
+        return DistrictLot(
+            glm::ivec2(partition),
+            glm::ivec2(width, depth),
+            glm::vec3(color_distribution(rng), color_distribution(rng), color_distribution(rng)),
+            std::move(building),
+            std::move(foliage));
+    }
+
+    wfc::Building DistrictBuilder::generate_building(
+        RandomGenerator& rng,
+        const wfc::BuildingPattern& pattern,
+        int max_width,
+        int max_depth,
+        wfc::WfcSolver wfc_solver) {
+        return wfc::Building(pattern.generate(rng, max_width, max_depth, wfc_solver));
+    }
+
+    bool DistrictBuilder::has_road_direction(
+        const RoadGrid& roads,
+        const glm::ivec2& position,
+        RoadDirection direction) {
+        const auto road = roads.find(position);
+        return road != nullptr && road->direction == direction;
+    }
+
+    void DistrictBuilder::set_road_directions_and_traversability(
+        RandomGenerator& rng,
+        RoadGrid& roads,
+        const std::vector<glm::ivec4>& non_edge_partitions) {
+        // Set direction and mesh based on neighboring roads
+        roads.for_each([&](const glm::ivec2& position, DistrictRoad& road) {
+            const auto left_neighbor = position + glm::ivec2(-1, 0);
+            const auto right_neighbor = position + glm::ivec2(1, 0);
+            const auto up_neighbor = position + glm::ivec2(0, -1);
+            const auto down_neighbor = position + glm::ivec2(0, 1);
+            if (has_road_direction(roads, left_neighbor, RoadDirection::HORIZONTAL_UP) &&
+                has_road_direction(roads, up_neighbor, RoadDirection::VERTICAL_LEFT)) {
+                road.direction = RoadDirection::CROSSING_UP_LEFT;
+                roads.set_mesh(road, &wfc::GroundPatterns::get_random_crossing_pattern(rng).mesh);
+            }
+            else if (has_road_direction(roads, right_neighbor, RoadDirection::HORIZONTAL_UP) &&
+                has_road_direction(roads, up_neighbor, RoadDirection::VERTICAL_RIGHT)) {
+                road.direction = RoadDirection::CROSSING_UP_RIGHT;
+                roads.set_mesh(road, &wfc::GroundPatterns::get_random_crossing_pattern(rng).mesh);
+            }
+            else if (has_road_direction(roads, left_neighbor, RoadDirection::HORIZONTAL_DOWN) &&
+                has_road_direction(roads, down_neighbor, RoadDirection::VERTICAL_LEFT)) {
+                road.direction = RoadDirection::CROSSING_DOWN_LEFT;
+                roads.set_mesh(road, &wfc::GroundPatterns::get_random_crossing_pattern(rng).mesh);
+            }
+            else if (has_road_direction(roads, right_neighbor, RoadDirection::HORIZONTAL_DOWN) &&
+                has_road_direction(roads, down_neighbor, RoadDirection::VERTICAL_RIGHT)) {
+                road.direction = RoadDirection::CROSSING_DOWN_RIGHT;
+                roads.set_mesh(road, &wfc::GroundPatterns::get_random_crossing_pattern(rng).mesh);
+            }
+        });
+
+        // Set traversability. The easiest way to do this is to set the traversability of all roads to false
+        // earlier during generation and set traversability to true around every non-edge partition.
+        const auto set_traversable = [&roads](const std::vector<glm::ivec2>& neighbors) {
+            for (const auto& neighbor : neighbors) {
+                if (const auto road = roads.find(neighbor); road) {
+                    road->traversable = true;
+                }
+            }
+        };
+        for (const auto& partition : non_edge_partitions) {
+            std::vector<glm::ivec2> neighbors;
+            for (int x = partition.x - 2; x < partition.z + 2; ++x) {
+                neighbors.emplace_back(glm::ivec2(x, partition.y - 1));
+                neighbors.emplace_back(glm::ivec2(x, partition.y - 2));
+                neighbors.emplace_back(glm::ivec2(x, partition.w));
+                neighbors.emplace_back(glm::ivec2(x, partition.w + 1));
+            }
+            for (int y = partition.y - 2; y < partition.w + 2; ++y) {
+                neighbors.emplace_back(glm::ivec2(partition.x - 1, y));
+                neighbors.emplace_back(glm::ivec2(partition.x - 2, y));
+                neighbors.emplace_back(glm::ivec2(partition.z, y));
+                neighbors.emplace_back(glm::ivec2(partition.z + 1, y));
+            }
+            set_traversable(neighbors);
+        }
+    }
+
+}
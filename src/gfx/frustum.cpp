@@ -86,6 +86,32 @@ namespace inf::gfx {
         return true;
     }
 
+    std::array<glm::vec4, 6> Frustum::extract_planes(const glm::mat4& matrix) {
+        // Rows of the matrix (glm matrices are column-major), see Gribb & Hartmann: Fast Extraction of Viewing Frustum Planes
+        const auto row = [&matrix](glm::length_t i) { return glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]); };
+        std::array<glm::vec4, 6> result{
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(2),
+            row(3) - row(2)
+        };
+        for (auto& plane : result) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return result;
+    }
+
+    bool Frustum::is_sphere_inside(const std::array<glm::vec4, 6>& planes, const glm::vec3& center, float radius) {
+        for (const auto& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     std::array<glm::vec3, 8> Frustum::extract_points(const glm::mat4& matrix) {
         static constexpr std::array<glm::vec4, 8> ndc_points = {
             // Near plane
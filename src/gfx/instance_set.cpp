@@ -0,0 +1,42 @@
+#include "gfx/instance_set.h"
+#include "gfx/renderer.h"
+
+#include <utility>
+
+namespace inf::gfx {
+
+    InstanceSet::InstanceSet() : renderer(nullptr), id(0) {}
+
+    InstanceSet::InstanceSet(Renderer* renderer, std::uint32_t id) : renderer(renderer), id(id) {}
+
+    InstanceSet::~InstanceSet() {
+        reset();
+    }
+
+    InstanceSet::InstanceSet(InstanceSet&& other) :
+        renderer(std::exchange(other.renderer, nullptr)),
+        id(std::exchange(other.id, 0)) {}
+
+    InstanceSet& InstanceSet::operator=(InstanceSet&& other) {
+        if (this != &other) {
+            reset();
+            renderer = std::exchange(other.renderer, nullptr);
+            id = std::exchange(other.id, 0);
+        }
+        return *this;
+    }
+
+    void InstanceSet::update(const std::vector<glm::vec3>& positions, const std::vector<float>& rotations) {
+        if (renderer) {
+            renderer->update_instance_set(id, positions, rotations);
+        }
+    }
+
+    void InstanceSet::reset() {
+        if (renderer) {
+            renderer->destroy_instance_set(id);
+            renderer = nullptr;
+        }
+    }
+
+}
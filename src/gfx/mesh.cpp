@@ -2,6 +2,7 @@
 #include "gfx/vk/vertex.h"
 
 #include <array>
+#include <utility>
 
 namespace inf::gfx {
 
@@ -10,17 +11,72 @@ namespace inf::gfx {
         std::size_t num_vertices,
         const glm::mat4& model_matrix,
         const BoundingBox3D& bounding_box) :
+        Mesh(std::make_shared<vk::MappedBuffer>(std::move(buffer)), 0, num_vertices, model_matrix, bounding_box) {}
+
+    Mesh::Mesh(
+        vk::MappedBuffer&& buffer,
+        vk::MappedBuffer&& index_buffer,
+        std::size_t num_vertices,
+        std::size_t num_indices,
+        const glm::mat4& model_matrix,
+        const BoundingBox3D& bounding_box) :
+        Mesh(
+            std::make_shared<vk::MappedBuffer>(std::move(buffer)), 0, num_vertices,
+            std::make_shared<vk::MappedBuffer>(std::move(index_buffer)), 0, num_indices,
+            model_matrix, bounding_box) {}
+
+    Mesh::Mesh(
+        std::shared_ptr<vk::MappedBuffer> buffer,
+        std::uint32_t first_vertex,
+        std::size_t num_vertices,
+        const glm::mat4& model_matrix,
+        const BoundingBox3D& bounding_box) :
+        Mesh(std::move(buffer), first_vertex, num_vertices, nullptr, 0, 0, model_matrix, bounding_box) {}
+
+    Mesh::Mesh(
+        std::shared_ptr<vk::MappedBuffer> buffer,
+        std::uint32_t first_vertex,
+        std::size_t num_vertices,
+        std::shared_ptr<vk::MappedBuffer> index_buffer,
+        std::uint32_t first_index,
+        std::size_t num_indices,
+        const glm::mat4& model_matrix,
+        const BoundingBox3D& bounding_box) :
         buffer(std::move(buffer)),
+        first_vertex(first_vertex),
         num_vertices(num_vertices),
+        index_buffer(std::move(index_buffer)),
+        first_index(first_index),
+        num_indices(num_indices),
         model_matrix(model_matrix),
         bounding_box(bounding_box) {}
-    
+
     std::size_t Mesh::get_number_of_vertices() const {
         return num_vertices;
     }
 
+    bool Mesh::is_indexed() const {
+        return index_buffer != nullptr;
+    }
+
+    const vk::MappedBuffer& Mesh::get_index_buffer() const {
+        return *index_buffer;
+    }
+
+    std::uint32_t Mesh::get_first_index() const {
+        return first_index;
+    }
+
+    std::size_t Mesh::get_number_of_indices() const {
+        return num_indices;
+    }
+
     const vk::MappedBuffer& Mesh::get_buffer() const {
-        return buffer;
+        return *buffer;
+    }
+
+    std::uint32_t Mesh::get_first_vertex() const {
+        return first_vertex;
     }
 
     const glm::mat4& Mesh::get_model_matrix() const {
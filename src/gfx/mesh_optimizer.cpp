@@ -0,0 +1,263 @@
+#include "gfx/mesh_optimizer.h"
+
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <array>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+namespace inf::gfx {
+
+    static constexpr float CACHE_DECAY_POWER = 1.5f;
+    static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    // Score of a vertex by its position in the simulated cache and its number of triangles that are not emitted yet
+    static float compute_vertex_score(int cache_position, std::uint32_t num_remaining_triangles) {
+        if (num_remaining_triangles == 0) {
+            return -1.0f;
+        }
+        float score = 0.0f;
+        if (cache_position >= 0) {
+            // The vertices of the last triangle get a fixed score, so that the strip does not turn back on itself
+            if (cache_position < 3) {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else {
+                const auto scaler = 1.0f / static_cast<float>(MeshOptimizer::VERTEX_CACHE_SIZE - 3);
+                score = std::pow(1.0f - static_cast<float>(cache_position - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+        // Vertices with few triangles left are preferred, so that they do not get stranded
+        return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(num_remaining_triangles), -VALENCE_BOOST_POWER);
+    }
+
+    void MeshOptimizer::optimize_vertex_cache(std::vector<std::uint32_t>& indices, std::size_t num_vertices) {
+        const auto num_triangles = indices.size() / 3;
+        if (num_triangles == 0) {
+            return;
+        }
+
+        // Triangles that use each vertex, the ones that have not been emitted are kept at the front of each range
+        std::vector<std::uint32_t> triangle_offsets(num_vertices + 1, 0);
+        for (const auto index : indices) {
+            ++triangle_offsets[index + 1];
+        }
+        std::vector<std::uint32_t> num_remaining_triangles(num_vertices);
+        for (std::size_t i = 0; i < num_vertices; ++i) {
+            num_remaining_triangles[i] = triangle_offsets[i + 1];
+            triangle_offsets[i + 1] += triangle_offsets[i];
+        }
+        std::vector<std::uint32_t> vertex_triangles(indices.size());
+        std::vector<std::uint32_t> fill_offsets(triangle_offsets.cbegin(), triangle_offsets.cend() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            vertex_triangles[fill_offsets[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+        }
+
+        std::vector<int> cache_positions(num_vertices, -1);
+        std::vector<float> vertex_scores(num_vertices);
+        for (std::size_t i = 0; i < num_vertices; ++i) {
+            vertex_scores[i] = compute_vertex_score(-1, num_remaining_triangles[i]);
+        }
+        std::vector<float> triangle_scores(num_triangles);
+        for (std::size_t i = 0; i < num_triangles; ++i) {
+            triangle_scores[i] = vertex_scores[indices[i * 3]] + vertex_scores[indices[i * 3 + 1]] + vertex_scores[indices[i * 3 + 2]];
+        }
+        std::vector<bool> emitted(num_triangles, false);
+
+        std::vector<std::uint32_t> result;
+        result.reserve(indices.size());
+        std::vector<std::uint32_t> cache;
+        std::vector<std::uint32_t> new_cache;
+        auto best_triangle = static_cast<std::size_t>(
+            std::max_element(triangle_scores.cbegin(), triangle_scores.cend()) - triangle_scores.cbegin());
+        std::size_t num_emitted = 0;
+        std::size_t next_unemitted = 0;
+        while (true) {
+            const std::array<std::uint32_t, 3> triangle{
+                indices[best_triangle * 3], indices[best_triangle * 3 + 1], indices[best_triangle * 3 + 2]
+            };
+            result.insert(result.end(), triangle.cbegin(), triangle.cend());
+            emitted[best_triangle] = true;
+            if (++num_emitted == num_triangles) {
+                break;
+            }
+
+            // Remove the triangle from the triangles of its vertices
+            for (const auto vertex : triangle) {
+                const auto begin = vertex_triangles.begin() + triangle_offsets[vertex];
+                const auto end = begin + num_remaining_triangles[vertex];
+                std::iter_swap(std::find(begin, end, static_cast<std::uint32_t>(best_triangle)), end - 1);
+                --num_remaining_triangles[vertex];
+            }
+
+            // The vertices of the triangle move to the front of the cache, the ones that fall off it are evicted
+            new_cache.clear();
+            for (const auto vertex : triangle) {
+                if (std::find(new_cache.cbegin(), new_cache.cend(), vertex) == new_cache.cend()) {
+                    new_cache.emplace_back(vertex);
+                }
+            }
+            for (const auto vertex : cache) {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                    new_cache.emplace_back(vertex);
+                }
+            }
+            for (std::size_t i = 0; i < new_cache.size(); ++i) {
+                cache_positions[new_cache[i]] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+            }
+            if (new_cache.size() > VERTEX_CACHE_SIZE) {
+                new_cache.resize(VERTEX_CACHE_SIZE);
+            }
+
+            // Only the triangles of the vertices in the cache change their scores, the best one is chosen among them
+            auto best_score = -std::numeric_limits<float>::max();
+            best_triangle = num_triangles;
+            for (const auto vertex : cache) {
+                if (cache_positions[vertex] < 0) {
+                    // Evicted vertices lose their cache score
+                    const auto score = compute_vertex_score(-1, num_remaining_triangles[vertex]);
+                    const auto delta = score - vertex_scores[vertex];
+                    vertex_scores[vertex] = score;
+                    for (std::uint32_t i = 0; i < num_remaining_triangles[vertex]; ++i) {
+                        triangle_scores[vertex_triangles[triangle_offsets[vertex] + i]] += delta;
+                    }
+                }
+            }
+            for (const auto vertex : new_cache) {
+                const auto score = compute_vertex_score(cache_positions[vertex], num_remaining_triangles[vertex]);
+                const auto delta = score - vertex_scores[vertex];
+                vertex_scores[vertex] = score;
+                for (std::uint32_t i = 0; i < num_remaining_triangles[vertex]; ++i) {
+                    const auto triangle_index = vertex_triangles[triangle_offsets[vertex] + i];
+                    triangle_scores[triangle_index] += delta;
+                }
+            }
+            for (const auto vertex : new_cache) {
+                for (std::uint32_t i = 0; i < num_remaining_triangles[vertex]; ++i) {
+                    const auto triangle_index = vertex_triangles[triangle_offsets[vertex] + i];
+                    if (triangle_scores[triangle_index] > best_score) {
+                        best_score = triangle_scores[triangle_index];
+                        best_triangle = triangle_index;
+                    }
+                }
+            }
+            std::swap(cache, new_cache);
+
+            // None of the cached vertices have triangles left, continue with any triangle that has not been emitted
+            if (best_triangle == num_triangles) {
+                while (emitted[next_unemitted]) {
+                    ++next_unemitted;
+                }
+                best_triangle = next_unemitted;
+            }
+        }
+        indices = std::move(result);
+    }
+
+    float MeshOptimizer::compute_acmr(const std::vector<std::uint32_t>& indices, std::size_t cache_size) {
+        const auto num_triangles = indices.size() / 3;
+        if (num_triangles == 0) {
+            return 0.0f;
+        }
+        std::deque<std::uint32_t> cache;
+        std::size_t num_misses = 0;
+        for (const auto index : indices) {
+            if (std::find(cache.cbegin(), cache.cend(), index) != cache.cend()) {
+                continue;
+            }
+            ++num_misses;
+            cache.emplace_back(index);
+            if (cache.size() > cache_size) {
+                cache.pop_front();
+            }
+        }
+        return static_cast<float>(num_misses) / static_cast<float>(num_triangles);
+    }
+
+    std::uint64_t MeshOptimizer::hash_bytes(const void* data, std::size_t size) {
+        // FNV-1a
+        std::uint64_t hash = 14695981039346656037ull;
+        const auto bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    void MeshOptimizer::reorder_clusters(const std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices) {
+        const auto num_triangles = indices.size() / 3;
+        const auto num_clusters = (num_triangles + OVERDRAW_CLUSTER_SIZE - 1) / OVERDRAW_CLUSTER_SIZE;
+        if (num_clusters < 2) {
+            return;
+        }
+
+        // Area weighted normal and centroid of every cluster, and the centroid of the whole mesh
+        std::vector<glm::vec3> cluster_normals(num_clusters, glm::vec3(0.0f));
+        std::vector<glm::vec3> cluster_centroids(num_clusters, glm::vec3(0.0f));
+        std::vector<float> cluster_areas(num_clusters, 0.0f);
+        glm::vec3 mesh_centroid(0.0f);
+        float mesh_area = 0.0f;
+        for (std::size_t i = 0; i < num_triangles; ++i) {
+            const auto& a = positions[indices[i * 3]];
+            const auto& b = positions[indices[i * 3 + 1]];
+            const auto& c = positions[indices[i * 3 + 2]];
+            const auto normal = glm::cross(b - a, c - a);
+            const auto area = glm::length(normal);
+            const auto centroid = (a + b + c) / 3.0f;
+            const auto cluster = i / OVERDRAW_CLUSTER_SIZE;
+            cluster_normals[cluster] += normal;
+            cluster_centroids[cluster] += centroid * area;
+            cluster_areas[cluster] += area;
+            mesh_centroid += centroid * area;
+            mesh_area += area;
+        }
+        if (mesh_area > 0.0f) {
+            mesh_centroid /= mesh_area;
+        }
+
+        // Clusters that face away from the center are more likely to occlude the rest of the mesh
+        std::vector<float> cluster_scores(num_clusters, 0.0f);
+        for (std::size_t i = 0; i < num_clusters; ++i) {
+            if (cluster_areas[i] <= 0.0f) {
+                continue;
+            }
+            const auto normal_length = glm::length(cluster_normals[i]);
+            if (normal_length > 0.0f) {
+                const auto centroid = cluster_centroids[i] / cluster_areas[i];
+                cluster_scores[i] = glm::dot(centroid - mesh_centroid, cluster_normals[i] / normal_length);
+            }
+        }
+        std::vector<std::size_t> cluster_order(num_clusters);
+        std::iota(cluster_order.begin(), cluster_order.end(), 0);
+        std::stable_sort(cluster_order.begin(), cluster_order.end(), [&cluster_scores](std::size_t a, std::size_t b) {
+            return cluster_scores[a] > cluster_scores[b];
+        });
+
+        std::vector<std::uint32_t> result;
+        result.reserve(indices.size());
+        for (const auto cluster : cluster_order) {
+            const auto begin = indices.cbegin() + cluster * OVERDRAW_CLUSTER_SIZE * 3;
+            const auto end = indices.cbegin() + std::min((cluster + 1) * OVERDRAW_CLUSTER_SIZE, num_triangles) * 3;
+            result.insert(result.end(), begin, end);
+        }
+        indices = std::move(result);
+    }
+
+    std::vector<std::uint32_t> MeshOptimizer::compute_fetch_remap(const std::vector<std::uint32_t>& indices, std::size_t num_vertices) {
+        std::vector<std::uint32_t> result(num_vertices, std::numeric_limits<std::uint32_t>::max());
+        std::uint32_t next_index = 0;
+        for (const auto index : indices) {
+            if (result[index] == std::numeric_limits<std::uint32_t>::max()) {
+                result[index] = next_index++;
+            }
+        }
+        return result;
+    }
+
+}
@@ -1,6 +1,8 @@
 #include "gfx/renderer.h"
 #include "gfx/vk/vertex.h"
 #include "gfx/frustum.h"
+#include "gfx/instance_batch.h"
+#include "gfx/shadow_cascades.h"
 #include "utils/file_utils.h"
 
 #include <imgui.h>
@@ -10,17 +12,32 @@
 #include <magic_enum.hpp>
 
 #include <limits>
+#include <thread>
+#include <cstring>
+#include <algorithm>
 #include <stdexcept>
 
 namespace inf::gfx {
 
-    static constexpr std::uint32_t SHADOW_MAP_RESOLUTION_X = 4096;
-    static constexpr std::uint32_t SHADOW_MAP_RESOLUTION_Y = 4096;
-    static constexpr VkExtent2D SHADOW_MAP_EXTENT{ SHADOW_MAP_RESOLUTION_X, SHADOW_MAP_RESOLUTION_Y };
+    // Casters are included up to this distance beyond the slices of the camera frustum towards the sun
+    static constexpr float SHADOW_CASTER_DISTANCE = 50.0f;
+    // Cached cascades are enlarged by this fraction of their radius, so they can be reused while the camera moves a bit
+    static constexpr float SHADOW_CACHE_MARGIN = 0.25f;
+    // Cached cascades are fit again once the sun moved by this angle
+    static constexpr float SHADOW_CACHE_LIGHT_THRESHOLD = glm::radians(0.5f);
     static constexpr std::uint64_t INSTANCE_DATA_BUFFER_SIZE_INITIAL_BYTES = 4 * 1024 * 1024; // 4MBs
+    static constexpr std::uint64_t INSTANCE_DATA_ALIGNMENT = 16;
+    // Individual meshes of the color pass are recorded in chunks of this size, so many vehicles are spread over the workers
+    static constexpr std::size_t MESHES_PER_RECORDING_JOB = 128;
 
     Renderer::Renderer(Context& context, const Window& window, const Camera& camera, const Timer& timer) :
-        context(context), camera(camera), timer(timer), image_index(0), frame_index(0) {
+        context(context), camera(camera), timer(timer), image_index(0), frame_index(0),
+        shadow_cascade_resolution(static_cast<std::uint32_t>(std::clamp(
+            context.shadow_cascade_resolution, Context::SHADOW_CASCADE_RESOLUTION_MIN, Context::SHADOW_CASCADE_RESOLUTION_MAX))),
+        recording_thread_pool(std::max(std::thread::hardware_concurrency(), 1u)),
+        static_light_direction(0.0f), static_cascades_dirty{}, static_retained_version(0),
+        next_instance_set_id(1), retained_dirty(false), retained_version(0), num_shadow_draw_calls(0), num_color_draw_calls(0),
+        shadow_caster_statistics{}, previous_shadow_caster_statistics{}, num_static_cascades_rendered(0) {
         if (!gladLoaderLoadVulkan(VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE)) {
             throw std::runtime_error("Failed to load Vulkan function pointers.");
         }
@@ -45,6 +62,10 @@ namespace inf::gfx {
             const auto fragment_shader_bytes = utils::FileUtils::read_bytes("assets/shaders/default.frag.bin");
             shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::FRAGMENT, fragment_shader_bytes));
 
+            const auto bounding_box_vs_bytes = utils::FileUtils::read_bytes("assets/shaders/bounding_box.vert.bin");
+            bounding_box_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::VERTEX, bounding_box_vs_bytes));
+            bounding_box_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::FRAGMENT, fragment_shader_bytes));
+
             const auto instanced_vs_shader_bytes = utils::FileUtils::read_bytes("assets/shaders/instanced.vert.bin");
             instanced_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::VERTEX, instanced_vs_shader_bytes));
             
@@ -61,22 +82,29 @@ namespace inf::gfx {
             shadow_map_instanced_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::VERTEX, shadow_map_instanced_vs_bytes));
             shadow_map_instanced_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::FRAGMENT, shadow_map_fs_bytes));
 
+            const auto building_vs_bytes = utils::FileUtils::read_bytes("assets/shaders/building.vert.bin");
+            building_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::VERTEX, building_vs_bytes));
+            building_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::FRAGMENT, instanced_fs_shader_bytes));
+
             const auto rain_shader_vs_bytes = utils::FileUtils::read_bytes("assets/shaders/rain.vert.bin");
             const auto rain_shader_fs_bytes = utils::FileUtils::read_bytes("assets/shaders/rain.frag.bin");
             particle_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::VERTEX, rain_shader_vs_bytes));
             particle_shaders.emplace_back(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::FRAGMENT, rain_shader_fs_bytes));
+
+            const auto culling_shader_bytes = utils::FileUtils::read_bytes("assets/shaders/cull_instances.comp.bin");
+            culling_shader = std::make_unique<vk::Shader>(vk::Shader::create_from_bytes(logical_device.get(), vk::ShaderType::COMPUTE, culling_shader_bytes));
         }
 
-        // Create descriptor pool and set layouts for shader uniform data
-        descriptor_pool = std::make_unique<vk::DescriptorPool>(vk::DescriptorPool::create(logical_device.get(), 10));
+        // Create descriptor pool and set layouts for shader uniform data, the fragment shaders pick the shadow cascades from the uniform data
+        descriptor_pool = std::make_unique<vk::DescriptorPool>(vk::DescriptorPool::create(logical_device.get(), 24));
         descriptor_set_layout = std::make_unique<vk::DescriptorSetLayout>(vk::DescriptorSetLayout::create(
             logical_device.get(), {
-                VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+                VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
                 VkDescriptorSetLayoutBinding{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
             }));
         instanced_descriptor_set_layout = std::make_unique<vk::DescriptorSetLayout>(vk::DescriptorSetLayout::create(
             logical_device.get(), {
-                VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+                VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
                 VkDescriptorSetLayoutBinding{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
             }));
         shadow_map_descriptor_set_layout = std::make_unique<vk::DescriptorSetLayout>(vk::DescriptorSetLayout::create(
@@ -89,6 +117,20 @@ namespace inf::gfx {
                 VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr }
             }
         ));
+        building_descriptor_set_layout = std::make_unique<vk::DescriptorSetLayout>(vk::DescriptorSetLayout::create(
+            logical_device.get(), {
+                VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+                VkDescriptorSetLayoutBinding{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+                VkDescriptorSetLayoutBinding{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+            }
+        ));
+        culling_descriptor_set_layout = std::make_unique<vk::DescriptorSetLayout>(vk::DescriptorSetLayout::create(
+            logical_device.get(), {
+                VkDescriptorSetLayoutBinding{ 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                VkDescriptorSetLayoutBinding{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                VkDescriptorSetLayoutBinding{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+            }
+        ));
 
         // Create render pass and graphics pipeline
         const auto& swap_chain_extent = swap_chain->get_extent();
@@ -97,11 +139,13 @@ namespace inf::gfx {
         const auto sample_count = is_msaa_4x_supported ? VK_SAMPLE_COUNT_4_BIT : VK_SAMPLE_COUNT_1_BIT;
         render_pass = std::make_unique<vk::RenderPass>(vk::RenderPass::create_render_pass(
             logical_device.get(), swap_chain->get_format(), sample_count));
-        shadow_map_render_pass = std::make_unique<vk::RenderPass>(vk::RenderPass::create_shadow_render_pass(logical_device.get()));
+        shadow_map_render_pass = std::make_unique<vk::RenderPass>(vk::RenderPass::create_shadow_render_pass(logical_device.get(), false));
+        shadow_map_preserving_render_pass = std::make_unique<vk::RenderPass>(
+            vk::RenderPass::create_shadow_render_pass(logical_device.get(), true));
 
         // Create default render pipeline
-        const auto default_binding_description = vk::Vertex::get_default_binding_description();
-        const auto default_attribute_descriptions = vk::Vertex::get_default_attribute_descriptions();
+        const auto default_binding_description = vk::PackedVertex::get_default_binding_description();
+        const auto default_attribute_descriptions = vk::PackedVertex::get_default_attribute_descriptions();
         pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
             logical_device.get(),
             *render_pass,
@@ -113,9 +157,23 @@ namespace inf::gfx {
             sample_count,
             std::nullopt));
 
+        // Debug bounding boxes are in world space, which does not fit into the range of packed vertices
+        const auto bounding_box_binding_description = vk::Vertex::get_default_binding_description();
+        const auto bounding_box_attribute_descriptions = vk::Vertex::get_default_attribute_descriptions();
+        bounding_box_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
+            logical_device.get(),
+            *render_pass,
+            swap_chain->get_extent(),
+            *descriptor_set_layout,
+            bounding_box_shaders,
+            1, &bounding_box_binding_description,
+            static_cast<std::uint32_t>(bounding_box_attribute_descriptions.size()), bounding_box_attribute_descriptions.data(),
+            sample_count,
+            std::nullopt));
+
         // Create instanced render pipeline
-        const auto instanced_binding_descriptions = vk::Vertex::get_instanced_binding_descriptions();
-        const auto instanced_attribute_descriptions = vk::Vertex::get_instanced_attribute_descriptions();
+        const auto instanced_binding_descriptions = vk::PackedVertex::get_instanced_binding_descriptions();
+        const auto instanced_attribute_descriptions = vk::PackedVertex::get_instanced_attribute_descriptions();
         instanced_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
             logical_device.get(),
             *render_pass,
@@ -132,7 +190,7 @@ namespace inf::gfx {
         shadow_map_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
             logical_device.get(),
             *shadow_map_render_pass,
-            SHADOW_MAP_EXTENT,
+            get_shadow_map_extent(),
             *shadow_map_descriptor_set_layout,
             shadow_map_shaders,
             1, &default_binding_description,
@@ -143,7 +201,7 @@ namespace inf::gfx {
         shadow_map_instanced_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
             logical_device.get(),
             *shadow_map_render_pass,
-            SHADOW_MAP_EXTENT,
+            get_shadow_map_extent(),
             *shadow_map_descriptor_set_layout,
             shadow_map_instanced_shaders,
             static_cast<std::uint32_t>(instanced_binding_descriptions.size()), instanced_binding_descriptions.data(),
@@ -151,6 +209,32 @@ namespace inf::gfx {
             VK_SAMPLE_COUNT_1_BIT,
             shadow_map_depth_bias));
 
+        // Create building pipelines (building cells are instances that look up their colors from a palette)
+        const auto building_binding_descriptions = vk::PackedVertex::get_building_binding_descriptions();
+        const auto building_attribute_descriptions = vk::PackedVertex::get_building_attribute_descriptions();
+        building_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
+            logical_device.get(),
+            *render_pass,
+            swap_chain_extent,
+            *building_descriptor_set_layout,
+            building_shaders,
+            static_cast<std::uint32_t>(building_binding_descriptions.size()), building_binding_descriptions.data(),
+            static_cast<std::uint32_t>(building_attribute_descriptions.size()), building_attribute_descriptions.data(),
+            sample_count,
+            std::nullopt));
+
+        // The palette is not needed for the shadow map, so it reuses the instanced shadow map shaders
+        shadow_map_building_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_pipeline(
+            logical_device.get(),
+            *shadow_map_render_pass,
+            get_shadow_map_extent(),
+            *shadow_map_descriptor_set_layout,
+            shadow_map_instanced_shaders,
+            static_cast<std::uint32_t>(building_binding_descriptions.size()), building_binding_descriptions.data(),
+            static_cast<std::uint32_t>(building_attribute_descriptions.size()), building_attribute_descriptions.data(),
+            VK_SAMPLE_COUNT_1_BIT,
+            shadow_map_depth_bias));
+
         // Create pipeline for rain effects
         std::array<VkVertexInputBindingDescription, 2> particle_binding_descriptions;
         particle_binding_descriptions[0].binding = 0;
@@ -181,6 +265,13 @@ namespace inf::gfx {
             sample_count,
             std::nullopt));
 
+        // Create the compute pipeline that culls retained instances and fills their indirect draw commands
+        culling_pipeline = std::make_unique<vk::Pipeline>(vk::Pipeline::create_compute_pipeline(
+            logical_device.get(),
+            *culling_descriptor_set_layout,
+            *culling_shader,
+            sizeof(CullingPushConstants)));
+
         // Create a separate color image if necessary because of multisampling
         // If not necessary (sample count = 1), we use the swapchain image instead.
         if (sample_count > VK_SAMPLE_COUNT_1_BIT) {
@@ -202,19 +293,14 @@ namespace inf::gfx {
             logical_device.get(), memory_allocator.get(), swap_chain_extent, sample_count, false));
         const auto& depth_image_view = depth_buffer->get_image_view();
 
-        // Create a separate depth buffer for the shadow map that will be sampled during the second render pass
-        shadow_map_depth_buffer = std::make_unique<vk::DepthBuffer>(vk::DepthBuffer::create(
-            logical_device.get(), memory_allocator.get(), SHADOW_MAP_EXTENT, VK_SAMPLE_COUNT_1_BIT, true));
-
         // Create framebuffers for swapchain images
         for (const auto& image_view : swap_chain->get_image_views()) {
             framebuffers.emplace_back(vk::Framebuffer::create_from_image_view(
                 logical_device.get(), *render_pass, image_view, depth_image_view, color_image_view.get(), swap_chain_extent));
         }
 
-        // Create framebuffers for the shadow map
-        shadow_map_framebuffer = std::make_unique<vk::Framebuffer>(vk::Framebuffer::create_for_shadow_map(
-            logical_device.get(), *shadow_map_render_pass, shadow_map_depth_buffer->get_image_view(), SHADOW_MAP_EXTENT));
+        // Create the shadow map atlases and their framebuffers
+        create_shadow_maps();
 
         // Create a sampler for the shadow map
         shadow_map_sampler = std::make_unique<vk::Sampler>(vk::Sampler::create(logical_device.get()));
@@ -224,22 +310,24 @@ namespace inf::gfx {
         command_pool = std::make_unique<vk::CommandPool>(vk::CommandPool::create_command_pool(logical_device.get(), physical_device->get_queue_family_indices()));
         for (std::uint8_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             command_buffers.emplace_back(command_pool->allocate_buffer());
+            recording_contexts.emplace_back();
             image_available_semaphores.emplace_back(vk::Semaphore::create(logical_device.get()));
             render_finished_semaphores.emplace_back(vk::Semaphore::create(logical_device.get()));
             in_flight_fences.emplace_back(vk::Fence::create(logical_device.get(), true));
             uniform_buffers.emplace_back(vk::MappedBuffer::create(
                 logical_device.get(), memory_allocator.get(), vk::BufferType::UNIFORM_BUFFER, sizeof(Matrices)));
-            instanced_data_buffers.emplace_back(vk::MappedBuffer::create(
-                logical_device.get(), memory_allocator.get(), vk::BufferType::VERTEX_BUFFER, INSTANCE_DATA_BUFFER_SIZE_INITIAL_BYTES));
-            instanced_shadow_data_buffers.emplace_back(vk::MappedBuffer::create(
-                logical_device.get(), memory_allocator.get(), vk::BufferType::VERTEX_BUFFER, INSTANCE_DATA_BUFFER_SIZE_INITIAL_BYTES));
-            particle_data_buffers.emplace_back(vk::MappedBuffer::create(
-                logical_device.get(), memory_allocator.get(), vk::BufferType::VERTEX_BUFFER, INSTANCE_DATA_BUFFER_SIZE_INITIAL_BYTES));
-            shadow_map_uniform_buffers.emplace_back(vk::MappedBuffer::create(
-                logical_device.get(), memory_allocator.get(), vk::BufferType::UNIFORM_BUFFER, sizeof(Matrices)));
+            for (std::size_t j = 0; j < ShadowCascades::MAX_CASCADES; ++j) {
+                shadow_map_uniform_buffers.emplace_back(vk::MappedBuffer::create(
+                    logical_device.get(), memory_allocator.get(), vk::BufferType::UNIFORM_BUFFER, sizeof(Matrices)));
+            }
             particle_uniform_buffers.emplace_back(vk::MappedBuffer::create(
                 logical_device.get(), memory_allocator.get(), vk::BufferType::UNIFORM_BUFFER, sizeof(ParticleMatrices)));
         }
+        // Per-frame instance data of every pass is sub-allocated from a single ring shared by the frames in flight
+        instance_data_ring = std::make_unique<vk::RingBuffer>(
+            logical_device.get(), memory_allocator.get(), vk::BufferType::VERTEX_INDIRECT_BUFFER, INSTANCE_DATA_BUFFER_SIZE_INITIAL_BYTES, MAX_FRAMES_IN_FLIGHT);
+        // Culling buffers are created once there are retained instances to cull
+        culling_buffers.resize(MAX_FRAMES_IN_FLIGHT);
 
         // Allocate descriptor sets for the uniform buffers and the shadow map sampler
         std::vector<VkBuffer> uniform_buffer_handles(uniform_buffers.size());
@@ -323,28 +411,101 @@ namespace inf::gfx {
         return *memory_allocator;
     }
 
+    void Renderer::set_building_palette(const std::vector<glm::vec4>& palette) {
+        if (palette.empty()) {
+            throw std::runtime_error("Building palette must not be empty.");
+        }
+        if (building_palette_buffer) {
+            throw std::runtime_error("Building palette has already been set.");
+        }
+        const auto num_bytes = palette.size() * sizeof(glm::vec4);
+        building_palette_buffer = std::make_unique<vk::MappedBuffer>(vk::MappedBuffer::create(
+            logical_device.get(), memory_allocator.get(), vk::BufferType::STORAGE_BUFFER, num_bytes));
+        building_palette_buffer->upload(palette.data(), num_bytes);
+
+        // Building descriptor sets are the same as the instanced ones with the palette added
+        std::vector<VkDescriptorBufferInfo> buffer_infos(uniform_buffers.size());
+        std::vector<VkDescriptorBufferInfo> palette_buffer_infos(uniform_buffers.size());
+        std::vector<VkDescriptorImageInfo> image_infos(uniform_buffers.size());
+        std::vector<std::vector<VkWriteDescriptorSet>> write_descriptor_sets(uniform_buffers.size());
+        for (std::size_t i = 0; i < uniform_buffers.size(); ++i) {
+            auto& buffer_info = buffer_infos[i];
+            buffer_info = {};
+            buffer_info.buffer = uniform_buffers[i].get_buffer();
+            buffer_info.offset = 0;
+            buffer_info.range = VK_WHOLE_SIZE;
+            write_descriptor_sets[i].emplace_back(gfx::vk::WriteDescriptorSet::create_for_buffer(buffer_info, 0));
+            auto& image_info = image_infos[i];
+            image_info = {};
+            image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            image_info.imageView = shadow_map_depth_buffer->get_image_view().get_image_view();
+            image_info.sampler = shadow_map_sampler->get_sampler();
+            write_descriptor_sets[i].emplace_back(gfx::vk::WriteDescriptorSet::create_for_sampler(image_info, 1));
+            auto& palette_buffer_info = palette_buffer_infos[i];
+            palette_buffer_info = {};
+            palette_buffer_info.buffer = building_palette_buffer->get_buffer();
+            palette_buffer_info.offset = 0;
+            palette_buffer_info.range = VK_WHOLE_SIZE;
+            write_descriptor_sets[i].emplace_back(gfx::vk::WriteDescriptorSet::create_for_storage_buffer(palette_buffer_info, 2));
+        }
+        building_descriptor_sets = descriptor_pool->allocate_sets(
+            *building_descriptor_set_layout, write_descriptor_sets, static_cast<std::uint32_t>(uniform_buffers.size()));
+    }
+
     void Renderer::begin_frame(
         Weather world_weather,
         RainIntensity world_rain_intensity,
         std::size_t num_districts,
-        std::size_t num_buildings) {
+        std::size_t num_buildings,
+        const utils::CacheStatistics& district_cache_statistics) {
+        meshes_to_render.clear();
         shadow_casters_to_render.clear();
         instanced_non_casters_to_render.clear();
         instanced_casters_to_render.clear();
         bounding_boxes_to_render.clear();
         particles_to_render.clear();
+        buildings_to_render.clear();
+        building_casters_to_render.clear();
+        previous_shadow_caster_statistics = shadow_caster_statistics;
+        shadow_caster_statistics = {};
+        // The caster volume has to be known before the meshes of the frame are submitted
+        update_shadows();
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         if (context.show_diagnostics) {
             ImGui::Begin("Diagnostics");
-            ImVec2 window_size(400, 350);
+            ImVec2 window_size(400, 375);
 
             // Performance data
             ImGui::Text("FPS: %d", timer.get_fps());
             ImGui::Text("Districts: %d", static_cast<int>(num_districts));
             ImGui::Text("Buildings: %d", static_cast<int>(num_buildings));
+            const auto ring_statistics = instance_data_ring->get_statistics();
+            ImGui::Text(
+                "Instance data: %.1f / %.1f MiB (peak: %.1f MiB)",
+                ring_statistics.used / (1024.0 * 1024.0),
+                ring_statistics.capacity / (1024.0 * 1024.0),
+                ring_statistics.high_water_mark / (1024.0 * 1024.0));
+            ImGui::Text(
+                "Draw calls: %d (shadow pass: %d)",
+                static_cast<int>(num_shadow_draw_calls + num_color_draw_calls),
+                static_cast<int>(num_shadow_draw_calls));
+            ImGui::Text("Retained instances (culled on the GPU): %d", static_cast<int>(retained_data.size()));
+            ImGui::Text(
+                "Shadow casters: %d drawn, %d culled",
+                static_cast<int>(previous_shadow_caster_statistics.drawn),
+                static_cast<int>(previous_shadow_caster_statistics.culled));
+            ImGui::Text("Static shadow cascades rendered: %d", static_cast<int>(num_static_cascades_rendered));
+            ImGui::Text(
+                "Cached districts: %d (%.1f MiB)",
+                static_cast<int>(district_cache_statistics.num_entries),
+                district_cache_statistics.cost / (1024.0 * 1024.0));
+            ImGui::Text(
+                "District cache hits: %d, misses: %d",
+                static_cast<int>(district_cache_statistics.hits),
+                static_cast<int>(district_cache_statistics.misses));
 
             // Camera data
             const auto format_vec3 = [](const glm::vec3& vec) {
@@ -356,6 +517,38 @@ namespace inf::gfx {
             ImGui::Text("Camera position: %s", position.c_str());
             ImGui::Text("Camera direction: %s", direction.c_str());
             ImGui::SliderFloat("Camera speed", &context.camera_speed, Context::CAMERA_SPEED_MIN, Context::CAMERA_SPEED_MAX);
+            ImGui::SliderFloat(
+                "Prefetch horizon",
+                &context.prefetch_horizon_seconds,
+                Context::PREFETCH_HORIZON_SECONDS_MIN,
+                Context::PREFETCH_HORIZON_SECONDS_MAX,
+                "%.3f seconds");
+            ImGui::SliderFloat("Prefetch margin", &context.prefetch_margin, Context::PREFETCH_MARGIN_MIN, Context::PREFETCH_MARGIN_MAX);
+            ImGui::SliderFloat("Eviction margin", &context.eviction_margin, Context::EVICTION_MARGIN_MIN, Context::EVICTION_MARGIN_MAX);
+            ImGui::Checkbox("Background generation", &context.background_generation);
+            ImGui::Checkbox("Parallel command recording", &context.parallel_command_recording);
+            ImGui::SliderFloat(
+                "Generation budget",
+                &context.generation_budget_milliseconds,
+                Context::GENERATION_BUDGET_MILLISECONDS_MIN,
+                Context::GENERATION_BUDGET_MILLISECONDS_MAX,
+                "%.1f ms");
+
+            // Shadows
+            ImGui::Separator();
+            ImGui::SliderInt("Shadow cascades", &context.shadow_cascades, Context::SHADOW_CASCADES_MIN, Context::SHADOW_CASCADES_MAX);
+            ImGui::SliderFloat("Shadow distance", &context.shadow_distance, Context::SHADOW_DISTANCE_MIN, Context::SHADOW_DISTANCE_MAX);
+            ImGui::SliderFloat(
+                "Shadow split lambda",
+                &context.shadow_split_lambda,
+                Context::SHADOW_SPLIT_LAMBDA_MIN,
+                Context::SHADOW_SPLIT_LAMBDA_MAX);
+            ImGui::SliderInt(
+                "Shadow cascade resolution",
+                &context.shadow_cascade_resolution,
+                Context::SHADOW_CASCADE_RESOLUTION_MIN,
+                Context::SHADOW_CASCADE_RESOLUTION_MAX);
+            ImGui::Checkbox("Cache shadows", &context.cache_shadows);
 
             // Time of day
             ImGui::Separator();
@@ -446,13 +639,81 @@ namespace inf::gfx {
             // Development features
             ImGui::Separator();
             ImGui::Checkbox("Show debug BBs", &context.show_debug_bbs);
+            const std::string wfc_solver_str(magic_enum::enum_name(context.wfc_solver));
+            if (ImGui::BeginCombo("WFC solver", wfc_solver_str.c_str())) {
+                for (std::size_t i = 0; i < magic_enum::enum_count<wfc::WfcSolver>(); ++i) {
+                    const auto enum_member = magic_enum::enum_value<wfc::WfcSolver>(i);
+                    std::string enum_name(magic_enum::enum_name(enum_member));
+                    bool is_selected = enum_member == context.wfc_solver;
+                    if (ImGui::Selectable(enum_name.c_str(), is_selected)) {
+                        context.wfc_solver = enum_member;
+                    }
+                    if (is_selected) {
+                        ImGui::SetItemDefaultFocus();
+                    }
+                }
+                ImGui::EndCombo();
+            }
             ImGui::SetWindowSize({ window_size.x, window_size.y });
             ImGui::End();
         }
     }
 
+    InstanceSet Renderer::create_instance_set(
+        const Mesh& mesh,
+        bool shadow_caster,
+        const std::vector<glm::vec3>& positions,
+        const std::vector<float>& rotations) {
+        const auto id = next_instance_set_id++;
+        const RetainedInstancesKey key(&mesh, shadow_caster);
+        auto it = retained_instances.find(key);
+        if (it == retained_instances.end()) {
+            RetainedInstances instances{};
+            instances.radius = compute_instance_radius(mesh);
+            it = retained_instances.emplace(key, std::move(instances)).first;
+        }
+        it->second.sets.emplace(id, interleave_instances(positions, rotations));
+        retained_dirty = true;
+        instance_set_keys.emplace(id, key);
+        return InstanceSet(this, id);
+    }
+
+    void Renderer::update_instance_set(std::uint32_t id, const std::vector<glm::vec3>& positions, const std::vector<float>& rotations) {
+        auto& instances = retained_instances.at(instance_set_keys.at(id));
+        instances.sets.at(id) = interleave_instances(positions, rotations);
+        retained_dirty = true;
+    }
+
+    void Renderer::destroy_instance_set(std::uint32_t id) {
+        const auto it = instance_set_keys.find(id);
+        if (it == instance_set_keys.end()) {
+            return;
+        }
+        // The GPU only sees the concatenated data, so the entry of the key can be removed together with its last set
+        const auto instances = retained_instances.find(it->second);
+        instances->second.sets.erase(id);
+        if (instances->second.sets.empty()) {
+            retained_instances.erase(instances);
+        }
+        retained_dirty = true;
+        instance_set_keys.erase(it);
+    }
+
     void Renderer::render(const Mesh& mesh) {
-        shadow_casters_to_render.emplace_back(&mesh);
+        meshes_to_render.emplace_back(&mesh);
+        render_shadow_caster(mesh);
+    }
+
+    void Renderer::render_shadow_caster(const Mesh& mesh) {
+        const auto bounding_box = mesh.get_bounding_box_in_model_space().apply(mesh.get_model_matrix());
+        const auto center = bounding_box.center();
+        const auto radius = glm::length(bounding_box.max - bounding_box.min) * 0.5f;
+        if (!shadow_caster_volume.is_sphere_inside(center, radius)) {
+            ++shadow_caster_statistics.culled;
+            return;
+        }
+        shadow_casters_to_render.emplace_back(ShadowCasterToRender{ &mesh, center, radius });
+        ++shadow_caster_statistics.drawn;
     }
 
     void Renderer::render_instanced(const Mesh& mesh, const std::vector<glm::vec3>& positions, const std::vector<float>& rotations) {
@@ -476,6 +737,20 @@ namespace inf::gfx {
         particles_to_render.emplace_back(ParticlesToRender{ &mesh, positions });
     }
 
+    void Renderer::render_building_instances(const Mesh& mesh, const std::vector<vk::BuildingInstance>& instances) {
+        if (instances.empty() || !building_palette_buffer) {
+            return;
+        }
+        buildings_to_render.emplace_back(BuildingMeshToRender{ &mesh, instances });
+    }
+
+    void Renderer::render_building_shadow_casters(const Mesh& mesh, const std::vector<vk::BuildingInstance>& instances) {
+        if (instances.empty() || !building_palette_buffer) {
+            return;
+        }
+        building_casters_to_render.emplace_back(BuildingMeshToRender{ &mesh, instances });
+    }
+
     void Renderer::render(const BoundingBox3D& bounding_box, const glm::vec3& color) {
         if (!context.show_debug_bbs) {
             return;
@@ -491,6 +766,7 @@ namespace inf::gfx {
     void Renderer::end_frame() {
         // Wait for the previous frame to finish
         in_flight_fences[frame_index].wait_for_and_reset();
+        instance_data_ring->begin_frame(frame_index);
 
         // Acquire the next image in the swap chain
         vkAcquireNextImageKHR(
@@ -501,352 +777,401 @@ namespace inf::gfx {
             VK_NULL_HANDLE,
             &image_index);
 
-        const auto& command_buffer = command_buffers[frame_index];
-        command_buffer.reset();
-        command_buffer.begin();
-
-        // In the first render pass we render into a shadow map which will be sampled in the second render pass
-        std::vector<VkClearValue> shadow_map_clear_values(1);
-        shadow_map_clear_values[0].depthStencil = { 1.0f, 0 };
-        shadow_map_render_pass->begin(*shadow_map_framebuffer, SHADOW_MAP_EXTENT, command_buffer, shadow_map_clear_values);
-        vkCmdBindPipeline(command_buffer.get_command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_map_pipeline->get_pipeline());
-        // Since the viewport and the scissor is dynamic we need to supply it each frame
-        VkViewport shadow_map_viewport{};
-        shadow_map_viewport.x = 0.0f;
-        shadow_map_viewport.y = 0.0f;
-        shadow_map_viewport.width = static_cast<float>(SHADOW_MAP_EXTENT.width);
-        shadow_map_viewport.height = static_cast<float>(SHADOW_MAP_EXTENT.height);
-        shadow_map_viewport.minDepth = 0.0f;
-        shadow_map_viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(command_buffer.get_command_buffer(), 0, 1, &shadow_map_viewport);
-
-        VkRect2D shadow_map_scissor{};
-        shadow_map_scissor.offset = { 0, 0 };
-        shadow_map_scissor.extent = SHADOW_MAP_EXTENT;
-        vkCmdSetScissor(command_buffer.get_command_buffer(), 0, 1, &shadow_map_scissor);
-
-        // Bind descriptor sets
-        vkCmdBindDescriptorSets(
-            command_buffer.get_command_buffer(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            shadow_map_pipeline->get_pipeline_layout(),
-            0, 1,
-            &shadow_map_descriptor_sets[frame_index],
-            0, nullptr);
+        // The buffers of the current frame are not used by the GPU anymore, so retained instances can be uploaded into them
+        upload_retained_instances();
 
         const auto view_matrix = camera.to_view_matrix();
-        Frustum frustum(projection_matrix * view_matrix);
-        // TODO: The number of splits necessary is mostly resolution dependant. 5 splits seem good enough on a 1440p resolution, while
-        // even 2 splits seem mostly okay on a fullHD screen. If there is time there should be a proper cascaded shadow implementation
-        // instead of this hardcoded value. Or as a janky alternative the engine could dynamically switch to higher splits on higher
-        // resolutions, but that would significantly reduce shadow distance on high resolution displays.
-        frustum = frustum.split<5>()[0];
-        const auto frustum_bb = frustum.compute_bounding_box();
-        const auto camera_position = camera.get_position();
-        const auto initial_sun_position = glm::vec3(
-            camera_position.x + 10.0f,
-            camera_position.y + 5.0f,
-            frustum_bb.max.z);
-        const auto end_sun_position = glm::vec3(
-            camera_position.x - 10.0f,
-            camera_position.y + 5.0f,
-            frustum_bb.max.z);
-        const auto sun_position = glm::mix(initial_sun_position, end_sun_position, context.time_of_day);
-        static constexpr glm::vec3 sun_start_direction(-0.65f, -0.54f, -0.54f);
-        static constexpr glm::vec3 sun_end_direction(0.65f, -0.54f, -0.54f);
-        const auto sun_direction = glm::normalize(glm::mix(sun_start_direction, sun_end_direction, context.time_of_day));
         const auto sin_time_of_day = glm::sin(context.time_of_day * glm::pi<float>());
         const auto ambient_light = glm::mix(0.05f, 1.0f, sin_time_of_day);
-        glm::mat4 sun_view_matrix = glm::lookAt(
-            sun_position,
-            sun_position + sun_direction,
-            glm::vec3(0.0f, 1.0f, 0.0f));
-        BoundingBox3D shadow_bb;
-        for (const auto& point : frustum.points) {
-            const auto transformed = sun_view_matrix * glm::vec4(point, 1.0f);
-            shadow_bb.update(transformed / transformed.w);
-        }
-
-        // Upload uniform buffer data
-        Matrices shadow_map_matrices;
-        glm::mat4 shadow_map_projection_matrix = glm::ortho(
-            shadow_bb.min.x,
-            shadow_bb.max.x,
-            shadow_bb.min.y,
-            shadow_bb.max.y,
-            NEAR_PLANE,
-            FAR_PLANE);
-        shadow_map_matrices.projection_matrix = shadow_map_projection_matrix;
-        shadow_map_matrices.view_matrix = sun_view_matrix;
-        shadow_map_matrices.light_space_matrix = glm::mat4(1.0f);
-        shadow_map_matrices.ambient_light = ambient_light;
-        shadow_map_matrices.light_direction = sun_direction;
-        shadow_map_uniform_buffers[frame_index].upload(&shadow_map_matrices, sizeof(Matrices));
-
-        const auto command_buffer_handle = command_buffer.get_command_buffer();
-        for (const auto& mesh : shadow_casters_to_render) {
-            // Push model matrix
-            PushConstants constants{ mesh->get_model_matrix(), 0 };
-            vkCmdPushConstants(
-                command_buffer_handle,
-                shadow_map_pipeline->get_pipeline_layout(),
-                VK_SHADER_STAGE_VERTEX_BIT,
-                0, sizeof(PushConstants),
-                &constants);
-            static const VkDeviceSize offset = 0;
-            const auto buffer_handle = mesh->get_buffer().get_buffer();
-            vkCmdBindVertexBuffers(command_buffer_handle, 0, 1, &buffer_handle, &offset);
-            vkCmdDraw(command_buffer_handle, static_cast<std::uint32_t>(mesh->get_number_of_vertices()), 1, 0, 0);
+        for (std::size_t i = 0; i < shadow_cascades.size(); ++i) {
+            Matrices shadow_map_matrices{};
+            shadow_map_matrices.projection_matrix = shadow_cascades[i].projection_matrix;
+            shadow_map_matrices.view_matrix = shadow_cascades[i].view_matrix;
+            shadow_map_matrices.light_direction = light_direction;
+            shadow_map_matrices.ambient_light = ambient_light;
+            shadow_map_uniform_buffers[frame_index * ShadowCascades::MAX_CASCADES + i].upload(&shadow_map_matrices, sizeof(Matrices));
         }
 
-        // Render instanced shadow casters
-        {
-            vkCmdBindPipeline(command_buffer.get_command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_map_instanced_pipeline->get_pipeline());
-            vkCmdBindDescriptorSets(
-                command_buffer.get_command_buffer(),
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                shadow_map_instanced_pipeline->get_pipeline_layout(),
-                0, 1,
-                &shadow_map_descriptor_sets[frame_index],
-                0, nullptr);
-
-            // Calculate how many bytes are needed for instance data
-            std::uint32_t instanced_data_buffer_bytes = 0;
-            std::vector<VkDeviceSize> instanced_data_offsets;
-            VkDeviceSize offset_accumulator = 0;
-            for (const auto& entry : instanced_casters_to_render) {
-                const auto num_bytes = entry.positions.size() * sizeof(glm::vec3) + entry.rotations.size() * sizeof(float);
-                instanced_data_buffer_bytes += static_cast<std::uint32_t>(num_bytes);
-                instanced_data_offsets.emplace_back(offset_accumulator);
-                offset_accumulator += num_bytes;
-            }
-
-            // Create a single buffer that will be offset for different meshes
-            std::vector<float> data_to_upload;
-            data_to_upload.reserve(instanced_data_buffer_bytes / sizeof(float));
-            for (const auto& entry : instanced_casters_to_render) {
+        // The static shadow map is out of date once districts were loaded or evicted, which changes the retained instances
+        if (static_retained_version != retained_version) {
+            static_cascades_dirty.fill(true);
+            static_retained_version = retained_version;
+        }
+        const auto num_cascades = shadow_cascades.size();
+        const auto first_dirty = static_cascades_dirty.cbegin();
+        const auto last_dirty = first_dirty + num_cascades;
+        const auto is_dirty = [](bool dirty) { return dirty; };
+        const auto render_static_casters = !context.cache_shadows || std::any_of(first_dirty, last_dirty, is_dirty);
+        const auto all_static_cascades_dirty = std::all_of(first_dirty, last_dirty, is_dirty);
+
+        // Everything the render passes read is uploaded up front, the ring buffer is not thread safe and the passes are
+        // recorded in parallel. Instance data of the shadow casters is uploaded once and drawn into every cascade, instances
+        // outside of the caster volume are culled. Instances of the same mesh are merged into a single contiguous range, so
+        // every mesh is drawn once per cascade.
+        std::vector<glm::vec4> caster_data_to_upload;
+        const auto caster_batches = batch_instances(
+            instanced_casters_to_render,
+            caster_data_to_upload,
+            [this](const InstancedMeshToRender& entry, std::vector<glm::vec4>& data) {
+                const auto radius = compute_instance_radius(*entry.mesh);
                 for (std::size_t i = 0; i < entry.positions.size(); ++i) {
-                    data_to_upload.emplace_back(entry.positions[i].x);
-                    data_to_upload.emplace_back(entry.positions[i].y);
-                    data_to_upload.emplace_back(entry.positions[i].z);
-                    data_to_upload.emplace_back(entry.rotations[i]);
+                    if (shadow_caster_volume.is_sphere_inside(entry.positions[i], radius)) {
+                        data.emplace_back(entry.positions[i], entry.rotations[i]);
+                        ++shadow_caster_statistics.drawn;
+                    }
+                    else {
+                        ++shadow_caster_statistics.culled;
+                    }
+                }
+            });
+        const auto caster_allocation = instance_data_ring->upload(
+            caster_data_to_upload.data(), caster_data_to_upload.size() * sizeof(glm::vec4), INSTANCE_DATA_ALIGNMENT);
+
+        // Buildings of visible lots cast shadows together with the buildings of the lots outside of the camera frustum
+        BuildingDraws building_caster_draws{};
+        if (render_static_casters) {
+            std::vector<BuildingMeshToRender> building_casters;
+            building_casters.reserve(buildings_to_render.size() + building_casters_to_render.size());
+            for (const auto& entries : { &buildings_to_render, &building_casters_to_render }) {
+                for (const auto& entry : *entries) {
+                    building_casters.emplace_back(entry);
                 }
             }
-            instanced_shadow_data_buffers[frame_index].upload(data_to_upload.data(), instanced_data_buffer_bytes);
-
-            // Render instanced meshes
-            for (std::size_t i = 0; i < instanced_casters_to_render.size(); ++i) {
-                const auto& entry = instanced_casters_to_render[i];
-                const auto instance_count = static_cast<std::uint32_t>(entry.positions.size());
-                std::array<VkDeviceSize, 2> offsets{ 0, instanced_data_offsets.at(i) };
-                std::array<VkBuffer, 2> buffer_handles{
-                    entry.mesh->get_buffer().get_buffer(),
-                    instanced_shadow_data_buffers[frame_index].get_buffer()
-                };
-                vkCmdBindVertexBuffers(command_buffer_handle, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
-                vkCmdDraw(command_buffer_handle, static_cast<std::uint32_t>(entry.mesh->get_number_of_vertices()), instance_count, 0, 0);
-            }
+            building_caster_draws = upload_building_instances(building_casters, true);
         }
 
-        shadow_map_render_pass->end(command_buffer);
-
-        // In the second render pass we render color data
-        const auto& extent = swap_chain->get_extent();
-        std::vector<VkClearValue> clear_values(2);
-        static constexpr glm::vec4 start_clear_color(0.670588f, 0.87843f, 1.0f, 1.0f);
-        static constexpr glm::vec4 end_clear_color(0.0156862f, 0.129412f, 0.2f, 1.0f);
-        const auto clear_color = glm::mix(end_clear_color, start_clear_color, sin_time_of_day);
-        clear_values[0].color = {{ clear_color.x, clear_color.y, clear_color.z, clear_color.w }};
-        clear_values[1].depthStencil = { 1.0f, 0 };
-        render_pass->begin(framebuffers[image_index], extent, command_buffer, clear_values);
-        vkCmdBindPipeline(command_buffer.get_command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->get_pipeline());
-
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(extent.width);
-        viewport.height = static_cast<float>(extent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(command_buffer.get_command_buffer(), 0, 1, &viewport);
-
-        VkRect2D scissor{};
-        scissor.offset = { 0, 0 };
-        scissor.extent = extent;
-        vkCmdSetScissor(command_buffer.get_command_buffer(), 0, 1, &scissor);
-        vkCmdBindDescriptorSets(
-            command_buffer.get_command_buffer(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipeline->get_pipeline_layout(),
-            0, 1,
-            &descriptor_sets[frame_index],
-            0, nullptr);
-
-        // Upload uniform buffer data
-        Matrices matrices;
+        Matrices matrices{};
         matrices.projection_matrix = projection_matrix;
         matrices.view_matrix = view_matrix;
-        matrices.light_space_matrix = shadow_map_projection_matrix * sun_view_matrix;
-        matrices.light_direction = sun_direction;
+        for (std::size_t i = 0; i < shadow_cascades.size(); ++i) {
+            matrices.light_space_matrices[i] = shadow_cascades[i].get_light_space_matrix();
+            matrices.cascade_split_distances[static_cast<glm::length_t>(i)] = shadow_cascades[i].far_distance;
+        }
+        matrices.light_direction = light_direction;
         matrices.ambient_light = ambient_light;
+        matrices.num_shadow_cascades = static_cast<std::uint32_t>(shadow_cascades.size());
         uniform_buffers[frame_index].upload(&matrices, sizeof(Matrices));
 
-        // Render the meshes
-        for (const auto& mesh : shadow_casters_to_render) {
-            // Push model matrix
-            PushConstants constants{ mesh->get_model_matrix(), 0 };
-            vkCmdPushConstants(
-                command_buffer_handle,
-                pipeline->get_pipeline_layout(),
-                VK_SHADER_STAGE_VERTEX_BIT,
-                0, sizeof(PushConstants),
-                &constants);
+        BuildingDraws building_draws{};
+        if (!buildings_to_render.empty()) {
+            building_draws = upload_building_instances(buildings_to_render, false);
+        }
 
-            static const VkDeviceSize offset = 0;
-            const auto buffer_handle = mesh->get_buffer().get_buffer();
-            vkCmdBindVertexBuffers(command_buffer_handle, 0, 1, &buffer_handle, &offset);
-            vkCmdDraw(command_buffer_handle, static_cast<std::uint32_t>(mesh->get_number_of_vertices()), 1, 0, 0);
+        // Casters and non-casters share the pipeline in the color pass, so their instances are merged by mesh as well
+        std::vector<InstancedMeshToRender> instanced_to_render;
+        instanced_to_render.reserve(instanced_non_casters_to_render.size() + instanced_casters_to_render.size());
+        for (const auto& entries : { &instanced_non_casters_to_render, &instanced_casters_to_render }) {
+            for (const auto& entry : *entries) {
+                instanced_to_render.emplace_back(entry);
+            }
         }
+        std::vector<glm::vec4> data_to_upload;
+        const auto batches = batch_instances(instanced_to_render, data_to_upload, append_instances);
+        const auto allocation = instance_data_ring->upload(
+            data_to_upload.data(), data_to_upload.size() * sizeof(glm::vec4), INSTANCE_DATA_ALIGNMENT);
 
-        // Render instanced data
-        vkCmdBindPipeline(command_buffer.get_command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_pipeline->get_pipeline());
-        vkCmdBindDescriptorSets(
-            command_buffer.get_command_buffer(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            instanced_pipeline->get_pipeline_layout(),
-            0, 1,
-            &descriptor_sets[frame_index],
-            0, nullptr);
+        // Every particle system gets its own range of the ring, so any number of them can be rendered in a frame
+        std::vector<vk::RingBufferAllocation> particle_allocations;
+        if (!particles_to_render.empty()) {
+            ParticleMatrices particle_matrices;
+            particle_matrices.projection_matrix = projection_matrix;
+            particle_matrices.view_matrix = view_matrix;
+            particle_matrices.inverse_view_matrix = glm::inverse(view_matrix);
+            particle_matrices.ambient_light = ambient_light;
+            particle_uniform_buffers[frame_index].upload(&particle_matrices, sizeof(ParticleMatrices));
+            for (const auto& particle_system : particles_to_render) {
+                const auto& positions = particle_system.positions;
+                particle_allocations.emplace_back(instance_data_ring->upload(
+                    positions.data(), positions.size() * sizeof(glm::vec3), INSTANCE_DATA_ALIGNMENT));
+            }
+        }
+        ImGui::Render();
 
-        // Calculate how many bytes are needed for instance data
-        std::uint32_t instanced_data_buffer_bytes = 0;
-        std::vector<VkDeviceSize> instanced_data_offsets;
-        VkDeviceSize offset_accumulator = 0;
-        for (const auto& entry : instanced_non_casters_to_render) {
-            const auto num_bytes = entry.positions.size() * sizeof(glm::vec3) + entry.rotations.size() * sizeof(float);
-            instanced_data_buffer_bytes += static_cast<std::uint32_t>(num_bytes);
-            instanced_data_offsets.emplace_back(offset_accumulator);
-            offset_accumulator += num_bytes;
-        }
-        for (const auto& entry : instanced_casters_to_render) {
-            const auto num_bytes = entry.positions.size() * sizeof(glm::vec3) + entry.rotations.size() * sizeof(float);
-            instanced_data_buffer_bytes += static_cast<std::uint32_t>(num_bytes);
-            instanced_data_offsets.emplace_back(offset_accumulator);
-            offset_accumulator += num_bytes;
-        }
-
-        // Create a single buffer that will be offset for different meshes
-        std::vector<float> data_to_upload;
-        data_to_upload.reserve(instanced_data_buffer_bytes / sizeof(float));
-        for (const auto& entry : instanced_non_casters_to_render) {
-            for (std::size_t i = 0; i < entry.positions.size(); ++i) {
-                data_to_upload.emplace_back(entry.positions[i].x);
-                data_to_upload.emplace_back(entry.positions[i].y);
-                data_to_upload.emplace_back(entry.positions[i].z);
-                data_to_upload.emplace_back(entry.rotations[i]);
-            }
-        }
-        for (const auto& entry : instanced_casters_to_render) {
-            for (std::size_t i = 0; i < entry.positions.size(); ++i) {
-                data_to_upload.emplace_back(entry.positions[i].x);
-                data_to_upload.emplace_back(entry.positions[i].y);
-                data_to_upload.emplace_back(entry.positions[i].z);
-                data_to_upload.emplace_back(entry.rotations[i]);
-            }
-        }
-        instanced_data_buffers[frame_index].upload(data_to_upload.data(), instanced_data_buffer_bytes);
-
-        // Render instanced meshes
-        for (std::size_t i = 0; i < instanced_non_casters_to_render.size(); ++i) {
-            const auto& entry = instanced_non_casters_to_render[i];
-            const auto instance_count = static_cast<std::uint32_t>(entry.positions.size());
-            std::array<VkDeviceSize, 2> offsets{ 0, instanced_data_offsets.at(i) };
-            std::array<VkBuffer, 2> buffer_handles{
-                entry.mesh->get_buffer().get_buffer(),
-                instanced_data_buffers[frame_index].get_buffer()
-            };
-            vkCmdBindVertexBuffers(command_buffer_handle, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
-            vkCmdDraw(command_buffer_handle, static_cast<std::uint32_t>(entry.mesh->get_number_of_vertices()), instance_count, 0, 0);
+        // In the first render passes we render the cascades into the tiles of the shadow map atlas which will be sampled in
+        // the color pass. Every cascade is recorded by its own job.
+        std::vector<RecordingJob> jobs;
+        if (!context.cache_shadows) {
+            for (std::size_t i = 0; i < num_cascades; ++i) {
+                jobs.emplace_back(RecordingJob{
+                    shadow_map_render_pass.get(),
+                    shadow_map_framebuffer.get(),
+                    [&, i](VkCommandBuffer command_buffer_handle) {
+                        set_shadow_cascade_viewport(command_buffer_handle, i);
+                        return render_static_shadow_casters(command_buffer_handle, i, building_caster_draws) +
+                            render_dynamic_shadow_casters(command_buffer_handle, i, caster_batches, caster_allocation);
+                    }
+                });
+            }
         }
-        for (std::size_t i = 0; i < instanced_casters_to_render.size(); ++i) {
-            const auto& entry = instanced_casters_to_render[i];
-            const auto instance_count = static_cast<std::uint32_t>(entry.positions.size());
-            std::array<VkDeviceSize, 2> offsets{ 0, instanced_data_offsets.at(instanced_non_casters_to_render.size() + i) };
-            std::array<VkBuffer, 2> buffer_handles{
-                entry.mesh->get_buffer().get_buffer(),
-                instanced_data_buffers[frame_index].get_buffer()
-            };
-            vkCmdBindVertexBuffers(command_buffer_handle, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
-            vkCmdDraw(command_buffer_handle, static_cast<std::uint32_t>(entry.mesh->get_number_of_vertices()), instance_count, 0, 0);
+        // Only the dirty cascades of the static shadow map are rendered again. Their tiles are cleared one by one, unless
+        // all of them are dirty, which is always the case when the static shadow map is rendered for the first time.
+        const auto& static_render_pass = all_static_cascades_dirty ? shadow_map_render_pass : shadow_map_preserving_render_pass;
+        const auto first_static_job = jobs.size();
+        if (context.cache_shadows && render_static_casters) {
+            for (std::size_t i = 0; i < num_cascades; ++i) {
+                if (!static_cascades_dirty[i]) {
+                    continue;
+                }
+                jobs.emplace_back(RecordingJob{
+                    static_render_pass.get(),
+                    static_shadow_map_framebuffer.get(),
+                    [&, i](VkCommandBuffer command_buffer_handle) {
+                        set_shadow_cascade_viewport(command_buffer_handle, i);
+                        if (!all_static_cascades_dirty) {
+                            VkClearAttachment clear_attachment{};
+                            clear_attachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+                            clear_attachment.clearValue.depthStencil = { 1.0f, 0 };
+                            VkClearRect clear_rect{};
+                            clear_rect.rect = get_shadow_cascade_tile(i);
+                            clear_rect.baseArrayLayer = 0;
+                            clear_rect.layerCount = 1;
+                            vkCmdClearAttachments(command_buffer_handle, 1, &clear_attachment, 1, &clear_rect);
+                        }
+                        return render_static_shadow_casters(command_buffer_handle, i, building_caster_draws);
+                    }
+                });
+            }
+        }
+        // The dynamic casters are drawn on top of a copy of the static shadow map
+        const auto first_dynamic_job = jobs.size();
+        if (context.cache_shadows) {
+            for (std::size_t i = 0; i < num_cascades; ++i) {
+                jobs.emplace_back(RecordingJob{
+                    shadow_map_preserving_render_pass.get(),
+                    shadow_map_framebuffer.get(),
+                    [&, i](VkCommandBuffer command_buffer_handle) {
+                        set_shadow_cascade_viewport(command_buffer_handle, i);
+                        return render_dynamic_shadow_casters(command_buffer_handle, i, caster_batches, caster_allocation);
+                    }
+                });
+            }
         }
 
-        // Render debug bounding boxes (we do this after instanced data and switch pipelines again, because BBs are transparent so all opaque data needs to be rendered before)
-        if (context.show_debug_bbs && !bounding_boxes_to_render.empty()) {
-            vkCmdBindPipeline(command_buffer.get_command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->get_pipeline());
-            vkCmdBindDescriptorSets(
-                command_buffer.get_command_buffer(),
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipeline->get_pipeline_layout(),
-                0, 1,
-                &descriptor_sets[frame_index],
-                0, nullptr);
-            for (const auto& entry: bounding_boxes_to_render) {
-                PushConstants constants{ glm::mat4(1.0f), 1 };
-                vkCmdPushConstants(
+        // In the second render pass we render color data, split into draw buckets. The buckets are executed in the order of
+        // the jobs, so the transparent bounding boxes and particles come after all of the opaque geometry.
+        const auto first_color_job = jobs.size();
+        const auto& extent = swap_chain->get_extent();
+        const auto begin_color_job = [&extent](VkCommandBuffer command_buffer_handle) {
+            // Since the viewport and the scissor is dynamic we need to supply it in every secondary command buffer
+            VkViewport viewport{};
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = static_cast<float>(extent.width);
+            viewport.height = static_cast<float>(extent.height);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(command_buffer_handle, 0, 1, &viewport);
+
+            VkRect2D scissor{};
+            scissor.offset = { 0, 0 };
+            scissor.extent = extent;
+            vkCmdSetScissor(command_buffer_handle, 0, 1, &scissor);
+        };
+        const auto add_color_job = [&](std::function<std::uint32_t(VkCommandBuffer)> record) {
+            jobs.emplace_back(RecordingJob{ render_pass.get(), &framebuffers[image_index], std::move(record) });
+        };
+
+        // Render the meshes, which are split into chunks as there is one for every vehicle
+        for (std::size_t first_mesh = 0; first_mesh < meshes_to_render.size(); first_mesh += MESHES_PER_RECORDING_JOB) {
+            const auto last_mesh = std::min(first_mesh + MESHES_PER_RECORDING_JOB, meshes_to_render.size());
+            add_color_job([&, first_mesh, last_mesh](VkCommandBuffer command_buffer_handle) {
+                begin_color_job(command_buffer_handle);
+                vkCmdBindPipeline(command_buffer_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->get_pipeline());
+                vkCmdBindDescriptorSets(
                     command_buffer_handle,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
                     pipeline->get_pipeline_layout(),
-                    VK_SHADER_STAGE_VERTEX_BIT,
-                    0, sizeof(PushConstants),
-                    &constants);
+                    0, 1,
+                    &descriptor_sets[frame_index],
+                    0, nullptr);
+                for (std::size_t i = first_mesh; i < last_mesh; ++i) {
+                    const auto mesh = meshes_to_render[i];
+                    // Push model matrix
+                    PushConstants constants{ mesh->get_model_matrix(), 0 };
+                    vkCmdPushConstants(
+                        command_buffer_handle,
+                        pipeline->get_pipeline_layout(),
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        0, sizeof(PushConstants),
+                        &constants);
+
+                    static const VkDeviceSize offset = 0;
+                    const auto buffer_handle = mesh->get_buffer().get_buffer();
+                    vkCmdBindVertexBuffers(command_buffer_handle, 0, 1, &buffer_handle, &offset);
+                    draw_mesh(command_buffer_handle, *mesh, 1);
+                }
+                return static_cast<std::uint32_t>(last_mesh - first_mesh);
+            });
+        }
 
-                static const VkDeviceSize offset = 0;
-                static constexpr std::uint32_t vertices_per_bounding_box = 36;
-                const auto buffer_handle = entry.get_buffer();
-                vkCmdBindVertexBuffers(command_buffer_handle, 0, 1, &buffer_handle, &offset);
-                vkCmdDraw(command_buffer_handle, vertices_per_bounding_box, 1, 0, 0);
-            }
+        // Render buildings
+        if (!building_draws.batches.empty()) {
+            add_color_job([&](VkCommandBuffer command_buffer_handle) {
+                begin_color_job(command_buffer_handle);
+                vkCmdBindPipeline(command_buffer_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, building_pipeline->get_pipeline());
+                vkCmdBindDescriptorSets(
+                    command_buffer_handle,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    building_pipeline->get_pipeline_layout(),
+                    0, 1,
+                    &building_descriptor_sets[frame_index],
+                    0, nullptr);
+                return render_building_batches(command_buffer_handle, building_draws);
+            });
         }
 
-        // Render particles
-        if (!particles_to_render.empty()) {
-            vkCmdBindPipeline(command_buffer.get_command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, particle_pipeline->get_pipeline());
+        // Render instanced data
+        add_color_job([&](VkCommandBuffer command_buffer_handle) {
+            begin_color_job(command_buffer_handle);
+            vkCmdBindPipeline(command_buffer_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_pipeline->get_pipeline());
             vkCmdBindDescriptorSets(
-                command_buffer.get_command_buffer(),
+                command_buffer_handle,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
-                particle_pipeline->get_pipeline_layout(),
+                instanced_pipeline->get_pipeline_layout(),
                 0, 1,
-                &particle_descriptor_sets[frame_index],
+                &descriptor_sets[frame_index],
                 0, nullptr);
-            
-            // Upload uniform data
-            ParticleMatrices particle_matrices;
-            particle_matrices.projection_matrix = projection_matrix;
-            particle_matrices.view_matrix = view_matrix;
-            particle_matrices.inverse_view_matrix = glm::inverse(view_matrix);
-            particle_matrices.ambient_light = ambient_light;
-            particle_uniform_buffers[frame_index].upload(&particle_matrices, sizeof(ParticleMatrices));
-
-            for (const auto& particle_system : particles_to_render) {
-                std::array<VkDeviceSize, 2> offsets{ 0, 0 };
-                std::array<VkBuffer, 2> buffer_handles {
-                    particle_system.mesh->get_buffer().get_buffer(),
-                    particle_data_buffers[frame_index].get_buffer()
+            std::uint32_t num_draw_calls = 0;
+            for (const auto& batch : batches) {
+                std::array<VkDeviceSize, 2> offsets{ 0, allocation.offset + batch.offset };
+                std::array<VkBuffer, 2> buffer_handles{
+                    batch.mesh->get_buffer().get_buffer(),
+                    allocation.buffer
                 };
-                const auto& positions = particle_system.positions;
-                const auto instance_count = static_cast<std::uint32_t>(positions.size());
-                const auto positions_num_bytes = instance_count * sizeof(glm::vec3);
-                // TODO: This will NOT work when we are trying to render more than one particle system at a time
-                particle_data_buffers[frame_index].upload(positions.data(), positions_num_bytes);
                 vkCmdBindVertexBuffers(command_buffer_handle, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
-                vkCmdDraw(command_buffer_handle, static_cast<std::uint32_t>(particle_system.mesh->get_number_of_vertices()), instance_count, 0, 0);
+                draw_mesh(command_buffer_handle, *batch.mesh, batch.num_instances);
+                ++num_draw_calls;
             }
+            return num_draw_calls + render_retained_instances(command_buffer_handle, 0);
+        });
+
+        // Render debug bounding boxes (we do this after instanced data and switch pipelines again, because BBs are transparent so all opaque data needs to be rendered before)
+        if (context.show_debug_bbs && !bounding_boxes_to_render.empty()) {
+            add_color_job([&](VkCommandBuffer command_buffer_handle) {
+                begin_color_job(command_buffer_handle);
+                vkCmdBindPipeline(command_buffer_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, bounding_box_pipeline->get_pipeline());
+                vkCmdBindDescriptorSets(
+                    command_buffer_handle,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    bounding_box_pipeline->get_pipeline_layout(),
+                    0, 1,
+                    &descriptor_sets[frame_index],
+                    0, nullptr);
+                for (const auto& entry: bounding_boxes_to_render) {
+                    PushConstants constants{ glm::mat4(1.0f), 1 };
+                    vkCmdPushConstants(
+                        command_buffer_handle,
+                        bounding_box_pipeline->get_pipeline_layout(),
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        0, sizeof(PushConstants),
+                        &constants);
+
+                    static const VkDeviceSize offset = 0;
+                    static constexpr std::uint32_t vertices_per_bounding_box = 36;
+                    const auto buffer_handle = entry.get_buffer();
+                    vkCmdBindVertexBuffers(command_buffer_handle, 0, 1, &buffer_handle, &offset);
+                    vkCmdDraw(command_buffer_handle, vertices_per_bounding_box, 1, 0, 0);
+                }
+                return static_cast<std::uint32_t>(bounding_boxes_to_render.size());
+            });
         }
 
-        // Render imgui data
-        ImGui::Render();
-        const auto draw_data = ImGui::GetDrawData();
-        ImGui_ImplVulkan_RenderDrawData(draw_data, command_buffer.get_command_buffer());
+        // Render particles
+        if (!particles_to_render.empty()) {
+            add_color_job([&](VkCommandBuffer command_buffer_handle) {
+                begin_color_job(command_buffer_handle);
+                vkCmdBindPipeline(command_buffer_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, particle_pipeline->get_pipeline());
+                vkCmdBindDescriptorSets(
+                    command_buffer_handle,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    particle_pipeline->get_pipeline_layout(),
+                    0, 1,
+                    &particle_descriptor_sets[frame_index],
+                    0, nullptr);
+                for (std::size_t i = 0; i < particles_to_render.size(); ++i) {
+                    const auto& particle_system = particles_to_render[i];
+                    const auto instance_count = static_cast<std::uint32_t>(particle_system.positions.size());
+                    std::array<VkDeviceSize, 2> offsets{ 0, particle_allocations[i].offset };
+                    std::array<VkBuffer, 2> buffer_handles {
+                        particle_system.mesh->get_buffer().get_buffer(),
+                        particle_allocations[i].buffer
+                    };
+                    vkCmdBindVertexBuffers(command_buffer_handle, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
+                    draw_mesh(command_buffer_handle, *particle_system.mesh, instance_count);
+                }
+                return static_cast<std::uint32_t>(particles_to_render.size());
+            });
+        }
+
+        // Render imgui data, it sets its own viewport and scissor
+        add_color_job([](VkCommandBuffer command_buffer_handle) {
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), command_buffer_handle);
+            return 0u;
+        });
+
+        const auto recorded_jobs = record_jobs(jobs);
+        const auto execute_jobs = [&](const vk::CommandBuffer& command_buffer, std::size_t first_job, std::size_t last_job) {
+            command_buffer.execute(std::vector<VkCommandBuffer>(
+                recorded_jobs.command_buffers.cbegin() + first_job,
+                recorded_jobs.command_buffers.cbegin() + last_job));
+            std::uint32_t num_draw_calls = 0;
+            for (std::size_t i = first_job; i < last_job; ++i) {
+                num_draw_calls += recorded_jobs.num_draw_calls[i];
+            }
+            return num_draw_calls;
+        };
+
+        // The primary command buffer only records the culling, the copy and the render passes that execute the jobs
+        const auto& command_buffer = command_buffers[frame_index];
+        command_buffer.reset();
+        command_buffer.begin();
+
+        // Retained instances are culled on the GPU before any of the render passes begin, shadow casters only when they are drawn
+        const auto command_buffer_handle = command_buffer.get_command_buffer();
+        cull_retained_instances(
+            command_buffer_handle,
+            projection_matrix * view_matrix,
+            render_static_casters ? shadow_cascades : std::vector<ShadowCascade>{});
+
+        std::vector<VkClearValue> shadow_map_clear_values(1);
+        shadow_map_clear_values[0].depthStencil = { 1.0f, 0 };
+        num_shadow_draw_calls = 0;
+        num_static_cascades_rendered = 0;
+        if (!context.cache_shadows) {
+            shadow_map_render_pass->begin(
+                *shadow_map_framebuffer, get_shadow_map_extent(), command_buffer, shadow_map_clear_values, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            num_shadow_draw_calls += execute_jobs(command_buffer, 0, first_static_job);
+            shadow_map_render_pass->end(command_buffer);
+            num_static_cascades_rendered = static_cast<std::uint32_t>(num_cascades);
+        }
+        else {
+            if (first_dynamic_job > first_static_job) {
+                static_render_pass->begin(
+                    *static_shadow_map_framebuffer,
+                    get_shadow_map_extent(),
+                    command_buffer,
+                    shadow_map_clear_values,
+                    VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                num_shadow_draw_calls += execute_jobs(command_buffer, first_static_job, first_dynamic_job);
+                static_render_pass->end(command_buffer);
+                num_static_cascades_rendered = static_cast<std::uint32_t>(first_dynamic_job - first_static_job);
+                std::fill(static_cascades_dirty.begin(), static_cascades_dirty.begin() + num_cascades, false);
+            }
+            copy_static_shadow_map(command_buffer_handle);
+            shadow_map_preserving_render_pass->begin(
+                *shadow_map_framebuffer, get_shadow_map_extent(), command_buffer, shadow_map_clear_values, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            num_shadow_draw_calls += execute_jobs(command_buffer, first_dynamic_job, first_color_job);
+            shadow_map_preserving_render_pass->end(command_buffer);
+        }
 
+        std::vector<VkClearValue> clear_values(2);
+        static constexpr glm::vec4 start_clear_color(0.670588f, 0.87843f, 1.0f, 1.0f);
+        static constexpr glm::vec4 end_clear_color(0.0156862f, 0.129412f, 0.2f, 1.0f);
+        const auto clear_color = glm::mix(end_clear_color, start_clear_color, sin_time_of_day);
+        clear_values[0].color = {{ clear_color.x, clear_color.y, clear_color.z, clear_color.w }};
+        clear_values[1].depthStencil = { 1.0f, 0 };
+        render_pass->begin(framebuffers[image_index], extent, command_buffer, clear_values, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        num_color_draw_calls = execute_jobs(command_buffer, first_color_job, jobs.size());
         render_pass->end(command_buffer);
         command_buffer.end();
         command_buffer.submit(
@@ -887,12 +1212,700 @@ namespace inf::gfx {
         return Frustum(projection_matrix * camera.to_view_matrix());
     }
 
+    const ShadowCasterVolume& Renderer::get_shadow_caster_volume() const {
+        return shadow_caster_volume;
+    }
+
+    void Renderer::update_shadows() {
+        // The shadow maps are recreated once the resolution changed, the cascades are fit again for the new texel size
+        const auto resolution = static_cast<std::uint32_t>(std::clamp(
+            context.shadow_cascade_resolution, Context::SHADOW_CASCADE_RESOLUTION_MIN, Context::SHADOW_CASCADE_RESOLUTION_MAX));
+        if (resolution != shadow_cascade_resolution) {
+            // The shadow maps are shared by the frames in flight
+            logical_device->wait_until_idle();
+            shadow_cascade_resolution = resolution;
+            create_shadow_maps();
+            update_shadow_map_descriptor_sets();
+            shadow_cascades.clear();
+        }
+
+        static constexpr glm::vec3 sun_start_direction(-0.65f, -0.54f, -0.54f);
+        static constexpr glm::vec3 sun_end_direction(0.65f, -0.54f, -0.54f);
+        light_direction = glm::normalize(glm::mix(sun_start_direction, sun_end_direction, context.time_of_day));
+
+        // Fit a shadow cascade to every slice of the camera frustum within the shadow distance
+        const auto view_matrix = camera.to_view_matrix();
+        const auto& extent = swap_chain->get_extent();
+        const auto aspect = static_cast<float>(extent.width) / extent.height;
+        const auto num_cascades = static_cast<std::size_t>(
+            std::clamp(context.shadow_cascades, 1, static_cast<int>(ShadowCascades::MAX_CASCADES)));
+        const auto shadow_distance = std::min(context.shadow_distance, FAR_PLANE);
+        const auto split_distances = ShadowCascades::compute_split_distances(
+            NEAR_PLANE, shadow_distance, num_cascades, context.shadow_split_lambda);
+
+        // Every cascade is fit again after the sun moved, so the cascades never disagree about the light direction
+        const auto light_moved = glm::dot(light_direction, static_light_direction) < std::cos(SHADOW_CACHE_LIGHT_THRESHOLD);
+        const auto fit_all = !context.cache_shadows || light_moved || shadow_cascades.size() != num_cascades;
+        if (fit_all) {
+            shadow_cascades.resize(num_cascades);
+            static_light_direction = light_direction;
+        }
+        const auto margin = context.cache_shadows ? SHADOW_CACHE_MARGIN : 0.0f;
+        for (std::size_t i = 0; i < num_cascades; ++i) {
+            auto& cascade = shadow_cascades[i];
+            const auto near = split_distances[i];
+            const auto far = split_distances[i + 1];
+            if (fit_all || !ShadowCascades::covers(cascade, view_matrix, FOVY, aspect, near, far)) {
+                cascade = ShadowCascades::fit(
+                    view_matrix,
+                    FOVY,
+                    aspect,
+                    near,
+                    far,
+                    static_light_direction,
+                    SHADOW_CASTER_DISTANCE,
+                    margin,
+                    shadow_cascade_resolution);
+                static_cascades_dirty[i] = true;
+            }
+            // A cached cascade covers the current slice, which the cascade is selected by
+            cascade.near_distance = near;
+            cascade.far_distance = far;
+        }
+        // Static casters drawn into cached cascades have to cover every slice the cascades are reused for
+        shadow_caster_volume = context.cache_shadows
+            ? ShadowCasterVolume(shadow_cascades)
+            : ShadowCasterVolume(view_matrix, FOVY, aspect, NEAR_PLANE, shadow_distance, light_direction);
+    }
+
+    void Renderer::upload_retained_instances() {
+        // Concatenate the sets only once after they changed, the buffers of the other frames are updated from the same data
+        if (retained_dirty) {
+            retained_data.clear();
+            std::uint32_t draw_command_index = 0;
+            for (auto& [_, instances] : retained_instances) {
+                instances.first_instance = static_cast<std::uint32_t>(retained_data.size());
+                for (const auto& [_, set] : instances.sets) {
+                    retained_data.insert(retained_data.end(), set.cbegin(), set.cend());
+                }
+                instances.num_instances = static_cast<std::uint32_t>(retained_data.size() - instances.first_instance);
+                instances.draw_command_index = draw_command_index++;
+            }
+            retained_dirty = false;
+            ++retained_version;
+        }
+        if (retained_data.empty()) {
+            return;
+        }
+
+        // Every key has a draw command for the color pass and for every shadow cascade
+        static constexpr std::size_t num_passes = 1 + ShadowCascades::MAX_CASCADES;
+        auto& buffers = culling_buffers[frame_index];
+        const auto num_draw_commands = retained_instances.size() * num_passes;
+        if (buffers.instance_capacity < retained_data.size() || buffers.draw_command_capacity < num_draw_commands) {
+            // Grow geometrically so that streaming in districts does not reallocate the buffers every time
+            buffers.instance_capacity = std::max(retained_data.size(), buffers.instance_capacity * 2);
+            buffers.draw_command_capacity = std::max(num_draw_commands, buffers.draw_command_capacity * 2);
+            buffers.instances = std::make_unique<vk::MappedBuffer>(vk::MappedBuffer::create(
+                logical_device.get(),
+                memory_allocator.get(),
+                vk::BufferType::STORAGE_BUFFER,
+                buffers.instance_capacity * sizeof(glm::vec4)));
+            // Visible instances of every pass
+            buffers.visible_instances = std::make_unique<vk::MappedBuffer>(vk::MappedBuffer::create(
+                logical_device.get(),
+                memory_allocator.get(),
+                vk::BufferType::STORAGE_VERTEX_BUFFER,
+                buffers.instance_capacity * num_passes * sizeof(glm::vec4)));
+            buffers.draw_commands = std::make_unique<vk::MappedBuffer>(vk::MappedBuffer::create(
+                logical_device.get(),
+                memory_allocator.get(),
+                vk::BufferType::STORAGE_INDIRECT_BUFFER,
+                buffers.draw_command_capacity * sizeof(VkDrawIndexedIndirectCommand)));
+            buffers.uploaded_version = 0;
+
+            std::array<VkDescriptorBufferInfo, 3> buffer_infos{};
+            std::vector<std::vector<VkWriteDescriptorSet>> write_descriptor_sets(1);
+            const std::array<const vk::MappedBuffer*, 3> storage_buffers{
+                buffers.instances.get(), buffers.visible_instances.get(), buffers.draw_commands.get()
+            };
+            for (std::size_t i = 0; i < storage_buffers.size(); ++i) {
+                buffer_infos[i].buffer = storage_buffers[i]->get_buffer();
+                buffer_infos[i].offset = 0;
+                buffer_infos[i].range = VK_WHOLE_SIZE;
+                write_descriptor_sets[0].emplace_back(
+                    gfx::vk::WriteDescriptorSet::create_for_storage_buffer(buffer_infos[i], static_cast<std::uint32_t>(i)));
+            }
+            if (buffers.descriptor_set == VK_NULL_HANDLE) {
+                buffers.descriptor_set = descriptor_pool->allocate_sets(*culling_descriptor_set_layout, write_descriptor_sets, 1)[0];
+            }
+            else {
+                // The set is not used by the GPU anymore, because the frame it belongs to has finished
+                for (auto& write_descriptor : write_descriptor_sets[0]) {
+                    write_descriptor.dstSet = buffers.descriptor_set;
+                }
+                vkUpdateDescriptorSets(
+                    logical_device->get_device(),
+                    static_cast<std::uint32_t>(write_descriptor_sets[0].size()),
+                    write_descriptor_sets[0].data(),
+                    0, nullptr);
+            }
+        }
+        if (buffers.uploaded_version != retained_version) {
+            buffers.instances->upload(retained_data.data(), retained_data.size() * sizeof(glm::vec4));
+            buffers.uploaded_version = retained_version;
+        }
+
+        // The culling shader counts the visible instances into the draw commands, so they are reset every frame
+        std::vector<VkDrawIndexedIndirectCommand> draw_commands(num_draw_commands);
+        for (const auto& [key, instances] : retained_instances) {
+            const auto draw_command = create_draw_command(*key.first, 0, 0);
+            for (std::size_t pass = 0; pass < num_passes; ++pass) {
+                draw_commands[pass * retained_instances.size() + instances.draw_command_index] = draw_command;
+            }
+        }
+        buffers.draw_commands->upload(draw_commands.data(), draw_commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    void Renderer::cull_retained_instances(
+        VkCommandBuffer command_buffer,
+        const glm::mat4& view_projection_matrix,
+        const std::vector<ShadowCascade>& cascades) const {
+        if (retained_data.empty()) {
+            return;
+        }
+        const auto& buffers = culling_buffers[frame_index];
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling_pipeline->get_pipeline());
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            culling_pipeline->get_pipeline_layout(),
+            0, 1,
+            &buffers.descriptor_set,
+            0, nullptr);
+
+        static constexpr std::uint32_t workgroup_size = 64;
+        const auto dispatch = [&](const CullingPushConstants& constants) {
+            vkCmdPushConstants(
+                command_buffer,
+                culling_pipeline->get_pipeline_layout(),
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0, sizeof(CullingPushConstants),
+                &constants);
+            vkCmdDispatch(command_buffer, (constants.num_instances + workgroup_size - 1) / workgroup_size, 1, 1);
+        };
+        const auto camera_planes = Frustum::extract_planes(view_projection_matrix);
+        std::vector<std::array<glm::vec4, 6>> cascade_planes;
+        for (const auto& cascade : cascades) {
+            cascade_planes.emplace_back(Frustum::extract_planes(cascade.get_light_space_matrix()));
+        }
+        for (const auto& [key, instances] : retained_instances) {
+            if (instances.num_instances == 0) {
+                continue;
+            }
+            CullingPushConstants constants{
+                camera_planes,
+                instances.first_instance,
+                instances.num_instances,
+                instances.first_instance,
+                instances.draw_command_index,
+                instances.radius
+            };
+            dispatch(constants);
+            // Shadow casters outside of the camera frustum can still cast shadows into it
+            if (!key.second) {
+                continue;
+            }
+            for (const auto& planes : cascade_planes) {
+                constants.frustum_planes = planes;
+                constants.first_visible_instance += static_cast<std::uint32_t>(retained_data.size());
+                constants.draw_command_index += static_cast<std::uint32_t>(retained_instances.size());
+                dispatch(constants);
+            }
+        }
+
+        // The render passes read the visible instances as vertex input and the draw commands as indirect parameters
+        std::array<VkBufferMemoryBarrier, 2> barriers{};
+        barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].buffer = buffers.visible_instances->get_buffer();
+        barriers[0].offset = 0;
+        barriers[0].size = VK_WHOLE_SIZE;
+        barriers[1] = barriers[0];
+        barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        barriers[1].buffer = buffers.draw_commands->get_buffer();
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            0, nullptr,
+            static_cast<std::uint32_t>(barriers.size()), barriers.data(),
+            0, nullptr);
+    }
+
+    std::uint32_t Renderer::render_retained_instances(VkCommandBuffer command_buffer, std::size_t pass) const {
+        if (retained_data.empty()) {
+            return 0;
+        }
+        // Every pass has its own region of the visible instances and the draw commands
+        const auto& buffers = culling_buffers[frame_index];
+        const auto shadow_casters_only = pass > 0;
+        const auto first_visible_instance = pass * retained_data.size();
+        const auto first_draw_command = pass * retained_instances.size();
+        std::uint32_t num_draw_calls = 0;
+        for (const auto& [key, instances] : retained_instances) {
+            const auto [mesh, shadow_caster] = key;
+            if ((shadow_casters_only && !shadow_caster) || instances.num_instances == 0) {
+                continue;
+            }
+            std::array<VkDeviceSize, 2> offsets{ 0, (first_visible_instance + instances.first_instance) * sizeof(glm::vec4) };
+            std::array<VkBuffer, 2> buffer_handles{
+                mesh->get_buffer().get_buffer(),
+                buffers.visible_instances->get_buffer()
+            };
+            vkCmdBindVertexBuffers(command_buffer, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
+            // The instance count is written by the culling shader, and a single command per draw does not need multiDrawIndirect
+            draw_indirect(
+                command_buffer,
+                *mesh,
+                buffers.draw_commands->get_buffer(),
+                (first_draw_command + instances.draw_command_index) * sizeof(VkDrawIndexedIndirectCommand),
+                1);
+            ++num_draw_calls;
+        }
+        return num_draw_calls;
+    }
+
+    std::uint32_t Renderer::render_static_shadow_casters(
+        VkCommandBuffer command_buffer,
+        std::size_t cascade,
+        const BuildingDraws& building_draws) const {
+        const auto& descriptor_set = shadow_map_descriptor_sets[frame_index * ShadowCascades::MAX_CASCADES + cascade];
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_map_instanced_pipeline->get_pipeline());
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            shadow_map_instanced_pipeline->get_pipeline_layout(),
+            0, 1,
+            &descriptor_set,
+            0, nullptr);
+        auto num_draw_calls = render_retained_instances(command_buffer, 1 + cascade);
+
+        // Render building shadows
+        if (!building_draws.batches.empty()) {
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_map_building_pipeline->get_pipeline());
+            vkCmdBindDescriptorSets(
+                command_buffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                shadow_map_building_pipeline->get_pipeline_layout(),
+                0, 1,
+                &descriptor_set,
+                0, nullptr);
+            num_draw_calls += render_building_batches(command_buffer, building_draws);
+        }
+        return num_draw_calls;
+    }
+
+    std::uint32_t Renderer::render_dynamic_shadow_casters(
+        VkCommandBuffer command_buffer,
+        std::size_t cascade,
+        const std::vector<InstanceBatch>& caster_batches,
+        const vk::RingBufferAllocation& caster_allocation) const {
+        const auto& descriptor_set = shadow_map_descriptor_sets[frame_index * ShadowCascades::MAX_CASCADES + cascade];
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_map_pipeline->get_pipeline());
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            shadow_map_pipeline->get_pipeline_layout(),
+            0, 1,
+            &descriptor_set,
+            0, nullptr);
+
+        // Casters in the caster volume are only drawn into the cascades they overlap
+        std::uint32_t num_draw_calls = 0;
+        const auto cascade_planes = Frustum::extract_planes(shadow_cascades[cascade].get_light_space_matrix());
+        for (const auto& caster : shadow_casters_to_render) {
+            if (!Frustum::is_sphere_inside(cascade_planes, caster.center, caster.radius)) {
+                continue;
+            }
+            // Push model matrix
+            PushConstants constants{ caster.mesh->get_model_matrix(), 0 };
+            vkCmdPushConstants(
+                command_buffer,
+                shadow_map_pipeline->get_pipeline_layout(),
+                VK_SHADER_STAGE_VERTEX_BIT,
+                0, sizeof(PushConstants),
+                &constants);
+            static const VkDeviceSize offset = 0;
+            const auto buffer_handle = caster.mesh->get_buffer().get_buffer();
+            vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer_handle, &offset);
+            draw_mesh(command_buffer, *caster.mesh, 1);
+            ++num_draw_calls;
+        }
+
+        // Render instanced shadow casters
+        if (caster_batches.empty()) {
+            return num_draw_calls;
+        }
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadow_map_instanced_pipeline->get_pipeline());
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            shadow_map_instanced_pipeline->get_pipeline_layout(),
+            0, 1,
+            &descriptor_set,
+            0, nullptr);
+        for (const auto& batch : caster_batches) {
+            std::array<VkDeviceSize, 2> offsets{ 0, caster_allocation.offset + batch.offset };
+            std::array<VkBuffer, 2> buffer_handles{
+                batch.mesh->get_buffer().get_buffer(),
+                caster_allocation.buffer
+            };
+            vkCmdBindVertexBuffers(command_buffer, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
+            draw_mesh(command_buffer, *batch.mesh, batch.num_instances);
+            ++num_draw_calls;
+        }
+        return num_draw_calls;
+    }
+
+    Renderer::RecordedJobs Renderer::record_jobs(const std::vector<RecordingJob>& jobs) {
+        // Command pools are only created on the calling thread, and only reset after the frame has finished on the GPU
+        auto& contexts = recording_contexts[frame_index];
+        while (contexts.size() < jobs.size()) {
+            auto command_pool = vk::CommandPool::create_command_pool(logical_device.get(), physical_device->get_queue_family_indices());
+            const auto command_buffer = command_pool.allocate_secondary_buffer();
+            contexts.emplace_back(RecordingContext{ std::move(command_pool), command_buffer });
+        }
+
+        RecordedJobs result;
+        result.command_buffers.resize(jobs.size());
+        result.num_draw_calls.resize(jobs.size());
+        const auto record = [&](std::size_t index) {
+            const auto& job = jobs[index];
+            const auto& recording_context = contexts[index];
+            recording_context.command_pool.reset();
+            const auto& command_buffer = recording_context.command_buffer;
+            command_buffer.begin(*job.render_pass, *job.framebuffer);
+            result.num_draw_calls[index] = job.record(command_buffer.get_command_buffer());
+            command_buffer.end();
+            result.command_buffers[index] = command_buffer.get_command_buffer();
+        };
+        if (context.parallel_command_recording) {
+            recording_thread_pool.parallel_for(jobs.size(), record);
+        }
+        else {
+            for (std::size_t i = 0; i < jobs.size(); ++i) {
+                record(i);
+            }
+        }
+        return result;
+    }
+
+    void Renderer::copy_static_shadow_map(VkCommandBuffer command_buffer) const {
+        // The static shadow map is read by the copy after its casters were drawn, the previous contents of the shadow map
+        // are discarded once the color pass of the previous frame stopped sampling it
+        std::array<VkImageMemoryBarrier, 2> barriers{};
+        barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].image = static_shadow_map_depth_buffer->get_image().get_image();
+        barriers[0].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+        barriers[1] = barriers[0];
+        barriers[1].srcAccessMask = 0;
+        barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].image = shadow_map_depth_buffer->get_image().get_image();
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            static_cast<std::uint32_t>(barriers.size()), barriers.data());
+
+        std::vector<VkImageCopy> regions;
+        for (std::size_t i = 0; i < shadow_cascades.size(); ++i) {
+            const auto tile = get_shadow_cascade_tile(i);
+            VkImageCopy region{};
+            region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+            region.srcOffset = { tile.offset.x, tile.offset.y, 0 };
+            region.dstSubresource = region.srcSubresource;
+            region.dstOffset = region.srcOffset;
+            region.extent = { tile.extent.width, tile.extent.height, 1 };
+            regions.emplace_back(region);
+        }
+        vkCmdCopyImage(
+            command_buffer,
+            barriers[0].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            barriers[1].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<std::uint32_t>(regions.size()), regions.data());
+
+        // Both shadow maps go back to the layout the shadow map render passes that preserve the contents begin with
+        barriers[0].srcAccessMask = 0;
+        barriers[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            static_cast<std::uint32_t>(barriers.size()), barriers.data());
+    }
+
+    Renderer::BuildingDraws Renderer::upload_building_instances(const std::vector<BuildingMeshToRender>& entries, bool shadow_casters_only) {
+        BuildingDraws result;
+        std::vector<vk::BuildingInstance> data_to_upload;
+        result.batches = batch_instances(
+            entries,
+            data_to_upload,
+            [&](const BuildingMeshToRender& entry, std::vector<vk::BuildingInstance>& data) {
+                if (!shadow_casters_only) {
+                    data.insert(data.end(), entry.instances.cbegin(), entry.instances.cend());
+                    return;
+                }
+                const auto radius = compute_instance_radius(*entry.mesh);
+                for (const auto& instance : entry.instances) {
+                    if (shadow_caster_volume.is_sphere_inside(instance.position, radius)) {
+                        data.emplace_back(instance);
+                        ++shadow_caster_statistics.drawn;
+                    }
+                    else {
+                        ++shadow_caster_statistics.culled;
+                    }
+                }
+            });
+        if (result.batches.empty()) {
+            return result;
+        }
+        result.instances = instance_data_ring->upload(
+            data_to_upload.data(), data_to_upload.size() * sizeof(vk::BuildingInstance), INSTANCE_DATA_ALIGNMENT);
+        // Instances are addressed by the first instance of the draw commands, so all batches share a single binding
+        for (const auto& batch : result.batches) {
+            result.draw_commands.emplace_back(create_draw_command(
+                *batch.mesh,
+                batch.num_instances,
+                static_cast<std::uint32_t>(batch.offset / sizeof(vk::BuildingInstance))));
+        }
+        result.draw_commands_allocation = instance_data_ring->upload(
+            result.draw_commands.data(),
+            result.draw_commands.size() * sizeof(VkDrawIndexedIndirectCommand),
+            INSTANCE_DATA_ALIGNMENT);
+        return result;
+    }
+
+    std::uint32_t Renderer::render_building_batches(VkCommandBuffer command_buffer, const BuildingDraws& draws) const {
+        const auto& batches = draws.batches;
+        const auto& draw_commands = draws.draw_commands;
+        const auto& instances = draws.instances;
+        const auto& draw_commands_allocation = draws.draw_commands_allocation;
+        const auto multi_draw_indirect = physical_device->is_multi_draw_indirect_supported();
+        const auto get_index_buffer = [](const Mesh& mesh) {
+            return mesh.is_indexed() ? mesh.get_index_buffer().get_buffer() : VK_NULL_HANDLE;
+        };
+        std::uint32_t num_draw_calls = 0;
+        for (std::size_t first = 0; first < batches.size();) {
+            // Batches whose meshes share their buffers are drawn together, building cell meshes all share the same ones
+            const auto& first_mesh = *batches[first].mesh;
+            const auto vertex_buffer = first_mesh.get_buffer().get_buffer();
+            const auto index_buffer = get_index_buffer(first_mesh);
+            auto last = first + 1;
+            while (last < batches.size() &&
+                batches[last].mesh->get_buffer().get_buffer() == vertex_buffer &&
+                get_index_buffer(*batches[last].mesh) == index_buffer) {
+                ++last;
+            }
+            std::array<VkDeviceSize, 2> offsets{ 0, instances.offset };
+            std::array<VkBuffer, 2> buffer_handles{ vertex_buffer, instances.buffer };
+            vkCmdBindVertexBuffers(command_buffer, 0, static_cast<std::uint32_t>(buffer_handles.size()), buffer_handles.data(), offsets.data());
+            if (multi_draw_indirect) {
+                draw_indirect(
+                    command_buffer,
+                    first_mesh,
+                    draw_commands_allocation.buffer,
+                    draw_commands_allocation.offset + first * sizeof(VkDrawIndexedIndirectCommand),
+                    static_cast<std::uint32_t>(last - first));
+                ++num_draw_calls;
+            }
+            else {
+                // Without the features, the same commands are recorded one by one, which still avoids rebinding buffers
+                for (auto i = first; i < last; ++i) {
+                    draw_mesh(command_buffer, *batches[i].mesh, draw_commands[i].instanceCount, draw_commands[i].firstInstance);
+                    ++num_draw_calls;
+                }
+            }
+            first = last;
+        }
+        return num_draw_calls;
+    }
+
+    VkExtent2D Renderer::get_shadow_map_extent() const {
+        // Every shadow cascade is rendered into its own tile of the shadow map atlas
+        return {
+            shadow_cascade_resolution * static_cast<std::uint32_t>(ShadowCascades::ATLAS_COLUMNS),
+            shadow_cascade_resolution * static_cast<std::uint32_t>(ShadowCascades::ATLAS_ROWS) };
+    }
+
+    VkRect2D Renderer::get_shadow_cascade_tile(std::size_t cascade) const {
+        VkRect2D result{};
+        result.offset = {
+            static_cast<std::int32_t>((cascade % ShadowCascades::ATLAS_COLUMNS) * shadow_cascade_resolution),
+            static_cast<std::int32_t>((cascade / ShadowCascades::ATLAS_COLUMNS) * shadow_cascade_resolution) };
+        result.extent = { shadow_cascade_resolution, shadow_cascade_resolution };
+        return result;
+    }
+
+    void Renderer::set_shadow_cascade_viewport(VkCommandBuffer command_buffer, std::size_t cascade) const {
+        // Since the viewport and the scissor is dynamic we need to supply it each frame
+        const auto tile = get_shadow_cascade_tile(cascade);
+        VkViewport viewport{};
+        viewport.x = static_cast<float>(tile.offset.x);
+        viewport.y = static_cast<float>(tile.offset.y);
+        viewport.width = static_cast<float>(tile.extent.width);
+        viewport.height = static_cast<float>(tile.extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &tile);
+    }
+
+    void Renderer::draw_mesh(VkCommandBuffer command_buffer, const Mesh& mesh, std::uint32_t num_instances, std::uint32_t first_instance) {
+        if (!mesh.is_indexed()) {
+            vkCmdDraw(
+                command_buffer,
+                static_cast<std::uint32_t>(mesh.get_number_of_vertices()),
+                num_instances,
+                mesh.get_first_vertex(),
+                first_instance);
+            return;
+        }
+        vkCmdBindIndexBuffer(command_buffer, mesh.get_index_buffer().get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(
+            command_buffer,
+            static_cast<std::uint32_t>(mesh.get_number_of_indices()),
+            num_instances,
+            mesh.get_first_index(),
+            static_cast<std::int32_t>(mesh.get_first_vertex()),
+            first_instance);
+    }
+
+    void Renderer::draw_indirect(
+        VkCommandBuffer command_buffer,
+        const Mesh& mesh,
+        VkBuffer draw_commands,
+        VkDeviceSize offset,
+        std::uint32_t num_draw_commands) {
+        // Draw commands of both kinds are stored with the stride of the indexed ones, see create_draw_command()
+        if (!mesh.is_indexed()) {
+            vkCmdDrawIndirect(command_buffer, draw_commands, offset, num_draw_commands, sizeof(VkDrawIndexedIndirectCommand));
+            return;
+        }
+        vkCmdBindIndexBuffer(command_buffer, mesh.get_index_buffer().get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexedIndirect(command_buffer, draw_commands, offset, num_draw_commands, sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    VkDrawIndexedIndirectCommand Renderer::create_draw_command(const Mesh& mesh, std::uint32_t num_instances, std::uint32_t first_instance) {
+        VkDrawIndexedIndirectCommand result{};
+        if (mesh.is_indexed()) {
+            result.indexCount = static_cast<std::uint32_t>(mesh.get_number_of_indices());
+            result.instanceCount = num_instances;
+            result.firstIndex = mesh.get_first_index();
+            result.vertexOffset = static_cast<std::int32_t>(mesh.get_first_vertex());
+            result.firstInstance = first_instance;
+            return result;
+        }
+        // Non-indexed draw commands are stored at the start of the slot, the instance count has the same offset in both
+        const VkDrawIndirectCommand draw_command{
+            static_cast<std::uint32_t>(mesh.get_number_of_vertices()), num_instances, mesh.get_first_vertex(), first_instance };
+        std::memcpy(&result, &draw_command, sizeof(VkDrawIndirectCommand));
+        return result;
+    }
+
+    float Renderer::compute_instance_radius(const Mesh& mesh) {
+        const auto& bounding_box = mesh.get_bounding_box_in_model_space();
+        return glm::length(glm::max(glm::abs(bounding_box.min), glm::abs(bounding_box.max)));
+    }
+
+    void Renderer::append_instances(const InstancedMeshToRender& entry, std::vector<glm::vec4>& data) {
+        // Instance data is interleaved as [x, y, z, rotation]
+        for (std::size_t i = 0; i < entry.positions.size(); ++i) {
+            data.emplace_back(entry.positions[i], entry.rotations[i]);
+        }
+    }
+
+    std::vector<glm::vec4> Renderer::interleave_instances(const std::vector<glm::vec3>& positions, const std::vector<float>& rotations) {
+        std::vector<glm::vec4> result;
+        result.reserve(positions.size());
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            result.emplace_back(positions[i], rotations[i]);
+        }
+        return result;
+    }
+
     void Renderer::destroy_imgui() {
         ImGui_ImplVulkan_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
     }
 
+    void Renderer::create_shadow_maps() {
+        // The framebuffers are destroyed before the shadow maps they reference
+        shadow_map_framebuffer.reset();
+        static_shadow_map_framebuffer.reset();
+
+        // Create a separate depth buffer for the shadow map atlas that will be sampled during the second render pass
+        const auto shadow_map_extent = get_shadow_map_extent();
+        shadow_map_depth_buffer = std::make_unique<vk::DepthBuffer>(vk::DepthBuffer::create(
+            logical_device.get(), memory_allocator.get(), shadow_map_extent, VK_SAMPLE_COUNT_1_BIT, true, VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+        // The cached shadow map of the static casters is copied into it every frame
+        static_shadow_map_depth_buffer = std::make_unique<vk::DepthBuffer>(vk::DepthBuffer::create(
+            logical_device.get(), memory_allocator.get(), shadow_map_extent, VK_SAMPLE_COUNT_1_BIT, false, VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+
+        // Create framebuffers for the shadow map
+        shadow_map_framebuffer = std::make_unique<vk::Framebuffer>(vk::Framebuffer::create_for_shadow_map(
+            logical_device.get(), *shadow_map_render_pass, shadow_map_depth_buffer->get_image_view(), shadow_map_extent));
+        static_shadow_map_framebuffer = std::make_unique<vk::Framebuffer>(vk::Framebuffer::create_for_shadow_map(
+            logical_device.get(), *shadow_map_render_pass, static_shadow_map_depth_buffer->get_image_view(), shadow_map_extent));
+    }
+
+    void Renderer::update_shadow_map_descriptor_sets() {
+        VkDescriptorImageInfo image_info{};
+        image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        image_info.imageView = shadow_map_depth_buffer->get_image_view().get_image_view();
+        image_info.sampler = shadow_map_sampler->get_sampler();
+        // The building descriptor sets are only allocated once the palette has been set
+        std::vector<VkWriteDescriptorSet> write_descriptor_sets;
+        for (const auto& sets : { &descriptor_sets, &building_descriptor_sets }) {
+            for (const auto descriptor_set : *sets) {
+                auto write_descriptor = gfx::vk::WriteDescriptorSet::create_for_sampler(image_info, 1);
+                write_descriptor.dstSet = descriptor_set;
+                write_descriptor_sets.emplace_back(write_descriptor);
+            }
+        }
+        vkUpdateDescriptorSets(
+            logical_device->get_device(),
+            static_cast<std::uint32_t>(write_descriptor_sets.size()),
+            write_descriptor_sets.data(),
+            0, nullptr);
+    }
+
     void Renderer::init_imgui(const Window& window, VkSampleCountFlagBits sample_count) {
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
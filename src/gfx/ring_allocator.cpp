@@ -0,0 +1,76 @@
+#include "gfx/ring_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace inf::gfx {
+
+    static std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    RingAllocator::RingAllocator(std::uint64_t capacity, std::size_t num_frames) :
+        capacity(capacity), head(0), tail(0), used(0), high_water_mark(0), current_frame(0),
+        frames(num_frames, FrameAllocations{ 0, 0 }) {
+        if (num_frames == 0) {
+            throw std::runtime_error("Ring allocator needs at least one frame.");
+        }
+    }
+
+    void RingAllocator::begin_frame(std::size_t frame) {
+        // The frame being begun is the oldest one in flight, so its allocations are at the tail of the ring
+        auto& allocations = frames.at(frame);
+        used -= allocations.size;
+        tail = allocations.end;
+        if (used == 0) {
+            head = 0;
+            tail = 0;
+        }
+        allocations = FrameAllocations{ head, 0 };
+        current_frame = frame;
+    }
+
+    std::optional<std::uint64_t> RingAllocator::allocate(std::uint64_t size, std::uint64_t alignment) {
+        const auto offset = align_up(head, alignment);
+        std::optional<std::uint64_t> result;
+        if (used == 0 || head > tail) {
+            // The free space is split into the end of the buffer and its beginning up to the tail
+            if (offset + size <= capacity) {
+                result = offset;
+            }
+            else if (size <= tail || (used == 0 && size <= capacity)) {
+                result = 0;
+            }
+        }
+        else if (head < tail && offset + size <= tail) {
+            result = offset;
+        }
+        if (!result) {
+            return std::nullopt;
+        }
+
+        // Padding and the space skipped at the end of the buffer when wrapping around belong to the allocation
+        const auto new_head = result.value() + size;
+        const auto allocated = new_head >= head ? new_head - head : capacity - head + new_head;
+        head = new_head;
+        used += allocated;
+        high_water_mark = std::max(high_water_mark, used);
+        auto& allocations = frames[current_frame];
+        allocations.end = head;
+        allocations.size += allocated;
+        return result;
+    }
+
+    void RingAllocator::reset(std::uint64_t capacity) {
+        this->capacity = capacity;
+        head = 0;
+        tail = 0;
+        used = 0;
+        std::fill(frames.begin(), frames.end(), FrameAllocations{ 0, 0 });
+    }
+
+    RingStatistics RingAllocator::get_statistics() const {
+        return RingStatistics{ capacity, used, high_water_mark };
+    }
+
+}
@@ -0,0 +1,210 @@
+#include "gfx/shadow_cascades.h"
+#include "gfx/frustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace inf::gfx {
+
+    // Corners of a slice of the camera frustum in world space, in the order of the Frustum point indices
+    static std::array<glm::vec3, 8> compute_slice_corners(const glm::mat4& view_matrix, float fovy, float aspect, float near, float far) {
+        const auto inverse_view_matrix = glm::inverse(view_matrix);
+        const auto tan_half_fovy = std::tan(fovy * 0.5f);
+        std::array<glm::vec3, 8> result;
+        std::size_t index = 0;
+        for (const auto distance : { near, far }) {
+            const auto half_height = distance * tan_half_fovy;
+            const auto half_width = half_height * aspect;
+            for (const auto y : { -half_height, half_height }) {
+                for (const auto x : { -half_width, half_width }) {
+                    result[index++] = glm::vec3(inverse_view_matrix * glm::vec4(x, y, -distance, 1.0f));
+                }
+            }
+        }
+        return result;
+    }
+
+    static glm::vec3 compute_center(const std::array<glm::vec3, 8>& corners) {
+        glm::vec3 result(0.0f);
+        for (const auto& corner : corners) {
+            result += corner;
+        }
+        return result / static_cast<float>(corners.size());
+    }
+
+    // Plane through the point with its normal oriented towards inside
+    static glm::vec4 create_plane(const glm::vec3& normal, const glm::vec3& point, const glm::vec3& inside) {
+        auto oriented_normal = glm::normalize(normal);
+        if (glm::dot(oriented_normal, inside - point) < 0.0f) {
+            oriented_normal = -oriented_normal;
+        }
+        return glm::vec4(oriented_normal, -glm::dot(oriented_normal, point));
+    }
+
+    glm::mat4 ShadowCascade::get_light_space_matrix() const {
+        return projection_matrix * view_matrix;
+    }
+
+    std::vector<float> ShadowCascades::compute_split_distances(float near, float far, std::size_t count, float lambda) {
+        if (count == 0 || near <= 0.0f || far <= near) {
+            throw std::runtime_error("Invalid shadow cascade split parameters.");
+        }
+        std::vector<float> result(count + 1);
+        for (std::size_t i = 0; i <= count; ++i) {
+            const auto t = static_cast<float>(i) / static_cast<float>(count);
+            const auto logarithmic = near * std::pow(far / near, t);
+            const auto uniform = near + (far - near) * t;
+            result[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+        }
+        // Avoid rounding errors at the ends, the first and the last cascade have to meet the camera frustum exactly
+        result.front() = near;
+        result.back() = far;
+        return result;
+    }
+
+    ShadowCascade ShadowCascades::fit(
+        const glm::mat4& view_matrix,
+        float fovy,
+        float aspect,
+        float near,
+        float far,
+        const glm::vec3& light_direction,
+        float caster_distance,
+        float margin,
+        std::uint32_t resolution) {
+        const auto corners = compute_slice_corners(view_matrix, fovy, aspect, near, far);
+        const auto center = compute_center(corners);
+        float radius = 0.0f;
+        for (const auto& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius *= 1.0f + margin;
+        // The radius only depends on the shape of the slice, rounding it up removes the jitter of floating point errors
+        static constexpr float radius_granularity = 16.0f;
+        radius = std::ceil(radius * radius_granularity) / radius_granularity;
+
+        // The light looks at the center of the slice from behind the casters
+        const auto up = std::abs(light_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        const auto eye = center - light_direction * (radius + caster_distance);
+        ShadowCascade result;
+        result.view_matrix = glm::lookAt(eye, center, up);
+        // Depth is mapped to [0, 1] for Vulkan regardless of the GLM configuration of the including target
+        result.projection_matrix = glm::orthoRH_ZO(-radius, radius, -radius, radius, 0.0f, caster_distance + 2.0f * radius);
+        result.near_distance = near;
+        result.far_distance = far;
+
+        // Move the projection so that the world origin falls onto a texel corner, then every world position is
+        // projected onto the same position within its texel no matter where the camera is
+        const auto half_resolution = static_cast<float>(resolution) * 0.5f;
+        const auto origin = result.get_light_space_matrix() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        const auto origin_in_texels = glm::vec2(origin.x, origin.y) * half_resolution;
+        const auto offset = (glm::round(origin_in_texels) - origin_in_texels) / half_resolution;
+        result.projection_matrix[3][0] += offset.x;
+        result.projection_matrix[3][1] += offset.y;
+        return result;
+    }
+
+    bool ShadowCascades::covers(
+        const ShadowCascade& cascade,
+        const glm::mat4& view_matrix,
+        float fovy,
+        float aspect,
+        float near,
+        float far) {
+        const auto light_space_matrix = cascade.get_light_space_matrix();
+        for (const auto& corner : compute_slice_corners(view_matrix, fovy, aspect, near, far)) {
+            const auto projected = light_space_matrix * glm::vec4(corner, 1.0f);
+            if (std::abs(projected.x) > 1.0f || std::abs(projected.y) > 1.0f || projected.z < 0.0f || projected.z > 1.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ShadowCasterVolume::ShadowCasterVolume(
+        const glm::mat4& view_matrix,
+        float fovy,
+        float aspect,
+        float near,
+        float far,
+        const glm::vec3& light_direction) {
+        // Faces of the slice by the indices of their corners, see compute_slice_corners()
+        static constexpr std::array<std::array<std::size_t, 4>, 6> faces{{
+            { 0, 1, 2, 3 }, // Near
+            { 4, 5, 6, 7 }, // Far
+            { 0, 2, 4, 6 }, // Left
+            { 1, 3, 5, 7 }, // Right
+            { 0, 1, 4, 5 }, // Bottom
+            { 2, 3, 6, 7 }  // Top
+        }};
+        const auto corners = compute_slice_corners(view_matrix, fovy, aspect, near, far);
+        const auto center = compute_center(corners);
+        auto& planes = convex_volumes.emplace_back();
+
+        // Extruding the slice towards the light moves the faces whose inward normal points along the light away, so only
+        // the faces facing the light bound the volume
+        std::array<bool, faces.size()> is_bounding_face;
+        for (std::size_t i = 0; i < faces.size(); ++i) {
+            const auto& face = faces[i];
+            const auto plane = create_plane(
+                glm::cross(corners[face[1]] - corners[face[0]], corners[face[2]] - corners[face[0]]), corners[face[0]], center);
+            is_bounding_face[i] = glm::dot(glm::vec3(plane), light_direction) <= 0.0f;
+            if (is_bounding_face[i]) {
+                planes.emplace_back(plane);
+            }
+        }
+
+        // The edges between a bounding face and a face that is moved away form the silhouette of the slice from the light,
+        // which is extruded into a plane along the light direction
+        const auto contains = [](const std::array<std::size_t, 4>& face, std::size_t corner) {
+            return std::find(face.cbegin(), face.cend(), corner) != face.cend();
+        };
+        for (std::size_t first = 0; first < corners.size(); ++first) {
+            for (std::size_t second = first + 1; second < corners.size(); ++second) {
+                // Corners are connected by an edge if they share two faces, diagonals of a face only share a single one
+                std::vector<std::size_t> shared_faces;
+                for (std::size_t i = 0; i < faces.size(); ++i) {
+                    if (contains(faces[i], first) && contains(faces[i], second)) {
+                        shared_faces.emplace_back(i);
+                    }
+                }
+                if (shared_faces.size() != 2 || is_bounding_face[shared_faces[0]] == is_bounding_face[shared_faces[1]]) {
+                    continue;
+                }
+                const auto normal = glm::cross(corners[second] - corners[first], light_direction);
+                // Edges parallel to the light do not bound the volume
+                if (glm::length(normal) < 1e-6f) {
+                    continue;
+                }
+                planes.emplace_back(create_plane(normal, corners[first], center));
+            }
+        }
+    }
+
+    ShadowCasterVolume::ShadowCasterVolume(const std::vector<ShadowCascade>& cascades) {
+        for (const auto& cascade : cascades) {
+            const auto planes = Frustum::extract_planes(cascade.get_light_space_matrix());
+            convex_volumes.emplace_back(planes.cbegin(), planes.cend());
+        }
+    }
+
+    bool ShadowCasterVolume::is_sphere_inside(const glm::vec3& center, float radius) const {
+        if (convex_volumes.empty()) {
+            return true;
+        }
+        const auto is_inside = [&](const std::vector<glm::vec4>& planes) {
+            for (const auto& plane : planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        return std::any_of(convex_volumes.cbegin(), convex_volumes.cend(), is_inside);
+    }
+
+}
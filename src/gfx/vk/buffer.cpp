@@ -80,21 +80,24 @@ namespace inf::gfx::vk {
         return buffer;
     }
 
-    void MappedBuffer::upload(const void* data, std::size_t size) const {
+    std::uint64_t MappedBuffer::get_size() const {
+        return size;
+    }
+
+    void MappedBuffer::upload(const void* data, std::size_t size, std::uint64_t offset) const {
         if (size == 0) {
             return;
         }
-        // TODO: Handle this correctly by expanding the buffer
-        if (size > this->size) {
-            throw std::runtime_error("Uploaded data (" + std::to_string(size) +
+        if (offset + size > this->size) {
+            throw std::runtime_error("Uploaded data (" + std::to_string(size) + " bytes at offset " + std::to_string(offset) +
                 ") exceeds buffer size (" + std::to_string(this->size) + ").");
         }
         // TODO: This can be simplified to vmaCopyMemoryToAllocation in VMA 3.1.0
         void* destination;
         vmaMapMemory(allocator->get_allocator(), allocation, &destination);
-        std::memcpy(destination, data, size);
+        std::memcpy(static_cast<std::uint8_t*>(destination) + offset, data, size);
         vmaUnmapMemory(allocator->get_allocator(), allocation);
-        vmaFlushAllocation(allocator->get_allocator(), allocation, 0, size);
+        vmaFlushAllocation(allocator->get_allocator(), allocation, offset, size);
     }
 
 }
\ No newline at end of file
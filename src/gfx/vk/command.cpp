@@ -1,4 +1,6 @@
 #include "gfx/vk/command.h"
+#include "gfx/vk/pipeline.h"
+#include "gfx/vk/framebuffer.h"
 
 #include <utility>
 #include <stdexcept>
@@ -24,12 +26,40 @@ namespace inf::gfx::vk {
         }
     }
 
+    void CommandBuffer::begin(const RenderPass& render_pass, const Framebuffer& framebuffer) const {
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = render_pass.get_render_pass();
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = framebuffer.get_framebuffer();
+
+        VkCommandBufferBeginInfo command_buffer_begin_info{};
+        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        command_buffer_begin_info.flags =
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        command_buffer_begin_info.pInheritanceInfo = &inheritance_info;
+        if (vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to start recording to Vulkan secondary command buffer.");
+        }
+    }
+
     void CommandBuffer::end() const {
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("Failed to stop recording to Vulkan command buffer.");
         }
     }
 
+    void CommandBuffer::execute(const std::vector<VkCommandBuffer>& secondary_command_buffers) const {
+        if (secondary_command_buffers.empty()) {
+            return;
+        }
+        vkCmdExecuteCommands(
+            command_buffer,
+            static_cast<std::uint32_t>(secondary_command_buffers.size()),
+            secondary_command_buffers.data());
+    }
+
     void CommandBuffer::submit(
         VkQueue queue,
         const Semaphore& wait_semaphore,
@@ -94,10 +124,24 @@ namespace inf::gfx::vk {
     }
 
     CommandBuffer CommandPool::allocate_buffer() const {
+        return allocate_buffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    }
+
+    CommandBuffer CommandPool::allocate_secondary_buffer() const {
+        return allocate_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    }
+
+    void CommandPool::reset() const {
+        if (vkResetCommandPool(device->get_device(), command_pool, 0) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to reset Vulkan command pool.");
+        }
+    }
+
+    CommandBuffer CommandPool::allocate_buffer(VkCommandBufferLevel level) const {
         VkCommandBufferAllocateInfo buffer_allocate_info{};
         buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         buffer_allocate_info.commandPool = command_pool;
-        buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        buffer_allocate_info.level = level;
         buffer_allocate_info.commandBufferCount = 1;
 
         VkCommandBuffer command_buffer;
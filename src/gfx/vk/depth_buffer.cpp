@@ -7,7 +7,8 @@ namespace inf::gfx::vk {
         const MemoryAllocator* allocator,
         const VkExtent2D& extent,
         VkSampleCountFlagBits samples,
-        bool is_sampled) {
+        bool is_sampled,
+        VkImageUsageFlags additional_usage) {
         static constexpr auto depth_format = VK_FORMAT_D32_SFLOAT;
         auto image = Image::create(
             allocator,
@@ -15,9 +16,9 @@ namespace inf::gfx::vk {
             extent.height,
             depth_format,
             VK_IMAGE_TILING_OPTIMAL,
-            is_sampled
+            (is_sampled
                 ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
-                : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) | additional_usage,
             samples);
         auto image_view = ImageView::create(
             logical_device,
@@ -47,11 +47,13 @@ namespace inf::gfx::vk {
     }
 
     DescriptorPool DescriptorPool::create(const LogicalDevice* device, std::uint32_t size) {
-        std::array<VkDescriptorPoolSize, 2> pool_sizes;
+        std::array<VkDescriptorPoolSize, 3> pool_sizes;
         pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         pool_sizes[0].descriptorCount = size;
         pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         pool_sizes[1].descriptorCount = size;
+        pool_sizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        pool_sizes[2].descriptorCount = size;
 
         VkDescriptorPoolCreateInfo pool_create_info{};
         pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -142,6 +144,15 @@ namespace inf::gfx::vk {
         return write_descriptor;
     }
 
+    VkWriteDescriptorSet WriteDescriptorSet::create_for_storage_buffer(
+        const VkDescriptorBufferInfo& buffer_info,
+        std::uint32_t binding) {
+        auto write_descriptor = create_for_buffer(buffer_info, binding);
+        write_descriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+        return write_descriptor;
+    }
+
     VkWriteDescriptorSet WriteDescriptorSet::create_for_sampler(
         const VkDescriptorImageInfo& image_info,
         std::uint32_t binding) {
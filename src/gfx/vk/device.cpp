@@ -172,6 +172,7 @@ namespace inf::gfx::vk {
     PhysicalDevice::PhysicalDevice(const VkPhysicalDevice& device, const Surface& surface) :
         device(device), supports_required_extensions(false) {
         vkGetPhysicalDeviceProperties(device, &properties);
+        vkGetPhysicalDeviceFeatures(device, &features);
 
         // Build queue family indices
         std::uint32_t queue_family_count = 0;
@@ -180,7 +181,8 @@ namespace inf::gfx::vk {
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_family_properties.data());
         for (std::size_t i = 0; i < queue_family_properties.size(); ++i) {
             const auto& queue_family = queue_family_properties[i];
-            if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            // Instance culling is dispatched on the graphics queue, so the family has to support compute as well
+            if ((queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
                 queue_family_indices.graphics_family = static_cast<std::uint32_t>(i);
             }
 
@@ -240,7 +242,10 @@ namespace inf::gfx::vk {
 
     LogicalDevice PhysicalDevice::create_logical_device(const Surface& surface) const {
         const auto queue_create_info = queue_family_indices.to_queue_create_info();
+        // Optional features are enabled when available, the renderer falls back to equivalent commands otherwise
         VkPhysicalDeviceFeatures device_features{};
+        device_features.multiDrawIndirect = features.multiDrawIndirect;
+        device_features.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
 
         VkDeviceCreateInfo device_create_info{};
         device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -321,6 +326,10 @@ namespace inf::gfx::vk {
         return max_sample_count & sample_count_bits;
     }
 
+    bool PhysicalDevice::is_multi_draw_indirect_supported() const {
+        return features.multiDrawIndirect && features.drawIndirectFirstInstance;
+    }
+
     PhysicalDevice Device::choose_optimal_device(const Instance& instance, const Surface& surface) {
         std::uint32_t device_count = 0;
         vkEnumeratePhysicalDevices(instance.get_instance(), &device_count, nullptr);
@@ -118,16 +118,18 @@ namespace inf::gfx::vk {
         return RenderPass(device, render_pass);
     }
 
-    RenderPass RenderPass::create_shadow_render_pass(const LogicalDevice* device) {
+    RenderPass RenderPass::create_shadow_render_pass(const LogicalDevice* device, bool preserve_contents) {
         // Same as the regular depth attachment, except we want to store the results (and we don't do multisampling)
         VkAttachmentDescription depth_attachment{};
         depth_attachment.format = VK_FORMAT_D32_SFLOAT;
         depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.loadOp = preserve_contents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depth_attachment.initialLayout = preserve_contents
+            ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+            : VK_IMAGE_LAYOUT_UNDEFINED;
         depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
         VkAttachmentReference depth_attachment_reference{};
@@ -138,19 +140,28 @@ namespace inf::gfx::vk {
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.pDepthStencilAttachment = &depth_attachment_reference;
 
+        // Both frames in flight share the shadow maps, so the layout transition and the depth writes have to wait for the
+        // previous frame to stop reading them, either by copying the static shadow map or by sampling it in the color pass
         VkSubpassDependency subpass_dependency{};
         subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         subpass_dependency.dstSubpass = 0;
         subpass_dependency.srcStageMask =
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        subpass_dependency.srcAccessMask = 0;
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_TRANSFER_BIT;
+        subpass_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
         subpass_dependency.dstStageMask =
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
         subpass_dependency.dstAccessMask =
             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (preserve_contents) {
+            subpass_dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        }
         // Create render pass
         VkRenderPassCreateInfo render_pass_create_info{};
         render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -197,7 +208,8 @@ namespace inf::gfx::vk {
         const Framebuffer& framebuffer,
         const VkExtent2D& swap_chain_extent,
         const CommandBuffer& command_buffer,
-        const std::vector<VkClearValue>& clear_values) const {
+        const std::vector<VkClearValue>& clear_values,
+        VkSubpassContents contents) const {
         VkRenderPassBeginInfo render_pass_begin_info{};
         render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         render_pass_begin_info.renderPass = render_pass;
@@ -206,7 +218,7 @@ namespace inf::gfx::vk {
         render_pass_begin_info.renderArea.extent = swap_chain_extent;
         render_pass_begin_info.clearValueCount = static_cast<std::uint32_t>(clear_values.size());
         render_pass_begin_info.pClearValues = clear_values.data();
-        vkCmdBeginRenderPass(command_buffer.get_command_buffer(), &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer.get_command_buffer(), &render_pass_begin_info, contents);
     }
 
     void RenderPass::end(const CommandBuffer& command_buffer) const {
@@ -372,6 +384,50 @@ namespace inf::gfx::vk {
         return Pipeline(device, layout, pipeline);
     }
 
+    Pipeline Pipeline::create_compute_pipeline(
+        const LogicalDevice* device,
+        const DescriptorSetLayout& descriptor_set_layout,
+        const Shader& shader,
+        std::uint32_t push_constants_size) {
+        if (shader.get_type() != ShaderType::COMPUTE) {
+            throw std::runtime_error("Compute pipelines require a compute shader.");
+        }
+        VkPushConstantRange push_constant{};
+        push_constant.offset = 0;
+        push_constant.size = push_constants_size;
+        push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        // Create pipeline layout
+        VkDescriptorSetLayout descriptor_set_layout_handle = descriptor_set_layout.get_descriptor_set_layout();
+        VkPipelineLayoutCreateInfo layout_create_info{};
+        layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layout_create_info.setLayoutCount = 1;
+        layout_create_info.pSetLayouts = &descriptor_set_layout_handle;
+        layout_create_info.pushConstantRangeCount = 1;
+        layout_create_info.pPushConstantRanges = &push_constant;
+
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(device->get_device(), &layout_create_info, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan pipeline layout.");
+        }
+
+        // Create compute pipeline
+        VkComputePipelineCreateInfo pipeline_create_info{};
+        pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_create_info.stage.module = shader.get_module();
+        pipeline_create_info.stage.pName = "main";
+        pipeline_create_info.layout = layout;
+
+        VkPipeline pipeline;
+        if (vkCreateComputePipelines(device->get_device(), VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline) != VK_SUCCESS) {
+            vkDestroyPipelineLayout(device->get_device(), layout, nullptr);
+            throw std::runtime_error("Failed to create Vulkan compute pipeline.");
+        }
+        return Pipeline(device, layout, pipeline);
+    }
+
     Pipeline::Pipeline(const LogicalDevice* device, const VkPipelineLayout& layout, const VkPipeline& pipeline) :
         device(device),
         layout(layout),
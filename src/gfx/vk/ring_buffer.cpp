@@ -0,0 +1,52 @@
+#include "gfx/vk/ring_buffer.h"
+
+#include <algorithm>
+
+namespace inf::gfx::vk {
+
+    RingBuffer::RingBuffer(
+        const LogicalDevice* device,
+        const MemoryAllocator* allocator,
+        BufferType type,
+        std::uint64_t initial_capacity,
+        std::size_t num_frames) :
+        device(device), allocator(allocator), type(type), num_frames(num_frames),
+        buffer(std::make_unique<MappedBuffer>(MappedBuffer::create(device, allocator, type, initial_capacity))),
+        ring(initial_capacity, num_frames) {}
+
+    void RingBuffer::begin_frame(std::size_t frame) {
+        ring.begin_frame(frame);
+        // A retired buffer can be freed once every frame has been begun again since it was retired
+        for (auto& retired_buffer : retired_buffers) {
+            --retired_buffer.remaining_frames;
+        }
+        retired_buffers.erase(
+            std::remove_if(retired_buffers.begin(), retired_buffers.end(), [](const RetiredBuffer& retired_buffer) {
+                return retired_buffer.remaining_frames == 0;
+            }),
+            retired_buffers.end());
+    }
+
+    RingBufferAllocation RingBuffer::upload(const void* data, std::uint64_t size, std::uint64_t alignment) {
+        auto offset = ring.allocate(size, alignment);
+        if (!offset) {
+            // Double the capacity until the allocation fits on its own, the frames in flight keep using the old buffer
+            auto capacity = ring.get_statistics().capacity;
+            while (capacity < size) {
+                capacity *= 2;
+            }
+            capacity *= 2;
+            retired_buffers.emplace_back(RetiredBuffer{ std::move(buffer), num_frames });
+            buffer = std::make_unique<MappedBuffer>(MappedBuffer::create(device, allocator, type, capacity));
+            ring.reset(capacity);
+            offset = ring.allocate(size, alignment);
+        }
+        buffer->upload(data, size, offset.value());
+        return RingBufferAllocation{ buffer->get_buffer(), offset.value() };
+    }
+
+    RingStatistics RingBuffer::get_statistics() const {
+        return ring.get_statistics();
+    }
+
+}
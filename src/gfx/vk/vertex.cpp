@@ -1,14 +1,21 @@
 #include "gfx/vk/vertex.h"
 
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
 namespace inf::gfx::vk {
 
-    VertexWithMaterialName::VertexWithMaterialName(const glm::vec3& position, const glm::vec3& normal, const std::string& material_name) :
-        position(position), normal(normal), material_name(material_name) {}
+    VertexWithMaterial::VertexWithMaterial(const glm::vec3& position, const glm::vec3& normal, utils::SymbolId material) :
+        position(position), normal(normal), material(material) {}
 
-    std::vector<VertexWithMaterialName> VertexWithMaterialName::from_bytes(const std::string& bytes) {
+    std::vector<VertexWithMaterial> VertexWithMaterial::from_bytes(const std::string& bytes) {
         const char* data = bytes.data();
         const char* end_ptr = bytes.data() + bytes.size();
-        std::vector<VertexWithMaterialName> result;
+        std::vector<VertexWithMaterial> result;
         while (data < end_ptr) {
             const auto get_float = [data](std::size_t offset) {
                 return *reinterpret_cast<const float*>(data + offset * sizeof(float));
@@ -17,7 +24,7 @@ namespace inf::gfx::vk {
             result.emplace_back(
                 glm::vec3(get_float(0), get_float(1), get_float(2)),
                 glm::vec3(get_float(3), get_float(4), get_float(5)),
-                std::string(data + 6 * sizeof(float) + 1, material_name_length)
+                utils::SymbolTable::intern(std::string_view(data + 6 * sizeof(float) + 1, material_name_length))
             );
             data += 6 * sizeof(float) + 1 + material_name_length;
         }
@@ -29,7 +36,7 @@ namespace inf::gfx::vk {
         normal(normal),
         color(color) {}
 
-    Vertex::Vertex(const VertexWithMaterialName& other, const glm::vec3& color) :
+    Vertex::Vertex(const VertexWithMaterial& other, const glm::vec3& color) :
         position(other.position), normal(other.normal), color(color) {}
 
     VkVertexInputBindingDescription Vertex::get_default_binding_description() {
@@ -68,45 +75,144 @@ namespace inf::gfx::vk {
         return attribute_descriptions;
     }
 
-    std::array<VkVertexInputBindingDescription, 2> Vertex::get_instanced_binding_descriptions() {
-        std::array<VkVertexInputBindingDescription, 2> binding_descriptions;
+    std::vector<Vertex> Vertex::from_bytes(const std::string& bytes_str) {
+        static constexpr auto floats_per_vertex = 9;
+        const auto num_vertices = bytes_str.size() / sizeof(float) / floats_per_vertex;
+        const float* data = reinterpret_cast<const float*>(bytes_str.data());
+        std::vector<Vertex> result;
+        for (std::size_t i = 0; i < num_vertices; ++i) {
+            result.emplace_back(
+                glm::vec3(data[0], data[1], data[2]),
+                glm::vec3(data[3], data[4], data[5]),
+                glm::vec3(data[6], data[7], data[8])
+            );
+            data += floats_per_vertex;
+        }
+        return result;
+    }
 
-        auto& per_vertex_binding_description = binding_descriptions[0];
-        per_vertex_binding_description.binding = 0;
-        per_vertex_binding_description.stride = sizeof(Vertex);
-        per_vertex_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    BoundingBox3D Vertex::compute_bounding_box(const std::vector<Vertex>& vertices) {
+        BoundingBox3D result;
+        for (const auto& vertex : vertices) {
+            result.update(vertex.position);
+        }
+        return result;
+    }
 
-        auto& per_instance_binding_description = binding_descriptions[1];
-        per_instance_binding_description.binding = 1;
-        per_instance_binding_description.stride = sizeof(glm::vec3) + sizeof(float);
-        per_instance_binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    static_assert(sizeof(PackedVertex) == 16, "Packed vertices are expected to have no padding between their attributes.");
 
-        return binding_descriptions;
+    // Rounds a value in [-1, 1] to a 16-bit normalized integer
+    static std::int16_t to_snorm16(float value) {
+        return static_cast<std::int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
     }
 
-    std::array<VkVertexInputAttributeDescription, 5> Vertex::get_instanced_attribute_descriptions() {
-        std::array<VkVertexInputAttributeDescription, 5> attribute_descriptions;
+    static float from_snorm16(std::int16_t value) {
+        return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+    }
 
-        // Position (vec3)
+    PackedVertex::PackedVertex(const glm::vec3& position, const glm::vec3& normal) : color{ 0, 0, 0, 0 } {
+        for (int i = 0; i < 3; ++i) {
+            if (std::abs(position[i]) > POSITION_RANGE) {
+                throw std::runtime_error("Vertex position " + std::to_string(position[i]) + " is outside of the packed vertex range.");
+            }
+            this->position[i] = to_snorm16(position[i] / POSITION_RANGE);
+        }
+        this->position[3] = 0;
+
+        // Project the normal onto the octahedron, then fold the lower hemisphere over the upper one
+        const auto length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        auto octahedral = length > 0.0f ? glm::vec3(normal / length) : glm::vec3(0.0f, 0.0f, 1.0f);
+        if (octahedral.z < 0.0f) {
+            const auto x = octahedral.x;
+            octahedral.x = (1.0f - std::abs(octahedral.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            octahedral.y = (1.0f - std::abs(x)) * (octahedral.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        this->normal = { to_snorm16(octahedral.x), to_snorm16(octahedral.y) };
+    }
+
+    PackedVertex::PackedVertex(const Vertex& vertex) : PackedVertex(vertex.position, vertex.normal) {
+        for (int i = 0; i < 3; ++i) {
+            const auto encoded = std::sqrt(std::clamp(vertex.color[i], 0.0f, 1.0f));
+            color[i] = static_cast<std::uint8_t>(std::round(encoded * 255.0f));
+        }
+    }
+
+    PackedVertex::PackedVertex(const VertexWithMaterial& vertex, std::uint8_t material_slot) :
+        PackedVertex(vertex.position, vertex.normal) {
+        color[0] = material_slot;
+    }
+
+    glm::vec3 PackedVertex::get_position() const {
+        return glm::vec3(from_snorm16(position[0]), from_snorm16(position[1]), from_snorm16(position[2])) * POSITION_RANGE;
+    }
+
+    glm::vec3 PackedVertex::get_normal() const {
+        glm::vec3 result(from_snorm16(normal[0]), from_snorm16(normal[1]), 0.0f);
+        result.z = 1.0f - std::abs(result.x) - std::abs(result.y);
+        const auto fold = std::max(-result.z, 0.0f);
+        result.x += result.x >= 0.0f ? -fold : fold;
+        result.y += result.y >= 0.0f ? -fold : fold;
+        return glm::normalize(result);
+    }
+
+    glm::vec3 PackedVertex::get_color() const {
+        const auto encoded = glm::vec3(color[0], color[1], color[2]) / 255.0f;
+        return encoded * encoded;
+    }
+
+    VkVertexInputBindingDescription PackedVertex::get_default_binding_description() {
+        VkVertexInputBindingDescription binding_description{};
+        binding_description.binding = 0;
+        binding_description.stride = sizeof(PackedVertex);
+        binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return binding_description;
+    }
+
+    std::array<VkVertexInputAttributeDescription, 3> PackedVertex::get_default_attribute_descriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attribute_descriptions;
+
+        // Position (snorm16 x4, the last component is ignored by the shaders)
         auto& position_attribute = attribute_descriptions[0];
         position_attribute.binding = 0;
         position_attribute.location = 0;
-        position_attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-        position_attribute.offset = offsetof(Vertex, position);
+        position_attribute.format = VK_FORMAT_R16G16B16A16_SNORM;
+        position_attribute.offset = offsetof(PackedVertex, position);
 
-        // Normal (vec3)
+        // Octahedral normal (snorm16 x2)
         auto& normal_attribute = attribute_descriptions[1];
         normal_attribute.binding = 0;
         normal_attribute.location = 1;
-        normal_attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-        normal_attribute.offset = offsetof(Vertex, normal);
+        normal_attribute.format = VK_FORMAT_R16G16_SNORM;
+        normal_attribute.offset = offsetof(PackedVertex, normal);
 
-        // Color (vec3)
+        // Square root of the color (unorm8 x4)
         auto& color_attribute = attribute_descriptions[2];
         color_attribute.binding = 0;
         color_attribute.location = 2;
-        color_attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-        color_attribute.offset = offsetof(Vertex, color);
+        color_attribute.format = VK_FORMAT_R8G8B8A8_UNORM;
+        color_attribute.offset = offsetof(PackedVertex, color);
+
+        return attribute_descriptions;
+    }
+
+    std::array<VkVertexInputBindingDescription, 2> PackedVertex::get_instanced_binding_descriptions() {
+        std::array<VkVertexInputBindingDescription, 2> binding_descriptions;
+
+        binding_descriptions[0] = get_default_binding_description();
+
+        auto& per_instance_binding_description = binding_descriptions[1];
+        per_instance_binding_description.binding = 1;
+        per_instance_binding_description.stride = sizeof(glm::vec3) + sizeof(float);
+        per_instance_binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return binding_descriptions;
+    }
+
+    std::array<VkVertexInputAttributeDescription, 5> PackedVertex::get_instanced_attribute_descriptions() {
+        const auto default_attribute_descriptions = get_default_attribute_descriptions();
+        std::array<VkVertexInputAttributeDescription, 5> attribute_descriptions;
+        std::copy(default_attribute_descriptions.cbegin(), default_attribute_descriptions.cend(), attribute_descriptions.begin());
 
         // Instance position
         auto& instance_position = attribute_descriptions[3];
@@ -125,26 +231,34 @@ namespace inf::gfx::vk {
         return attribute_descriptions;
     }
 
-    std::vector<Vertex> Vertex::from_bytes(const std::string& bytes_str) {
-        static constexpr auto floats_per_vertex = 9;
-        const auto num_vertices = bytes_str.size() / sizeof(float) / floats_per_vertex;
-        const float* data = reinterpret_cast<const float*>(bytes_str.data());
-        std::vector<Vertex> result;
-        for (std::size_t i = 0; i < num_vertices; ++i) {
-            result.emplace_back(
-                glm::vec3(data[0], data[1], data[2]),
-                glm::vec3(data[3], data[4], data[5]),
-                glm::vec3(data[6], data[7], data[8])
-            );
-            data += floats_per_vertex;
-        }
-        return result;
+    std::array<VkVertexInputBindingDescription, 2> PackedVertex::get_building_binding_descriptions() {
+        auto binding_descriptions = get_instanced_binding_descriptions();
+        binding_descriptions[1].stride = sizeof(BuildingInstance);
+        return binding_descriptions;
     }
 
-    BoundingBox3D Vertex::compute_bounding_box(const std::vector<Vertex>& vertices) {
-        BoundingBox3D result;
+    std::array<VkVertexInputAttributeDescription, 6> PackedVertex::get_building_attribute_descriptions() {
+        const auto instanced_attribute_descriptions = get_instanced_attribute_descriptions();
+        std::array<VkVertexInputAttributeDescription, 6> attribute_descriptions;
+        std::copy(instanced_attribute_descriptions.cbegin(), instanced_attribute_descriptions.cend(), attribute_descriptions.begin());
+        attribute_descriptions[3].offset = offsetof(BuildingInstance, position);
+        attribute_descriptions[4].offset = offsetof(BuildingInstance, rotation);
+
+        // Instance palette
+        auto& instance_palette = attribute_descriptions[5];
+        instance_palette.binding = 1;
+        instance_palette.location = 5;
+        instance_palette.format = VK_FORMAT_R32_UINT;
+        instance_palette.offset = offsetof(BuildingInstance, palette);
+
+        return attribute_descriptions;
+    }
+
+    std::vector<PackedVertex> PackedVertex::pack(const std::vector<Vertex>& vertices) {
+        std::vector<PackedVertex> result;
+        result.reserve(vertices.size());
         for (const auto& vertex : vertices) {
-            result.update(vertex.position);
+            result.emplace_back(vertex);
         }
         return result;
     }
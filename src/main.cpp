@@ -13,6 +13,8 @@
 #include "wfc/ground.h"
 #include "utils/file_utils.h"
 
+#include <string>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
 
@@ -21,7 +23,7 @@ using namespace inf::gfx;
 using namespace inf::input;
 using namespace inf::utils;
 
-int main() {
+int main(int argc, char** argv) {
     try {
         Window window("Infinitown", BorderlessFullScreen{});
         Timer timer;
@@ -39,16 +41,23 @@ int main() {
 
         const auto asset_load_start_time = timer.get_time();
         wfc::BuildingPatterns::initialize("assets/buildings");
+        wfc::BuildingPatterns::upload(&renderer.get_logical_device(), &renderer.get_memory_allocator());
+        renderer.set_building_palette(wfc::BuildingPatterns::get_palette());
         wfc::GroundPatterns::initialize("assets/grounds", &renderer.get_logical_device(), &renderer.get_memory_allocator());
         VehiclePatterns::initialize("assets/vehicles");
         ParticleMeshes::initialize(&renderer.get_logical_device(), &renderer.get_memory_allocator());
         const auto asset_load_elapsed_time = timer.get_time() - asset_load_start_time;
         std::cout << "Asset loading took " << asset_load_elapsed_time << " seconds." << std::endl;
 
+        // The world seed can be passed as the first argument to reproduce a previous run
         std::random_device random_device;
-        RandomGenerator random_engine(random_device());
+        const std::uint64_t world_seed = argc > 1
+            ? std::stoull(argv[1])
+            : (static_cast<std::uint64_t>(random_device()) << 32) | random_device();
+        std::cout << "World seed: " << world_seed << std::endl;
+        RandomGenerator random_engine(world_seed);
         const auto generation_start_time = timer.get_time();
-        WorldGenerator generator(context, random_engine, renderer);
+        WorldGenerator generator(context, world_seed, random_engine, renderer);
         World world = generator.generate_initial(timer);
         const auto generation_elapsed_time = timer.get_time() - generation_start_time;
         std::cout << "World generation took " << generation_elapsed_time << " seconds." << std::endl;
@@ -66,24 +75,28 @@ int main() {
             const auto delta_time = static_cast<float>(timer.get_delta());
             context.advance_time_of_day(delta_time);
             world.update(renderer, random_engine, delta_time);
-            generator.populate_world(world);
+            generator.populate_world(world, delta_time);
             if (world.is_dirty()) {
-                world.update_caches();
+                world.update_caches(renderer);
             }
             renderer.begin_frame(
                 world.get_weather(),
                 world.get_rain_intensity(),
                 world.get_number_of_districts(),
-                world.get_number_of_buildings());
+                world.get_number_of_buildings(),
+                world.get_district_cache_statistics());
             world.render(renderer);
             renderer.end_frame();
         }
+        // The generation worker reads the static patterns, so it has to be stopped before they are destroyed
+        generator.stop();
         // Wait until the device becomes idle (flushes queues) to destroy in a well-defined state
         renderer.get_logical_device().wait_until_idle();
         renderer.destroy_imgui();
-        // Ground pattern and particle meshes are not dynamically generated, so they are statically stored.
+        // Ground pattern, building cell and particle meshes are not dynamically generated, so they are statically stored.
         // Hence, they need to be cleaned up explicitly before shutdown to avoid validation layers complaining.
         wfc::GroundPatterns::deinitialize();
+        wfc::BuildingPatterns::deinitialize();
         ParticleMeshes::deinitialize();
         glfwTerminate();
         return 0;
@@ -0,0 +1,105 @@
+#include "prefetcher.h"
+#include "gfx/frustum.h"
+#include "utils/hash_utils.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+namespace inf {
+
+    glm::vec3 DistrictGrid::get_position(const glm::ivec2& grid_position) const {
+        const auto stride = district_size + road_gap;
+        return origin + glm::vec3(grid_position.x * stride, 0.0f, -grid_position.y * stride);
+    }
+
+    BoundingBox3D DistrictGrid::get_bounding_box(const glm::ivec2& grid_position) const {
+        const auto position = get_position(grid_position);
+        return BoundingBox3D(position, position + glm::vec3(district_size, district_height, district_size));
+    }
+
+    std::vector<glm::ivec2> DistrictGrid::get_overlapping(const BoundingBox3D& bounding_box) const {
+        const auto stride = district_size + road_gap;
+        // A district covers [x, x + size] and [z, z + size] where x grows and z shrinks with the grid position
+        const auto min_x = static_cast<int>(std::ceil((bounding_box.min.x - origin.x - district_size) / stride));
+        const auto max_x = static_cast<int>(std::floor((bounding_box.max.x - origin.x) / stride));
+        const auto min_y = static_cast<int>(std::ceil((origin.z - bounding_box.max.z) / stride));
+        const auto max_y = static_cast<int>(std::floor((origin.z + district_size - bounding_box.min.z) / stride));
+        std::vector<glm::ivec2> result;
+        for (int y = min_y; y <= max_y; ++y) {
+            for (int x = min_x; x <= max_x; ++x) {
+                result.emplace_back(x, y);
+            }
+        }
+        return result;
+    }
+
+    DistrictPrefetcher::DistrictPrefetcher() : velocity(0.0f) {}
+
+    void DistrictPrefetcher::update(const Camera& camera, float delta_time) {
+        const auto& position = camera.get_position();
+        if (last_position && delta_time > 0.0f) {
+            // Exponential smoothing keeps single frame hitches from throwing the prediction off
+            const auto frame_velocity = (position - last_position.value()) / delta_time;
+            const auto alpha = 1.0f - std::exp(-delta_time / VELOCITY_SMOOTHING_SECONDS);
+            velocity = glm::mix(velocity, frame_velocity, alpha);
+        }
+        last_position = position;
+    }
+
+    const glm::vec3& DistrictPrefetcher::get_velocity() const {
+        return velocity;
+    }
+
+    std::vector<PrefetchCandidate> DistrictPrefetcher::predict(
+        const Camera& camera,
+        const glm::mat4& projection_matrix,
+        const DistrictGrid& grid,
+        float horizon_seconds,
+        float margin) const {
+        static const glm::vec3 up(0.0f, 1.0f, 0.0f);
+        const gfx::Frustum frustum(projection_matrix);
+        const auto& direction = camera.get_direction();
+        const auto enlargement = glm::vec3(margin, 0.0f, margin);
+        const auto num_samples = horizon_seconds > 0.0f ? NUM_SAMPLES : 0;
+
+        std::unordered_map<glm::ivec2, float> times_to_visible;
+        for (std::size_t sample = 0; sample <= num_samples; ++sample) {
+            const auto time = num_samples > 0 ? horizon_seconds * sample / num_samples : 0.0f;
+            const auto position = camera.get_position() + velocity * time;
+            const auto view_matrix = glm::lookAt(position, position + direction, up);
+            const auto frustum_bb = gfx::Frustum(projection_matrix * view_matrix).compute_bounding_box();
+            const auto search_bb = BoundingBox3D(frustum_bb.min - enlargement, frustum_bb.max + enlargement);
+            for (const auto& grid_position : grid.get_overlapping(search_bb)) {
+                // Samples are visited in chronological order, so the first hit is the earliest one
+                if (times_to_visible.find(grid_position) != times_to_visible.cend()) {
+                    continue;
+                }
+                const auto district_bb = grid.get_bounding_box(grid_position);
+                const auto enlarged_bb = BoundingBox3D(district_bb.min - enlargement, district_bb.max + enlargement);
+                if (frustum.is_inside(enlarged_bb.to_oriented(view_matrix))) {
+                    times_to_visible.emplace(grid_position, time);
+                }
+            }
+        }
+
+        std::vector<PrefetchCandidate> result;
+        result.reserve(times_to_visible.size());
+        for (const auto& [grid_position, time_to_visible] : times_to_visible) {
+            result.emplace_back(PrefetchCandidate{ grid_position, time_to_visible });
+        }
+        // Ties are broken by grid position to keep the order deterministic
+        std::sort(result.begin(), result.end(), [](const PrefetchCandidate& a, const PrefetchCandidate& b) {
+            if (a.time_to_visible != b.time_to_visible) {
+                return a.time_to_visible < b.time_to_visible;
+            }
+            return a.grid_position.y != b.grid_position.y
+                ? a.grid_position.y < b.grid_position.y
+                : a.grid_position.x < b.grid_position.x;
+        });
+        return result;
+    }
+
+}
@@ -1,13 +1,11 @@
 #include "road.h"
-#include "utils/hash_utils.h"
 
+#include <string>
+#include <algorithm>
 #include <stdexcept>
 
 namespace inf {
 
-    DistrictRoad::DistrictRoad(RoadDirection direction, const glm::ivec2& position, bool traversable, const gfx::Mesh* mesh) :
-        direction(direction), position(position), traversable(traversable), mesh(mesh) {}
-
     bool DistrictRoad::is_crossing() const {
         return direction == RoadDirection::CROSSING_DOWN_LEFT ||
             direction == RoadDirection::CROSSING_DOWN_RIGHT ||
@@ -15,12 +13,74 @@ namespace inf {
             direction == RoadDirection::CROSSING_UP_RIGHT;
     }
 
-    BoundingBox3D DistrictRoad::get_bounding_box(const glm::vec3& district_position) const {
-        // TODO: This function is currently unused, only needed for diagnostics/debugging
-        const auto center = glm::vec3(district_position.x + position.x + 0.5f, 0.0f, district_position.z + position.y + 0.5f);
-        const auto min = glm::vec3(center.x - 0.1f, center.y - 0.1f, center.z - 0.1f);
-        const auto max = glm::vec3(center.x + 0.1f, center.y + 0.1f, center.z + 0.1f);
-        return BoundingBox3D(min, max);
+    RoadGrid::RoadGrid(const glm::ivec2& dimensions) :
+        dimensions(dimensions),
+        cells(static_cast<std::size_t>(dimensions.x * dimensions.y), DistrictRoad{ RoadDirection::HORIZONTAL_UP, false, EMPTY }),
+        num_roads(0) {}
+
+    const glm::ivec2& RoadGrid::get_dimensions() const {
+        return dimensions;
+    }
+
+    std::size_t RoadGrid::size() const {
+        return num_roads;
+    }
+
+    const DistrictRoad* RoadGrid::find(const glm::ivec2& position) const {
+        if (!is_in_bounds(position)) {
+            return nullptr;
+        }
+        const auto& road = cells[position.y * dimensions.x + position.x];
+        return road.mesh != EMPTY ? &road : nullptr;
+    }
+
+    DistrictRoad* RoadGrid::find(const glm::ivec2& position) {
+        return const_cast<DistrictRoad*>(static_cast<const RoadGrid*>(this)->find(position));
+    }
+
+    const DistrictRoad& RoadGrid::at(const glm::ivec2& position) const {
+        const auto road = find(position);
+        if (!road) {
+            throw std::runtime_error("No road at [" + std::to_string(position.x) + ", " + std::to_string(position.y) + "].");
+        }
+        return *road;
+    }
+
+    void RoadGrid::add(const glm::ivec2& position, RoadDirection direction, bool traversable, const gfx::Mesh* mesh) {
+        if (!is_in_bounds(position)) {
+            throw std::runtime_error("Road at [" + std::to_string(position.x) + ", " + std::to_string(position.y) + "] is out of bounds.");
+        }
+        auto& road = cells[position.y * dimensions.x + position.x];
+        if (road.mesh != EMPTY) {
+            return;
+        }
+        road = DistrictRoad{ direction, traversable, get_mesh_index(mesh) };
+        ++num_roads;
+    }
+
+    const gfx::Mesh* RoadGrid::get_mesh(const DistrictRoad& road) const {
+        return meshes[road.mesh];
+    }
+
+    void RoadGrid::set_mesh(DistrictRoad& road, const gfx::Mesh* mesh) {
+        road.mesh = get_mesh_index(mesh);
+    }
+
+    bool RoadGrid::is_in_bounds(const glm::ivec2& position) const {
+        return position.x >= 0 && position.y >= 0 && position.x < dimensions.x && position.y < dimensions.y;
+    }
+
+    std::uint8_t RoadGrid::get_mesh_index(const gfx::Mesh* mesh) {
+        // There are only a handful of road meshes, so a linear search is the fastest option
+        const auto it = std::find(meshes.cbegin(), meshes.cend(), mesh);
+        if (it != meshes.cend()) {
+            return static_cast<std::uint8_t>(it - meshes.cbegin());
+        }
+        if (meshes.size() == EMPTY) {
+            throw std::runtime_error("Too many different road meshes in a single road grid.");
+        }
+        meshes.emplace_back(mesh);
+        return static_cast<std::uint8_t>(meshes.size() - 1);
     }
 
     glm::ivec2 RoadUtils::road_direction_to_grid_direction(RoadDirection direction) {
@@ -34,24 +94,22 @@ namespace inf {
     }
 
     std::vector<std::vector<glm::ivec2>> RoadUtils::get_possible_continuations(
-        const std::unordered_map<glm::ivec2, DistrictRoad>& roads,
+        const RoadGrid& roads,
         const glm::ivec2& current_position,
         RoadDirection direction) {
         // It can happen in unlucky scenarios (when a car is put at the edge of a district
         // facing outwards of the district) that the first time this function is called the
         // vehicle is already out-of-bounds, so check if the current position is valid.
         // TODO: This should not be needed anymore once dead-end elimination is implemented.
-        const auto road_it = roads.find(current_position);
-        if (road_it == roads.cend()) {
+        const auto road_ptr = roads.find(current_position);
+        if (!road_ptr) {
             return {};
         }
-        const auto& road = road_it->second;
+        const auto& road = *road_ptr;
         
         const auto get_traversable_road_at = [&roads](const glm::ivec2& position) -> const DistrictRoad* {
-            const auto it = roads.find(position);
-            return (it != roads.cend() && it->second.traversable)
-                ? &it->second
-                : nullptr;
+            const auto road = roads.find(position);
+            return (road && road->traversable) ? road : nullptr;
         };
 
         // For straight roads the choices are simpler. We can always go straight, just need
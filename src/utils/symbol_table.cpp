@@ -0,0 +1,29 @@
+#include "utils/symbol_table.h"
+
+#include <stdexcept>
+
+namespace inf::utils {
+
+    std::unordered_map<std::string, SymbolId> SymbolTable::ids;
+    std::deque<std::string> SymbolTable::names;
+
+    SymbolId SymbolTable::intern(std::string_view name) {
+        const auto [it, inserted] = ids.emplace(std::string(name), static_cast<SymbolId>(names.size()));
+        if (inserted) {
+            names.emplace_back(name);
+        }
+        return it->second;
+    }
+
+    const std::string& SymbolTable::get_name(SymbolId id) {
+        if (id >= names.size()) {
+            throw std::runtime_error("Unknown symbol identifier " + std::to_string(id) + ".");
+        }
+        return names[id];
+    }
+
+    std::size_t SymbolTable::size() {
+        return names.size();
+    }
+
+}
@@ -0,0 +1,106 @@
+#include "utils/thread_pool.h"
+
+#include <utility>
+#include <stdexcept>
+
+namespace inf::utils {
+
+    ThreadPool::ThreadPool(std::size_t num_threads) :
+        current_task(nullptr), task_count(0), next_index(0), remaining(0), generation(0), stopping(false) {
+        if (num_threads == 0) {
+            throw std::runtime_error("Thread pool needs at least one thread.");
+        }
+        // The calling thread of parallel_for() counts as one of the threads
+        for (std::size_t i = 1; i < num_threads; ++i) {
+            workers.emplace_back([this]() { run_worker(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    std::size_t ThreadPool::get_number_of_threads() const {
+        return workers.size() + 1;
+    }
+
+    void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task) {
+        if (count == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current_task = &task;
+            task_count = count;
+            next_index = 0;
+            remaining = count;
+            exception = nullptr;
+            ++generation;
+        }
+        work_available.notify_all();
+        execute_tasks();
+
+        std::exception_ptr task_exception;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_finished.wait(lock, [this]() { return remaining == 0; });
+            current_task = nullptr;
+            task_exception = std::exchange(exception, nullptr);
+        }
+        if (task_exception) {
+            std::rethrow_exception(task_exception);
+        }
+    }
+
+    void ThreadPool::run_worker() {
+        std::uint64_t last_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&]() {
+                    return stopping || (current_task && generation != last_generation);
+                });
+                if (stopping) {
+                    return;
+                }
+                last_generation = generation;
+            }
+            execute_tasks();
+        }
+    }
+
+    void ThreadPool::execute_tasks() {
+        while (true) {
+            const std::function<void(std::size_t)>* task;
+            std::size_t index;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!current_task || next_index >= task_count) {
+                    return;
+                }
+                task = current_task;
+                index = next_index++;
+            }
+            try {
+                (*task)(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) {
+                work_finished.notify_all();
+            }
+        }
+    }
+
+}
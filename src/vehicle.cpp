@@ -1,5 +1,6 @@
 #include "vehicle.h"
 #include "gfx/vk/buffer.h"
+#include "gfx/mesh_optimizer.h"
 #include "utils/hash_utils.h"
 #include "utils/random_utils.h"
 
@@ -11,6 +12,7 @@
 #include <string>
 #include <random>
 #include <fstream>
+#include <iostream>
 #include <stdexcept>
 
 namespace inf {
@@ -21,9 +23,31 @@ namespace inf {
         gfx::Mesh&& mesh) :
         position(position), targets(targets), mesh(std::move(mesh)), offset(0.0f), stuck(false) {}
 
+    Vehicle Vehicle::upload(
+        const gfx::vk::LogicalDevice* device,
+        const gfx::vk::MemoryAllocator* allocator,
+        const VehicleGeometry& geometry) {
+        const auto num_vertex_bytes = geometry.vertices.size() * sizeof(gfx::vk::PackedVertex);
+        auto buffer = gfx::vk::MappedBuffer::create(device, allocator, gfx::vk::BufferType::VERTEX_BUFFER, num_vertex_bytes);
+        buffer.upload(geometry.vertices.data(), num_vertex_bytes);
+        const auto num_index_bytes = geometry.indices.size() * sizeof(std::uint32_t);
+        auto index_buffer = gfx::vk::MappedBuffer::create(device, allocator, gfx::vk::BufferType::INDEX_BUFFER, num_index_bytes);
+        index_buffer.upload(geometry.indices.data(), num_index_bytes);
+        return Vehicle(
+            geometry.position,
+            geometry.targets,
+            gfx::Mesh(
+                std::move(buffer),
+                std::move(index_buffer),
+                geometry.vertices.size(),
+                geometry.indices.size(),
+                glm::mat4(1.0f),
+                geometry.bounding_box));
+    }
+
     void Vehicle::update(
         RandomGenerator& rng,
-        const std::unordered_map<glm::ivec2, DistrictRoad>& roads,
+        const RoadGrid& roads,
         float delta_time) {
         static constexpr float vehicle_speed = 1.0f;
         if (targets.empty()) {
@@ -107,34 +131,42 @@ namespace inf {
     std::unordered_map<std::string, VehiclePattern> VehiclePatterns::patterns;
 
     VehiclePattern::VehiclePattern(
-        std::vector<gfx::vk::VertexWithMaterialName>&& vertices,
+        std::vector<gfx::vk::VertexWithMaterial>&& vertices,
+        std::vector<std::uint32_t>&& indices,
         VehicleMaterials&& materials) :
         vertices(std::move(vertices)),
-        materials(std::move(materials)) {}
+        indices(std::move(indices)) {
+        std::unordered_map<utils::SymbolId, std::uint32_t> material_indices;
+        for (auto& [name, candidates] : materials) {
+            material_indices.emplace(name, static_cast<std::uint32_t>(material_candidates.size()));
+            material_candidates.emplace_back(std::move(candidates));
+        }
+        vertex_materials.reserve(this->vertices.size());
+        for (const auto& vertex : this->vertices) {
+            vertex_materials.emplace_back(material_indices.at(vertex.material));
+        }
+    }
 
-    Vehicle VehiclePattern::instantiate(
+    VehicleGeometry VehiclePattern::generate(
         RandomGenerator& rng,
-        const gfx::vk::LogicalDevice* device,
-        const gfx::vk::MemoryAllocator* allocator,
         const glm::ivec2& position,
         const std::deque<glm::ivec2>& targets) const {
-        // Choose a color for each material
-        std::unordered_map<std::string, glm::vec3> chosen_materials;
-        for (const auto& [name, candidates] : materials) {
+        // Choose a color for each material of the pattern
+        std::vector<glm::vec3> chosen_materials;
+        chosen_materials.reserve(material_candidates.size());
+        for (const auto& candidates : material_candidates) {
             std::uniform_int_distribution<std::size_t> candidate_distribution(0, candidates.size() - 1);
-            chosen_materials.emplace(name, candidates[candidate_distribution(rng)]);
+            chosen_materials.emplace_back(candidates[candidate_distribution(rng)]);
         }
 
         std::vector<gfx::vk::Vertex> vertices;
-        for (const auto& vertex : this->vertices) {
-            vertices.emplace_back(vertex, chosen_materials.at(vertex.material_name));
+        vertices.reserve(this->vertices.size());
+        for (std::size_t i = 0; i < this->vertices.size(); ++i) {
+            vertices.emplace_back(this->vertices[i], chosen_materials[vertex_materials[i]]);
         }
 
-        const auto num_bytes = vertices.size() * sizeof(gfx::vk::Vertex);
-        auto buffer = gfx::vk::MappedBuffer::create(device, allocator, gfx::vk::BufferType::VERTEX_BUFFER, num_bytes);
-        buffer.upload(vertices.data(), num_bytes);
         const auto bb = gfx::vk::Vertex::compute_bounding_box(vertices);
-        return Vehicle(position, targets, gfx::Mesh(std::move(buffer), vertices.size(), glm::mat4(1.0f), bb));
+        return VehicleGeometry{ position, targets, gfx::vk::PackedVertex::pack(vertices), indices, bb };
     }
 
     void VehiclePatterns::initialize(const std::filesystem::path& vehicles_path) {
@@ -160,14 +192,25 @@ namespace inf {
             const auto data = json_contents["data"].get<std::string>();
             const auto& materials_obj = json_contents["materials"];
             for (const auto& entry : materials_obj.items()) {
-                auto& material = materials.emplace(entry.key(), std::vector<glm::vec3>{}).first->second;
+                auto& material = materials.emplace(utils::SymbolTable::intern(entry.key()), std::vector<glm::vec3>{}).first->second;
                 for (const auto& candidate : entry.value()) {
                     material.emplace_back(candidate[0].get<float>(), candidate[1].get<float>(), candidate[2].get<float>());
                 }
             }
 
-            auto vertices = gfx::vk::VertexWithMaterialName::from_bytes(base64_decode(data));
-            patterns.emplace(name, VehiclePattern(std::move(vertices), std::move(materials)));
+            const auto vertices = gfx::vk::VertexWithMaterial::from_bytes(base64_decode(data));
+            for (const auto& vertex : vertices) {
+                if (materials.find(vertex.material) == materials.cend()) {
+                    throw std::runtime_error("Vehicle '" + name + "' uses undefined material '" +
+                        utils::SymbolTable::get_name(vertex.material) + "'.");
+                }
+            }
+            auto geometry = gfx::MeshOptimizer::optimize(vertices);
+            std::cout << "Vehicle '" << name << "': " << vertices.size() << " -> " << geometry.vertices.size() << " vertices, " <<
+                vertices.size() * sizeof(gfx::vk::Vertex) << " -> " <<
+                geometry.vertices.size() * sizeof(gfx::vk::PackedVertex) + geometry.indices.size() * sizeof(std::uint32_t) <<
+                " bytes" << std::endl;
+            patterns.emplace(name, VehiclePattern(std::move(geometry.vertices), std::move(geometry.indices), std::move(materials)));
         }
     }
 
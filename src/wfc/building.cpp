@@ -1,6 +1,7 @@
 #include "wfc/building.h"
 #include "wfc/rule.h"
 #include "gfx/vk/vertex.h"
+#include "gfx/mesh_optimizer.h"
 #include "utils/string_utils.h"
 
 #include <nlohmann/json.hpp>
@@ -10,23 +11,83 @@
 
 #include <array>
 #include <fstream>
+#include <iostream>
+#include <algorithm>
 #include <stdexcept>
 
 namespace inf::wfc {
 
     std::unordered_map<std::string, BuildingPattern> BuildingPatterns::patterns;
+    std::vector<glm::vec4> BuildingPatterns::palette;
+    std::mutex BuildingPattern::static_masks_mutex;
 
     BuildingContext::BuildingContext(int width, int height, int depth) :
-        width(width), height(height), depth(depth) {}
-
-    bool BuildingContext::cell_contains(const glm::ivec3& position, std::string_view name) const {
-        for (const auto& cell : cells) {
-            if (cell.position == position) {
-                const auto result = cell.mesh && cell.mesh->name == name;
-                return result;
+        width(width), height(height), depth(depth), static_masks(nullptr) {
+        // Initialize cell values (position, edge, is_corner, etc. needed for filters)
+        cells.reserve(width * height * depth);
+        for (int x = 0; x < width; ++x) {
+            for (int y = 0; y < height; ++y) {
+                for (int z = 0; z < depth; ++z) {
+                    BuildingCell cell{};
+                    cell.position = glm::ivec3(x, y, z);
+                    cell.is_corner =
+                        (x == 0 || x == width - 1) &&
+                        (z == 0 || z == depth - 1);
+                    cell.is_edge = !cell.is_corner &&
+                        (x == 0 || x == width - 1 ||
+                        z == 0 || z == depth - 1);
+                    // Apply corner rotations
+                    if (cell.is_corner) {
+                        if (x == width - 1 && z == 0) {
+                            cell.rotate_y = glm::radians(90.0f);
+                        }
+                        else if (x == width - 1 && z == depth - 1) {
+                            cell.rotate_y = glm::radians(180.0f);
+                        }
+                        else if (x == 0 && z == depth - 1) {
+                            cell.rotate_y = glm::radians(270.0f);
+                        }
+                    }
+                    // Apply edge rotations
+                    else if (cell.is_edge) {
+                        if (x == width - 1) {
+                            cell.rotate_y = glm::radians(90.0f);
+                        }
+                        else if (z == depth - 1) {
+                            cell.rotate_y = glm::radians(180.0f);
+                        }
+                        else if (x == 0) {
+                            cell.rotate_y = glm::radians(270.0f);
+                        }
+                    }
+                    cell.mesh = nullptr;
+                    cell.neighbors = {
+                        index_of(cell.position + glm::ivec3(-1, 0, 0)), // Left
+                        index_of(cell.position + glm::ivec3(1, 0, 0)),  // Right
+                        index_of(cell.position + glm::ivec3(0, 0, -1)), // Top
+                        index_of(cell.position + glm::ivec3(0, 0, 1))   // Bottom
+                    };
+                    cells.push_back(cell);
+                }
             }
         }
-        return false;
+    }
+
+    std::size_t BuildingContext::index_of(const glm::ivec3& position) const {
+        if (position.x < 0 || position.x >= width ||
+            position.y < 0 || position.y >= height ||
+            position.z < 0 || position.z >= depth) {
+            return NO_CELL;
+        }
+        return static_cast<std::size_t>((position.x * height + position.y) * depth + position.z);
+    }
+
+    bool BuildingContext::cell_contains(std::size_t index, utils::SymbolId name) const {
+        if (index == NO_CELL) {
+            return false;
+        }
+        const auto mesh = cells[index].mesh;
+        return mesh && mesh->name == name;
     }
 
     bool EdgeBuildingPatternFilter::operator()(const BuildingContext&, const BuildingCell& cell) const {
@@ -37,17 +98,11 @@ namespace inf::wfc {
         return cell.is_corner;
     }
 
-    NextToBuildingPatternFilter::NextToBuildingPatternFilter(const std::string& mesh_name) : mesh_name(mesh_name) {}
+    NextToBuildingPatternFilter::NextToBuildingPatternFilter(utils::SymbolId mesh_name) : mesh_name(mesh_name) {}
 
     bool NextToBuildingPatternFilter::operator()(const BuildingContext& context, const BuildingCell& cell) const {
-        std::array<glm::ivec3, 4> positions = {
-            cell.position + glm::ivec3(-1, 0, 0), // Left
-            cell.position + glm::ivec3(1, 0, 0),  // Right
-            cell.position + glm::ivec3(0, 0, -1), // Top
-            cell.position + glm::ivec3(0, 0, 1)   // Bottom
-        };
-        for (const auto& position : positions) {
-            if (context.cell_contains(position, mesh_name)) {
+        for (const auto neighbor : cell.neighbors) {
+            if (context.cell_contains(neighbor, mesh_name)) {
                 return true;
             }
         }
@@ -61,17 +116,95 @@ namespace inf::wfc {
         return std::visit([&](auto&& callable) { return !callable(context, cell); }, *filter);
     }
 
+    bool is_static_filter(const BuildingPatternFilter& filter) {
+        return std::visit([](auto&& value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, NextToBuildingPatternFilter>) {
+                return false;
+            }
+            else if constexpr (std::is_same_v<T, NegationBuildingPatternFilter>) {
+                return is_static_filter(*value.filter);
+            }
+            else {
+                return true;
+            }
+        }, filter);
+    }
+
+    Building::Building(BuildingGeometry&& geometry) :
+        Building(std::move(geometry), glm::vec3()) {}
+
+    Building::Building(BuildingGeometry&& geometry, const glm::vec3& position) :
+        geometry(std::move(geometry)), position(position) {}
+
+    const std::vector<BuildingCellInstance>& Building::get_cells() const {
+        return geometry.cells;
+    }
+
+    std::uint32_t Building::get_palette() const {
+        return geometry.palette;
+    }
+
+    const BoundingBox3D& Building::get_bounding_box_in_model_space() const {
+        return geometry.bounding_box;
+    }
+
+    BoundingBox3D Building::get_bounding_box_in_world_space() const {
+        return geometry.bounding_box.apply(glm::translate(glm::mat4(1.0f), position));
+    }
+
+    const glm::ivec3& Building::get_dimensions() const {
+        return geometry.dimensions;
+    }
+
+    const glm::vec3& Building::get_position() const {
+        return position;
+    }
+
+    void Building::set_position(const glm::vec3& position) {
+        this->position = position;
+    }
+
     BuildingMesh::BuildingMesh(
-        const std::string& name,
-        std::vector<gfx::vk::VertexWithMaterialName>&& vertices,
+        std::size_t index,
+        utils::SymbolId name,
+        std::vector<gfx::vk::VertexWithMaterial>&& vertices,
+        std::vector<std::uint32_t>&& indices,
         std::vector<BuildingPatternFilter>&& filters,
         std::vector<BuildingMeshHeightRestriction>&& height_restrictions) :
+        index(index),
         name(name),
         vertices(std::move(vertices)),
+        indices(std::move(indices)),
         filters(std::move(filters)),
-        height_restrictions(std::move(height_restrictions)) {}
+        height_restrictions(std::move(height_restrictions)) {
+        for (const auto& vertex : this->vertices) {
+            bounding_box.update(vertex.position);
+        }
+        for (std::size_t i = 0; i < this->filters.size(); ++i) {
+            if (!is_static_filter(this->filters[i])) {
+                dynamic_filter_indices.emplace_back(i);
+            }
+        }
+    }
 
     bool BuildingMesh::matches(const BuildingContext& context, const BuildingCell& cell) const {
+        // Static filters are looked up from the precompiled masks if available, so only dynamic filters are evaluated here
+        const auto static_match = context.static_masks
+            ? context.static_masks->test(context.index_of(cell.position), index)
+            : matches_static(context, cell);
+        if (!static_match) {
+            return false;
+        }
+        for (const auto filter_index : dynamic_filter_indices) {
+            if (!std::visit([&](auto&& callable) { return callable(context, cell); }, filters[filter_index])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool BuildingMesh::matches_static(const BuildingContext& context, const BuildingCell& cell) const {
         // Apply height restriction if present first, because it is a cheap first filter
         for (const auto& restriction : height_restrictions) {
             if (!std::visit([&](auto&& value) {
@@ -95,9 +228,9 @@ namespace inf::wfc {
                 return false;
             }
         }
-        // Apply all other filter types next
+        // Apply all other static filter types next
         for (const auto& filter : filters) {
-            if (!std::visit([&](auto&& callable) { return callable(context, cell); }, filter)) {
+            if (is_static_filter(filter) && !std::visit([&](auto&& callable) { return callable(context, cell); }, filter)) {
                 return false;
             }
         }
@@ -113,14 +246,17 @@ namespace inf::wfc {
         const BuildingDimensions& dimensions,
         BuildingMaterials&& materials,
         int weight) :
-        name(name), dimensions(dimensions), materials(std::move(materials)), weight(weight) {}
+        name(name), dimensions(dimensions), materials(std::move(materials)), weight(weight), palette_offset(0) {
+        for (const auto& material : this->materials) {
+            material_slots.emplace_back(material.first);
+        }
+    }
 
-    Building BuildingPattern::instantiate(
+    BuildingGeometry BuildingPattern::generate(
         RandomGenerator& rng,
-        const gfx::vk::LogicalDevice* logical_device,
-        const gfx::vk::MemoryAllocator* allocator,
         int max_width,
-        int max_depth) const {
+        int max_depth,
+        WfcSolver solver) const {
         int width = max_width;
         int height = 1;
         int depth = max_depth;
@@ -136,90 +272,98 @@ namespace inf::wfc {
 
         // Create the context
         BuildingContext context(width, height, depth);
-        // Initialize cell values (position, edge, is_corner, etc. needed for filters)
-        context.cells.reserve(width * height * depth);
-        for (int x = 0; x < width; ++x) {
-            for (int y = 0; y < height; ++y) {
-                for (int z = 0; z < depth; ++z) {
-                    BuildingCell cell{};
-                    cell.position = glm::ivec3(x, y, z);
-                    cell.is_corner =
-                        (x == 0 || x == width - 1) &&
-                        (z == 0 || z == depth - 1);
-                    cell.is_edge = !cell.is_corner &&
-                        (x == 0 || x == width - 1 ||
-                        z == 0 || z == depth - 1);
-                    // Apply corner rotations
-                    if (cell.is_corner) {
-                        if (x == width - 1 && z == 0) {
-                            cell.rotate_y = glm::radians(90.0f);
-                        }
-                        else if (x == width - 1 && z == depth - 1) {
-                            cell.rotate_y = glm::radians(180.0f);
-                        }
-                        else if (x == 0 && z == depth - 1) {
-                            cell.rotate_y = glm::radians(270.0f);
-                        }
-                    }
-                    // Apply edge rotations
-                    else if (cell.is_edge) {
-                        if (x == width - 1) {
-                            cell.rotate_y = glm::radians(90.0f);
-                        }
-                        else if (z == depth - 1) {
-                            cell.rotate_y = glm::radians(180.0f);
-                        }
-                        else if (x == 0) {
-                            cell.rotate_y = glm::radians(270.0f);
-                        }
-                    }
-                    cell.mesh = nullptr;
-                    context.cells.push_back(cell);
-                }
-            }
-        }
+        context.static_masks = &get_static_masks(width, height, depth);
         // Collapse cells
-        wfc_collapse(rng, context, meshes);
-
-        // Generate a mesh from the resulting cells
-        std::vector<gfx::vk::Vertex> vertices;
-        static constexpr auto float_max = std::numeric_limits<float>::max();
-        static constexpr auto float_min = std::numeric_limits<float>::lowest();
+        wfc_collapse(rng, context, meshes, solver);
 
-        // Choose a material for each material from the candidates
-        std::unordered_map<std::string, glm::vec3> chosen_materials;
-        for (const auto& material : materials) {
-            const auto& name = material.first;
-            const auto& candidates = material.second;
+        // Choose a candidate for each material, the choices form a mixed radix number which is the index of the palette
+        std::uint32_t palette = 0;
+        std::uint32_t radix = 1;
+        for (const auto material : material_slots) {
+            const auto& candidates = materials.at(material);
             std::uniform_int_distribution<std::size_t> candidate_distribution(0, candidates.size() - 1);
-            chosen_materials[name] = candidates[candidate_distribution(rng)];
+            palette += static_cast<std::uint32_t>(candidate_distribution(rng)) * radix;
+            radix *= static_cast<std::uint32_t>(candidates.size());
         }
 
+        // Generate the cell instances from the resulting cells
+        static constexpr auto float_max = std::numeric_limits<float>::max();
+        static constexpr auto float_min = std::numeric_limits<float>::lowest();
         BoundingBox3D bounding_box(
             glm::vec3(float_max, float_max, float_max),
             glm::vec3(float_min, float_min, float_min));
+        std::vector<BuildingCellInstance> cells;
         for (const auto& cell : context.cells) {
             if (!cell.mesh) {
                 continue;
             }
-            glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), cell.rotate_y, glm::vec3(0.0f, 1.0f, 0.0f));
             // TODO: That +0.5f to the Y coordinate should be part of the models instead
-            glm::mat4 transformation = glm::translate(glm::mat4(1.0f), glm::vec3(cell.position.x, cell.position.y + 0.5f, -cell.position.z)) * rotation_matrix;
-            for (auto vertex : cell.mesh->vertices) {
-                vertex.position = glm::vec3(transformation * glm::vec4(vertex.position, 1.0f));
-                vertex.normal = glm::vec3(rotation_matrix * glm::vec4(vertex.normal, 1.0f));
-                vertices.emplace_back(vertex, chosen_materials.at(vertex.material_name));
-                bounding_box.update(vertex.position);
+            const glm::vec3 position(cell.position.x, cell.position.y + 0.5f, -cell.position.z);
+            const glm::mat4 transformation = glm::rotate(
+                glm::translate(glm::mat4(1.0f), position),
+                cell.rotate_y,
+                glm::vec3(0.0f, 1.0f, 0.0f));
+            // The instanced shaders rotate in the opposite direction of glm::rotate()
+            cells.emplace_back(BuildingCellInstance{ cell.mesh, position, -cell.rotate_y });
+            bounding_box.update(cell.mesh->bounding_box.apply(transformation));
+        }
+
+        return BuildingGeometry{
+            std::move(cells),
+            palette_offset + palette * static_cast<std::uint32_t>(material_slots.size()),
+            bounding_box,
+            glm::ivec3(width, height, depth)
+        };
+    }
+
+    std::uint32_t BuildingPattern::get_material_slot(utils::SymbolId material) const {
+        const auto it = std::find(material_slots.cbegin(), material_slots.cend(), material);
+        if (it == material_slots.cend()) {
+            throw std::runtime_error("Pattern '" + name + "' uses undefined material '" + utils::SymbolTable::get_name(material) + "'.");
+        }
+        return static_cast<std::uint32_t>(it - material_slots.cbegin());
+    }
+
+    std::uint32_t BuildingPattern::get_number_of_palettes() const {
+        std::uint32_t result = 1;
+        for (const auto& material : materials) {
+            result *= static_cast<std::uint32_t>(material.second.size());
+        }
+        return result;
+    }
+
+    void BuildingPattern::append_palettes(std::vector<glm::vec4>& palette) const {
+        // Palettes are enumerated in the same mixed radix order as the choices are encoded by generate()
+        const auto num_palettes = get_number_of_palettes();
+        for (std::uint32_t index = 0; index < num_palettes; ++index) {
+            auto remainder = index;
+            for (const auto material : material_slots) {
+                const auto& candidates = materials.at(material);
+                const auto num_candidates = static_cast<std::uint32_t>(candidates.size());
+                palette.emplace_back(candidates[remainder % num_candidates], 1.0f);
+                remainder /= num_candidates;
             }
         }
+    }
 
-        auto vertex_buffer = gfx::vk::MappedBuffer::create(
-            logical_device,
-            allocator,
-            gfx::vk::BufferType::VERTEX_BUFFER,
-            sizeof(gfx::vk::Vertex) * vertices.size());
-        vertex_buffer.upload(vertices.data(), vertices.size() * sizeof(gfx::vk::Vertex));
-        return Building(gfx::Mesh(std::move(vertex_buffer), vertices.size(), glm::mat4(1.0f), bounding_box), glm::ivec3(width, height, depth));
+    const CandidateSets& BuildingPattern::get_static_masks(int width, int height, int depth) const {
+        const glm::ivec3 dimensions(width, height, depth);
+        // References to the masks stay valid after the lock is released, because map nodes are never moved or erased
+        std::lock_guard<std::mutex> lock(static_masks_mutex);
+        auto it = static_masks.find(dimensions);
+        if (it != static_masks.cend()) {
+            return it->second;
+        }
+        const BuildingContext context(width, height, depth);
+        CandidateSets masks(context.cells.size(), meshes.size());
+        for (std::size_t cell = 0; cell < context.cells.size(); ++cell) {
+            for (const auto& mesh : meshes) {
+                if (mesh.matches_static(context, context.cells[cell])) {
+                    masks.set(cell, mesh.index);
+                }
+            }
+        }
+        return static_masks.emplace(dimensions, std::move(masks)).first->second;
     }
 
     AbsoluteBuildingDimensions::AbsoluteBuildingDimensions(
@@ -261,7 +405,7 @@ namespace inf::wfc {
             // Parse materials
             BuildingMaterials materials;
             for (const auto& material_entry : json_contents["materials"].items()) {
-                auto& material_candidates = materials.emplace(material_entry.key(), std::vector<glm::vec3>{}).first->second;
+                auto& material_candidates = materials.emplace(utils::SymbolTable::intern(material_entry.key()), std::vector<glm::vec3>{}).first->second;
                 for (const auto& candidate : material_entry.value()) {
                     material_candidates.emplace_back(candidate[0].get<float>(), candidate[1].get<float>(), candidate[2].get<float>());
                 }
@@ -272,14 +416,25 @@ namespace inf::wfc {
 
             auto& pattern = patterns.emplace(pattern_name, BuildingPattern(
                 pattern_name, dimensions, std::move(materials), weight)).first->second;
+            std::size_t num_input_vertices = 0;
+            std::size_t num_vertices = 0;
             for (const auto& mesh_obj : json_contents["meshes"]) {
-                const auto mesh_name = mesh_obj["name"].get<std::string>();
+                const auto mesh_name = utils::SymbolTable::intern(mesh_obj["name"].get<std::string>());
 
                 // Parse mesh data
                 const auto data = mesh_obj["data"].get<std::string>();
 
                 // Data is base64 encoded, we need to decode it first then parse vertices from it
-                auto vertices = gfx::vk::VertexWithMaterialName::from_bytes(base64_decode(data));
+                const auto vertices = gfx::vk::VertexWithMaterial::from_bytes(base64_decode(data));
+                for (const auto& vertex : vertices) {
+                    if (pattern.materials.find(vertex.material) == pattern.materials.cend()) {
+                        throw std::runtime_error("Pattern '" + pattern_name + "' uses undefined material '" +
+                            utils::SymbolTable::get_name(vertex.material) + "'.");
+                    }
+                }
+                auto geometry = gfx::MeshOptimizer::optimize(vertices);
+                num_input_vertices += vertices.size();
+                num_vertices += geometry.vertices.size();
 
                 // Parse mesh filters
                 std::vector<BuildingPatternFilter> filters;
@@ -323,7 +478,7 @@ namespace inf::wfc {
                             if (filter_params.empty()) {
                                 throw std::runtime_error("Filter type 'next_to' used without parameters.");
                             }
-                            filter = NextToBuildingPatternFilter(filter_params[0]);
+                            filter = NextToBuildingPatternFilter(utils::SymbolTable::intern(filter_params[0]));
                             break;
                         default: throw std::runtime_error("Unhandled filter type for '" + filter_str + "'.");
                     }
@@ -373,8 +528,23 @@ namespace inf::wfc {
                 }
 
                 // Store the building mesh
-                pattern.meshes.emplace_back(mesh_name, std::move(vertices), std::move(filters), std::move(height_restrictions));
+                pattern.meshes.emplace_back(
+                    pattern.meshes.size(),
+                    mesh_name,
+                    std::move(geometry.vertices),
+                    std::move(geometry.indices),
+                    std::move(filters),
+                    std::move(height_restrictions));
             }
+            std::cout << "Building pattern '" << pattern_name << "': " << num_input_vertices << " -> " <<
+                num_vertices << " vertices" << std::endl;
+        }
+
+        // Every material combination of every pattern gets its own palette, so buildings only need to store its index
+        palette.clear();
+        for (auto& [_, pattern] : patterns) {
+            pattern.palette_offset = static_cast<std::uint32_t>(palette.size());
+            pattern.append_palettes(palette);
         }
     }
 
@@ -401,35 +571,8 @@ namespace inf::wfc {
         return &it->second;
     }
 
-    Building::Building(gfx::Mesh&& mesh, const glm::ivec3& dimensions) :
-        Building(std::move(mesh), dimensions, glm::vec3()) {}
-
-    Building::Building(gfx::Mesh&& mesh, const glm::ivec3& dimensions, const glm::vec3& position) :
-        mesh(std::move(mesh)), dimensions(dimensions), position(position) {}
-
-    const gfx::Mesh& Building::get_mesh() const {
-        return mesh;
-    }
-
-    const BoundingBox3D& Building::get_bounding_box_in_model_space() const {
-        return mesh.get_bounding_box_in_model_space();
-    }
-
-    BoundingBox3D Building::get_bounding_box_in_world_space() const {
-        return get_bounding_box_in_model_space().apply(mesh.get_model_matrix());
-    }
-
-    const glm::ivec3& Building::get_dimensions() const {
-        return dimensions;
-    }
-
-    const glm::vec3& Building::get_position() const {
-        return position;
-    }
-
-    void Building::set_position(const glm::vec3& position) {
-        this->position = position;
-        mesh.set_model_matrix(glm::translate(glm::mat4(1.0f), position));
+    const std::vector<glm::vec4>& BuildingPatterns::get_palette() {
+        return palette;
     }
 
 }
\ No newline at end of file
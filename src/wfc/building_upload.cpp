@@ -0,0 +1,92 @@
+#include "wfc/building.h"
+#include "gfx/vk/buffer.h"
+
+#include <limits>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+namespace inf::wfc {
+
+    std::unordered_map<const BuildingMesh*, gfx::Mesh> BuildingPatterns::meshes;
+
+    void BuildingPatterns::upload(
+        const gfx::vk::LogicalDevice* logical_device,
+        const gfx::vk::MemoryAllocator* allocator) {
+        // Every cell mesh is a range of a single vertex and index buffer, so buildings can be drawn without rebinding buffers
+        struct MeshRange {
+            const BuildingMesh* mesh;
+            std::uint32_t first_vertex;
+            std::uint32_t first_index;
+        };
+        std::vector<gfx::vk::PackedVertex> vertices;
+        std::vector<std::uint32_t> indices;
+        std::vector<MeshRange> ranges;
+        for (const auto& [_, pattern] : patterns) {
+            for (const auto& mesh : pattern.meshes) {
+                // The color of the vertices is looked up from the palette of the instance by the material slot
+                ranges.emplace_back(MeshRange{
+                    &mesh,
+                    static_cast<std::uint32_t>(vertices.size()),
+                    static_cast<std::uint32_t>(indices.size()) });
+                for (const auto& vertex : mesh.vertices) {
+                    const auto slot = pattern.get_material_slot(vertex.material);
+                    if (slot > std::numeric_limits<std::uint8_t>::max()) {
+                        throw std::runtime_error("Pattern '" + pattern.name + "' has more materials than packed vertices can address.");
+                    }
+                    vertices.emplace_back(vertex, static_cast<std::uint8_t>(slot));
+                }
+                // Indices stay relative to the first vertex of the mesh, which is passed as the vertex offset of the draws
+                indices.insert(indices.end(), mesh.indices.cbegin(), mesh.indices.cend());
+            }
+        }
+        if (vertices.empty()) {
+            return;
+        }
+        const auto num_vertex_bytes = sizeof(gfx::vk::PackedVertex) * vertices.size();
+        const auto vertex_buffer = std::make_shared<gfx::vk::MappedBuffer>(gfx::vk::MappedBuffer::create(
+            logical_device,
+            allocator,
+            gfx::vk::BufferType::VERTEX_BUFFER,
+            num_vertex_bytes));
+        vertex_buffer->upload(vertices.data(), num_vertex_bytes);
+        const auto num_index_bytes = sizeof(std::uint32_t) * indices.size();
+        const auto index_buffer = std::make_shared<gfx::vk::MappedBuffer>(gfx::vk::MappedBuffer::create(
+            logical_device,
+            allocator,
+            gfx::vk::BufferType::INDEX_BUFFER,
+            num_index_bytes));
+        index_buffer->upload(indices.data(), num_index_bytes);
+        std::cout << "Building cells: " << vertices.size() * sizeof(gfx::vk::Vertex) << " -> " << num_vertex_bytes <<
+            " bytes of vertex data, " << sizeof(gfx::vk::Vertex) << " -> " << sizeof(gfx::vk::PackedVertex) <<
+            " bytes fetched per vertex" << std::endl;
+        for (const auto& range : ranges) {
+            meshes.emplace(
+                range.mesh,
+                gfx::Mesh(
+                    vertex_buffer,
+                    range.first_vertex,
+                    range.mesh->vertices.size(),
+                    index_buffer,
+                    range.first_index,
+                    range.mesh->indices.size(),
+                    glm::mat4(1.0f),
+                    range.mesh->bounding_box));
+        }
+    }
+
+    void BuildingPatterns::deinitialize() {
+        meshes.clear();
+    }
+
+    const gfx::Mesh* BuildingPatterns::get_mesh(const BuildingMesh* mesh) {
+        const auto it = meshes.find(mesh);
+        if (it == meshes.cend()) {
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+}
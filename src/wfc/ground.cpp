@@ -1,9 +1,11 @@
 #include "wfc/ground.h"
+#include "gfx/mesh_optimizer.h"
 
 #include <nlohmann/json.hpp>
 #include <cpp-base64/base64.h>
 
 #include <fstream>
+#include <iostream>
 #include <stdexcept>
 
 namespace inf::wfc {
@@ -41,11 +43,27 @@ namespace inf::wfc {
             const auto parse_pattern = [&](const auto& json_obj) {
                 const auto pattern_name = json_obj["name"].template get<std::string>();
                 const auto data = json_obj["data"].template get<std::string>();
-                auto vertices = gfx::vk::Vertex::from_bytes(base64_decode(data));
+                const auto vertices = gfx::vk::Vertex::from_bytes(base64_decode(data));
+                const auto geometry = gfx::MeshOptimizer::optimize(vertices);
+                const auto packed_vertices = gfx::vk::PackedVertex::pack(geometry.vertices);
+                const auto num_vertex_bytes = packed_vertices.size() * sizeof(gfx::vk::PackedVertex);
+                const auto num_index_bytes = geometry.indices.size() * sizeof(std::uint32_t);
+                std::cout << "Ground pattern '" << pattern_name << "': " << vertices.size() << " -> " <<
+                    geometry.vertices.size() << " vertices, " << vertices.size() * sizeof(gfx::vk::Vertex) << " -> " <<
+                    num_vertex_bytes + num_index_bytes << " bytes" << std::endl;
                 auto vertex_buffer = gfx::vk::MappedBuffer::create(
-                    logical_device, allocator, gfx::vk::BufferType::VERTEX_BUFFER, vertices.size() * sizeof(gfx::vk::Vertex));
-                vertex_buffer.upload(vertices.data(), vertices.size() * sizeof(gfx::vk::Vertex));
-                auto mesh = gfx::Mesh(std::move(vertex_buffer), vertices.size(), glm::mat4(1.0f), gfx::vk::Vertex::compute_bounding_box(vertices));
+                    logical_device, allocator, gfx::vk::BufferType::VERTEX_BUFFER, num_vertex_bytes);
+                vertex_buffer.upload(packed_vertices.data(), num_vertex_bytes);
+                auto index_buffer = gfx::vk::MappedBuffer::create(
+                    logical_device, allocator, gfx::vk::BufferType::INDEX_BUFFER, num_index_bytes);
+                index_buffer.upload(geometry.indices.data(), num_index_bytes);
+                auto mesh = gfx::Mesh(
+                    std::move(vertex_buffer),
+                    std::move(index_buffer),
+                    geometry.vertices.size(),
+                    geometry.indices.size(),
+                    glm::mat4(1.0f),
+                    gfx::vk::Vertex::compute_bounding_box(geometry.vertices));
                 patterns.emplace(pattern_name, GroundPattern(pattern_name, std::move(mesh)));
             };
 
@@ -2,6 +2,7 @@
 #include "utils/random_utils.h"
 
 #include <array>
+#include <algorithm>
 #include <magic_enum.hpp>
 
 namespace inf {
@@ -15,7 +16,7 @@ namespace inf {
 
     World::World(const Timer& timer, Context& context, std::function<gfx::ParticleSystem(int)> rain_particle_factory) :
         timer(timer), context(context), rain_particle_factory(rain_particle_factory),
-        dirty(true), weather(Weather::SUNNY), rain_intensity(RainIntensity::NONE),
+        district_cache(MAX_CACHED_DISTRICTS, MAX_CACHED_DISTRICT_BYTES), weather(Weather::SUNNY), rain_intensity(RainIntensity::NONE),
         last_weather_change_check(static_cast<float>(timer.get_time())) {}
 
     bool World::has_district_at(const glm::ivec2& position) const {
@@ -23,8 +24,8 @@ namespace inf {
     }
 
     District& World::add_district(const glm::ivec2& position, District&& district) {
-        // Flag as dirty to recompute caches before rendering
-        dirty = true;
+        // Flag as changed to recompute the seams around the district before rendering
+        changed_districts.emplace(position);
         return districts.emplace(position, std::move(district)).first->second;
     }
 
@@ -32,6 +33,23 @@ namespace inf {
         return districts;
     }
 
+    void World::set_retained_districts(std::unordered_set<glm::ivec2>&& grid_positions) {
+        retained_districts = std::move(grid_positions);
+    }
+
+    bool World::restore_district(const glm::ivec2& position) {
+        auto district = district_cache.take(position);
+        if (!district) {
+            return false;
+        }
+        add_district(position, std::move(district.value()));
+        return true;
+    }
+
+    utils::CacheStatistics World::get_district_cache_statistics() const {
+        return district_cache.get_statistics();
+    }
+
     std::size_t World::get_number_of_districts() const {
         return districts.size();
     }
@@ -66,20 +84,27 @@ namespace inf {
     void World::update(const gfx::Renderer& renderer, RandomGenerator& rng, float delta_time) {
         const auto frustum = renderer.get_frustum_in_view_space();
         const auto transformation = renderer.get_view_matrix();
-        // Remove districts that are not visible anymore
+        // Evict districts that are not visible anymore even with the eviction margin into the cache
+        const auto margin = std::max(context.eviction_margin, context.prefetch_margin);
+        const auto enlargement = glm::vec3(margin, 0.0f, margin);
         std::vector<glm::ivec2> keys_to_remove;
         for (const auto& entry : districts) {
             const auto& district = entry.second;
             const auto district_bb = district.compute_bounding_box();
-            if (!frustum.is_inside(district_bb.to_oriented(transformation))) {
+            const auto enlarged_bb = BoundingBox3D(district_bb.min - enlargement, district_bb.max + enlargement);
+            if (retained_districts.find(entry.first) == retained_districts.cend() &&
+                !frustum.is_inside(enlarged_bb.to_oriented(transformation))) {
                 keys_to_remove.emplace_back(entry.first);
             }
         }
         for (const auto& key : keys_to_remove) {
-            districts.erase(key);
-        }
-        if (!keys_to_remove.empty()) {
-            dirty = true;
+            const auto it = districts.find(key);
+            // Evicted districts are not rendered, so their instances should not be retained by the renderer either
+            it->second.release_instance_sets();
+            const auto memory_usage = it->second.estimate_memory_usage();
+            district_cache.insert(key, std::move(it->second), memory_usage);
+            districts.erase(it);
+            changed_districts.emplace(key);
         }
 
         // Update the remaining districts
@@ -122,12 +147,6 @@ namespace inf {
             district.render(renderer);
         }
 
-        // Render roads between districts
-        const auto& road = wfc::GroundPatterns::get_pattern("road").mesh;
-        const auto& crossing = wfc::GroundPatterns::get_pattern("road_crossing").mesh;
-        renderer.render_instanced(road, road_positions, road_rotations);
-        renderer.render_instanced(crossing, crossing_positions, crossing_rotations);
-        
         // Render rain particles
         if (rain_particles) {
             renderer.render_particles(*rain_particles->mesh, rain_particles->positions);
@@ -135,59 +154,36 @@ namespace inf {
     }
 
     bool World::is_dirty() const {
-        return dirty;
+        return !changed_districts.empty();
     }
 
-    void World::update_caches() {
-        road_positions.clear();
-        road_rotations.clear();
-        crossing_positions.clear();
-        crossing_rotations.clear();
-
-        for (const auto& [grid_position, district] : districts) {
-            const auto roads_at_edges = district.get_roads_at_edges();
-
-            // Place a road to the right of each district to connect their roads seamlessly
-            const auto right_district_it = districts.find(grid_position + glm::ivec2(1, 0));
-            const auto right_district = (right_district_it != districts.cend()) ? &right_district_it->second : nullptr;
-            const auto right_roads_at_edges = right_district
-                ? right_district->get_roads_at_edges()
-                : std::unordered_map<glm::ivec2, const DistrictRoad*>{};
-            place_vertical_road(&district, roads_at_edges, right_roads_at_edges);
-
-            // Place a road to the top of each district to connect their roads seamlessly
-            const auto top_district_it = districts.find(grid_position + glm::ivec2(0, -1));
-            const auto top_district = (top_district_it != districts.cend()) ? &top_district_it->second : nullptr;
-            const auto top_roads_at_edges = top_district
-                ? top_district->get_roads_at_edges()
-                : std::unordered_map<glm::ivec2, const DistrictRoad*>{};
-            place_horizontal_road(&district, top_roads_at_edges, roads_at_edges);
-
-            // Seal the corners
-            const auto& world_position = district.get_position();
-            const auto& dimensions = district.get_dimensions();
-            // Bottom left
-            crossing_positions.emplace_back(glm::vec3(world_position.x - 0.5f, world_position.y + 0.5f, world_position.z - 0.5f));
-            crossing_rotations.emplace_back(glm::radians(270.0f));
-            // Bottom right
-            crossing_positions.emplace_back(glm::vec3(world_position.x + dimensions.x + 0.5f, world_position.y + 0.5f, world_position.z - 0.5f));
-            crossing_rotations.emplace_back(0.0f);
-            // Top left
-            crossing_positions.emplace_back(glm::vec3(world_position.x - 0.5f, world_position.y + 0.5f, world_position.z + dimensions.y + 0.5f));
-            crossing_rotations.emplace_back(glm::radians(180.0f));
-            // Top right
-            crossing_positions.emplace_back(glm::vec3(world_position.x + dimensions.x + 0.5f, world_position.y + 0.5f, world_position.z + dimensions.y + 0.5f));
-            crossing_rotations.emplace_back(glm::radians(90.0f));
+    void World::update_caches(gfx::Renderer& renderer) {
+        for (const auto& position : changed_districts) {
+            // Vertical seams are owned by the left district and horizontal ones by the bottom district (which is above in the grid)
+            update_vertical_seam(renderer, position);
+            update_vertical_seam(renderer, position + glm::ivec2(-1, 0));
+            update_horizontal_seam(renderer, position);
+            update_horizontal_seam(renderer, position + glm::ivec2(0, 1));
+            update_corner_seam(renderer, position);
         }
+        changed_districts.clear();
+    }
 
-        // Clear the dirty flag to avoid recomputing caches when not necessary
-        dirty = false;
+    const District* World::find_district(const glm::ivec2& position) const {
+        const auto it = districts.find(position);
+        return it != districts.cend() ? &it->second : nullptr;
     }
 
-    void World::place_vertical_road(
-            const District* left,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& left_roads_at_edges,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& right_roads_at_edges) {
+    void World::update_vertical_seam(gfx::Renderer& renderer, const glm::ivec2& left_grid_position) {
+        const auto left = find_district(left_grid_position);
+        if (!left) {
+            vertical_seams.erase(left_grid_position);
+            return;
+        }
+        // Place a road to the right of the district to connect their roads seamlessly
+        const auto right = find_district(left_grid_position + glm::ivec2(1, 0));
+        SeamGeometry seam;
+        const auto& left_edge = left->get_edge_roads().last_column;
         const auto& world_position = left->get_position();
         const auto& dimensions = left->get_dimensions();
         const auto base_position = glm::vec3(world_position.x + dimensions.x + 0.5f, world_position.y + 0.5f, world_position.z + 0.5f);
@@ -196,59 +192,100 @@ namespace inf {
             const auto right_position = glm::vec3(left_position.x + 1.0f, left_position.y, left_position.z);
 
             // Check if the left road needs to be a crossing
-            if (const auto it = left_roads_at_edges.find(glm::ivec2(left->get_dimensions().x - 1, z_offset)); it != left_roads_at_edges.cend()) {
-                crossing_positions.emplace_back(left_position);
-                crossing_rotations.emplace_back(it->second->direction == RoadDirection::HORIZONTAL_UP ? glm::radians(90.f) : 0.0f);
+            if (const auto& direction = left_edge[z_offset]; direction) {
+                seam.crossing_positions.emplace_back(left_position);
+                seam.crossing_rotations.emplace_back(direction == RoadDirection::HORIZONTAL_UP ? glm::radians(90.f) : 0.0f);
             }
             else {
-                road_positions.emplace_back(left_position);
-                road_rotations.emplace_back(0.0f);    
+                seam.road_positions.emplace_back(left_position);
+                seam.road_rotations.emplace_back(0.0f);
             }
 
             // Check if the right road needs to be a crossing
-            if (const auto it = right_roads_at_edges.find(glm::ivec2(0, z_offset)); it != right_roads_at_edges.cend()) {
-                crossing_positions.emplace_back(right_position);
-                crossing_rotations.emplace_back(it->second->direction == RoadDirection::HORIZONTAL_DOWN ? glm::radians(270.0f) : glm::radians(180.0f));
+            if (const auto direction = right ? right->get_edge_roads().first_column[z_offset] : std::nullopt; direction) {
+                seam.crossing_positions.emplace_back(right_position);
+                seam.crossing_rotations.emplace_back(direction == RoadDirection::HORIZONTAL_DOWN ? glm::radians(270.0f) : glm::radians(180.0f));
             }
             else {
-                road_positions.emplace_back(right_position);
-                road_rotations.emplace_back(glm::radians(180.0f));
+                seam.road_positions.emplace_back(right_position);
+                seam.road_rotations.emplace_back(glm::radians(180.0f));
             }
         }
+        vertical_seams[left_grid_position] = register_seam(renderer, seam);
     }
 
-
-    void World::place_horizontal_road(
-            const District* bottom,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& top_roads_at_edges,
-            const std::unordered_map<glm::ivec2, const DistrictRoad*>& bottom_roads_at_edges) {
+    void World::update_horizontal_seam(gfx::Renderer& renderer, const glm::ivec2& bottom_grid_position) {
+        const auto bottom = find_district(bottom_grid_position);
+        if (!bottom) {
+            horizontal_seams.erase(bottom_grid_position);
+            return;
+        }
+        // Place a road to the top of the district to connect their roads seamlessly
+        const auto top = find_district(bottom_grid_position + glm::ivec2(0, -1));
+        SeamGeometry seam;
+        const auto& bottom_edge = bottom->get_edge_roads().last_row;
         const auto& world_position = bottom->get_position();
         const auto& dimensions = bottom->get_dimensions();
         for (int x_offset = 0; x_offset < dimensions.x; ++x_offset) {
-                const auto bottom_position = glm::vec3(
-                    world_position.x + x_offset + 0.5f,
-                    world_position.y + 0.5f,
-                    world_position.z + dimensions.y + 0.5f);
-                const auto top_position = glm::vec3(bottom_position.x, bottom_position.y, bottom_position.z + 1.0f);
-
-                if (const auto it = bottom_roads_at_edges.find(glm::ivec2(x_offset, dimensions.y - 1)); it != bottom_roads_at_edges.cend()) {
-                    crossing_positions.emplace_back(bottom_position);
-                    crossing_rotations.emplace_back(it->second->direction == RoadDirection::VERTICAL_LEFT ? glm::radians(90.0f) : glm::radians(180.0f));
-                }
-                else {
-                    road_positions.emplace_back(bottom_position);
-                    road_rotations.emplace_back(glm::radians(90.0f));
-                }
-
-                if (const auto it = top_roads_at_edges.find(glm::ivec2(x_offset, 0)); it != top_roads_at_edges.cend()) {
-                    crossing_positions.emplace_back(top_position);
-                    crossing_rotations.emplace_back(it->second->direction == RoadDirection::VERTICAL_LEFT ? 0.0f : glm::radians(270.0f)); // TODO: Fix this
-                }
-                else {
-                    road_positions.emplace_back(top_position);
-                    road_rotations.emplace_back(glm::radians(270.0f));
-                }
+            const auto bottom_position = glm::vec3(
+                world_position.x + x_offset + 0.5f,
+                world_position.y + 0.5f,
+                world_position.z + dimensions.y + 0.5f);
+            const auto top_position = glm::vec3(bottom_position.x, bottom_position.y, bottom_position.z + 1.0f);
+
+            if (const auto& direction = bottom_edge[x_offset]; direction) {
+                seam.crossing_positions.emplace_back(bottom_position);
+                seam.crossing_rotations.emplace_back(direction == RoadDirection::VERTICAL_LEFT ? glm::radians(90.0f) : glm::radians(180.0f));
             }
+            else {
+                seam.road_positions.emplace_back(bottom_position);
+                seam.road_rotations.emplace_back(glm::radians(90.0f));
+            }
+
+            if (const auto direction = top ? top->get_edge_roads().first_row[x_offset] : std::nullopt; direction) {
+                seam.crossing_positions.emplace_back(top_position);
+                seam.crossing_rotations.emplace_back(direction == RoadDirection::VERTICAL_LEFT ? 0.0f : glm::radians(270.0f)); // TODO: Fix this
+            }
+            else {
+                seam.road_positions.emplace_back(top_position);
+                seam.road_rotations.emplace_back(glm::radians(270.0f));
+            }
+        }
+        horizontal_seams[bottom_grid_position] = register_seam(renderer, seam);
+    }
+
+    void World::update_corner_seam(gfx::Renderer& renderer, const glm::ivec2& position) {
+        const auto district = find_district(position);
+        if (!district) {
+            corner_seams.erase(position);
+            return;
+        }
+        // Seal the corners
+        SeamGeometry seam;
+        const auto& world_position = district->get_position();
+        const auto& dimensions = district->get_dimensions();
+        // Bottom left
+        seam.crossing_positions.emplace_back(glm::vec3(world_position.x - 0.5f, world_position.y + 0.5f, world_position.z - 0.5f));
+        seam.crossing_rotations.emplace_back(glm::radians(270.0f));
+        // Bottom right
+        seam.crossing_positions.emplace_back(glm::vec3(world_position.x + dimensions.x + 0.5f, world_position.y + 0.5f, world_position.z - 0.5f));
+        seam.crossing_rotations.emplace_back(0.0f);
+        // Top left
+        seam.crossing_positions.emplace_back(glm::vec3(world_position.x - 0.5f, world_position.y + 0.5f, world_position.z + dimensions.y + 0.5f));
+        seam.crossing_rotations.emplace_back(glm::radians(180.0f));
+        // Top right
+        seam.crossing_positions.emplace_back(glm::vec3(world_position.x + dimensions.x + 0.5f, world_position.y + 0.5f, world_position.z + dimensions.y + 0.5f));
+        seam.crossing_rotations.emplace_back(glm::radians(90.0f));
+        corner_seams[position] = register_seam(renderer, seam);
+    }
+
+    World::Seam World::register_seam(gfx::Renderer& renderer, const SeamGeometry& geometry) {
+        const auto& road = wfc::GroundPatterns::get_pattern("road").mesh;
+        const auto& crossing = wfc::GroundPatterns::get_pattern("road_crossing").mesh;
+        return Seam{
+            renderer.create_instance_set(road, false, geometry.road_positions, geometry.road_rotations),
+            renderer.create_instance_set(crossing, false, geometry.crossing_positions, geometry.crossing_rotations)
+        };
     }
 
     std::vector<std::pair<Weather, RainIntensity>> World::get_possible_new_weathers() const {
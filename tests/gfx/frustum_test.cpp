@@ -1,6 +1,9 @@
 #include "gfx/frustum.h"
 
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
 
 using namespace inf;
 using namespace inf::gfx;
@@ -72,4 +75,35 @@ TEST_CASE("Frustum::is_inside()") {
         REQUIRE(frustum.is_inside(obb));
     }
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Frustum::extract_planes()") {
+
+    // Looking down the negative Z axis from the origin, with depth mapped to [0, 1] like in the renderer
+    const auto matrix = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, 1.0f, 10.0f);
+    const auto planes = Frustum::extract_planes(matrix);
+
+    SECTION("returns normalized planes facing inwards") {
+        using Catch::Matchers::WithinAbs;
+        for (const auto& plane : planes) {
+            REQUIRE_THAT(glm::length(glm::vec3(plane)), WithinAbs(1.0, 0.0001));
+            // The center of the frustum is in front of every plane
+            REQUIRE(glm::dot(glm::vec3(plane), glm::vec3(0.0f, 0.0f, -5.0f)) + plane.w > 0.0f);
+        }
+        // Near and far planes are at the distance of the clipping planes
+        REQUIRE_THAT(planes[4].w, WithinAbs(-1.0, 0.0001));
+        REQUIRE_THAT(planes[5].w, WithinAbs(10.0, 0.0001));
+    }
+
+    SECTION("culls spheres that are completely outside of one of the planes") {
+        REQUIRE(Frustum::is_sphere_inside(planes, glm::vec3(0.0f, 0.0f, -5.0f), 0.1f));
+        // Behind the camera, beyond the far plane and to the side
+        REQUIRE_FALSE(Frustum::is_sphere_inside(planes, glm::vec3(0.0f, 0.0f, 5.0f), 1.0f));
+        REQUIRE_FALSE(Frustum::is_sphere_inside(planes, glm::vec3(0.0f, 0.0f, -12.0f), 1.0f));
+        REQUIRE_FALSE(Frustum::is_sphere_inside(planes, glm::vec3(8.0f, 0.0f, -5.0f), 1.0f));
+        // Intersecting a plane counts as inside
+        REQUIRE(Frustum::is_sphere_inside(planes, glm::vec3(0.0f, 0.0f, -10.5f), 1.0f));
+        REQUIRE(Frustum::is_sphere_inside(planes, glm::vec3(6.0f, 0.0f, -5.0f), 1.0f));
+    }
+
+}
@@ -0,0 +1,75 @@
+#include "gfx/instance_batch.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace inf;
+using namespace inf::gfx;
+
+struct TestEntry {
+
+    const Mesh* mesh;
+    std::vector<int> instances;
+
+};
+
+// Only the addresses of the meshes are used, so they do not need to be valid meshes
+static const auto first_mesh = reinterpret_cast<const Mesh*>(0x10);
+static const auto second_mesh = reinterpret_cast<const Mesh*>(0x20);
+
+TEST_CASE("gfx::group_by_mesh()") {
+
+    SECTION("groups entries by their mesh in the order of the first appearance of the mesh") {
+        const std::vector<TestEntry> entries{
+            { second_mesh, { 1 } },
+            { first_mesh, { 2 } },
+            { second_mesh, { 3 } }
+        };
+        const auto groups = group_by_mesh(entries);
+        REQUIRE(groups.size() == 2);
+        REQUIRE(groups[0] == std::vector<const TestEntry*>{ &entries[0], &entries[2] });
+        REQUIRE(groups[1] == std::vector<const TestEntry*>{ &entries[1] });
+    }
+
+}
+
+TEST_CASE("gfx::batch_instances()") {
+
+    const auto append = [](const TestEntry& entry, std::vector<int>& data) {
+        data.insert(data.end(), entry.instances.cbegin(), entry.instances.cend());
+    };
+
+    SECTION("creates a single contiguous batch for every mesh") {
+        const std::vector<TestEntry> entries{
+            { first_mesh, { 1, 2 } },
+            { second_mesh, { 3 } },
+            { first_mesh, { 4, 5, 6 } },
+            { second_mesh, { 7 } }
+        };
+        std::vector<int> data;
+        const auto batches = batch_instances(entries, data, append);
+        REQUIRE(data == std::vector<int>{ 1, 2, 4, 5, 6, 3, 7 });
+        REQUIRE(batches.size() == 2);
+        REQUIRE(batches[0].mesh == first_mesh);
+        REQUIRE(batches[0].offset == 0);
+        REQUIRE(batches[0].num_instances == 5);
+        REQUIRE(batches[1].mesh == second_mesh);
+        REQUIRE(batches[1].offset == 5 * sizeof(int));
+        REQUIRE(batches[1].num_instances == 2);
+    }
+
+    SECTION("offsets batches by the data that is already in the buffer and skips empty batches") {
+        const std::vector<TestEntry> entries{
+            { first_mesh, {} },
+            { second_mesh, { 1 } }
+        };
+        std::vector<int> data{ 0, 0 };
+        const auto batches = batch_instances(entries, data, append);
+        REQUIRE(batches.size() == 1);
+        REQUIRE(batches[0].mesh == second_mesh);
+        REQUIRE(batches[0].offset == 2 * sizeof(int));
+        REQUIRE(batches[0].num_instances == 1);
+    }
+
+}
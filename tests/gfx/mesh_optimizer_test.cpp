@@ -0,0 +1,134 @@
+#include "gfx/mesh_optimizer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+
+using namespace inf;
+using namespace inf::gfx;
+
+struct TestVertex {
+
+    glm::vec3 position;
+    int id;
+
+};
+
+using Triangle = std::array<int, 3>;
+
+// Triangles of an indexed mesh by the ids of their vertices, rotated so that the smallest id comes first
+static std::vector<Triangle> get_triangles(const IndexedGeometry<TestVertex>& geometry) {
+    std::vector<Triangle> result;
+    for (std::size_t i = 0; i < geometry.indices.size(); i += 3) {
+        Triangle triangle{
+            geometry.vertices[geometry.indices[i]].id,
+            geometry.vertices[geometry.indices[i + 1]].id,
+            geometry.vertices[geometry.indices[i + 2]].id
+        };
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        result.emplace_back(triangle);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// Triangle soup of a size x size grid of quads in the XZ plane, the quads are emitted in a cache unfriendly order
+static std::vector<TestVertex> create_grid(int size) {
+    const auto vertex = [size](int x, int z) {
+        return TestVertex{ glm::vec3(x, 0.0f, z), z * (size + 1) + x };
+    };
+    std::vector<TestVertex> result;
+    for (int x = 0; x < size; ++x) {
+        for (int z = 0; z < size; ++z) {
+            result.insert(result.end(), { vertex(x, z), vertex(x, z + 1), vertex(x + 1, z) });
+            result.insert(result.end(), { vertex(x + 1, z), vertex(x, z + 1), vertex(x + 1, z + 1) });
+        }
+    }
+    return result;
+}
+
+static IndexedGeometry<TestVertex> to_unindexed(const std::vector<TestVertex>& vertices) {
+    IndexedGeometry<TestVertex> result{ vertices, {} };
+    for (std::uint32_t i = 0; i < vertices.size(); ++i) {
+        result.indices.emplace_back(i);
+    }
+    return result;
+}
+
+TEST_CASE("MeshOptimizer::deduplicate()") {
+
+    SECTION("merges identical vertices and keeps the triangles") {
+        const std::vector<TestVertex> vertices{
+            { glm::vec3(0.0f, 0.0f, 0.0f), 0 }, { glm::vec3(1.0f, 0.0f, 0.0f), 1 }, { glm::vec3(0.0f, 1.0f, 0.0f), 2 },
+            { glm::vec3(0.0f, 1.0f, 0.0f), 2 }, { glm::vec3(1.0f, 0.0f, 0.0f), 1 }, { glm::vec3(1.0f, 1.0f, 0.0f), 3 }
+        };
+        const auto result = MeshOptimizer::deduplicate(vertices);
+        REQUIRE(result.vertices.size() == 4);
+        REQUIRE(result.indices == std::vector<std::uint32_t>{ 0, 1, 2, 2, 1, 3 });
+    }
+
+    SECTION("keeps vertices that only differ in a single attribute") {
+        const std::vector<TestVertex> vertices{
+            { glm::vec3(0.0f, 0.0f, 0.0f), 0 }, { glm::vec3(0.0f, 0.0f, 0.0f), 1 }, { glm::vec3(0.0f, 0.0f, 0.0f), 0 }
+        };
+        const auto result = MeshOptimizer::deduplicate(vertices);
+        REQUIRE(result.vertices.size() == 2);
+        REQUIRE(result.indices == std::vector<std::uint32_t>{ 0, 1, 0 });
+    }
+
+}
+
+TEST_CASE("MeshOptimizer::optimize_vertex_cache()") {
+
+    const auto grid = create_grid(16);
+    auto geometry = MeshOptimizer::deduplicate(grid);
+    const auto triangles = get_triangles(geometry);
+    const auto acmr = MeshOptimizer::compute_acmr(geometry.indices, MeshOptimizer::VERTEX_CACHE_SIZE);
+    MeshOptimizer::optimize_vertex_cache(geometry.indices, geometry.vertices.size());
+
+    SECTION("keeps every triangle and their winding") {
+        REQUIRE(get_triangles(geometry) == triangles);
+    }
+
+    SECTION("does not increase the cache miss ratio") {
+        REQUIRE(MeshOptimizer::compute_acmr(geometry.indices, MeshOptimizer::VERTEX_CACHE_SIZE) <= acmr);
+    }
+
+}
+
+TEST_CASE("MeshOptimizer::optimize_vertex_fetch()") {
+
+    SECTION("orders vertices by their first use and drops unused vertices") {
+        IndexedGeometry<TestVertex> geometry{
+            { { glm::vec3(0.0f), 0 }, { glm::vec3(0.0f), 1 }, { glm::vec3(0.0f), 2 }, { glm::vec3(0.0f), 3 } },
+            { 2, 0, 3, 3, 0, 2 }
+        };
+        MeshOptimizer::optimize_vertex_fetch(geometry);
+        REQUIRE(geometry.vertices.size() == 3);
+        REQUIRE(geometry.indices == std::vector<std::uint32_t>{ 0, 1, 2, 2, 1, 0 });
+        REQUIRE(geometry.vertices[0].id == 2);
+        REQUIRE(geometry.vertices[1].id == 0);
+        REQUIRE(geometry.vertices[2].id == 3);
+    }
+
+}
+
+TEST_CASE("MeshOptimizer::optimize()") {
+
+    const auto grid = create_grid(16);
+    const auto result = MeshOptimizer::optimize(grid);
+
+    SECTION("keeps every triangle of the triangle soup") {
+        REQUIRE(result.vertices.size() == 17 * 17);
+        REQUIRE(get_triangles(result) == get_triangles(to_unindexed(grid)));
+    }
+
+    SECTION("shades fewer vertices than the triangle soup") {
+        REQUIRE(MeshOptimizer::compute_acmr(result.indices, MeshOptimizer::VERTEX_CACHE_SIZE) < 3.0f);
+    }
+
+}
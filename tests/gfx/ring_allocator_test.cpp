@@ -0,0 +1,93 @@
+#include "gfx/ring_allocator.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <stdexcept>
+
+using namespace inf::gfx;
+
+TEST_CASE("gfx::RingAllocator") {
+
+    SECTION("aligns allocations") {
+        RingAllocator ring(256, 2);
+        ring.begin_frame(0);
+        REQUIRE(ring.allocate(10, 16) == 0u);
+        REQUIRE(ring.allocate(10, 16) == 16u);
+        REQUIRE(ring.get_statistics().used == 26);
+    }
+
+    SECTION("returns an empty optional if the allocation does not fit") {
+        RingAllocator ring(64, 2);
+        ring.begin_frame(0);
+        REQUIRE(ring.allocate(48, 16) == 0u);
+        REQUIRE_FALSE(ring.allocate(32, 16).has_value());
+        REQUIRE_FALSE(ring.allocate(128, 16).has_value());
+    }
+
+    SECTION("does not overwrite the allocations of frames in flight") {
+        RingAllocator ring(64, 2);
+        ring.begin_frame(0);
+        REQUIRE(ring.allocate(32, 16) == 0u);
+        ring.begin_frame(1);
+        REQUIRE(ring.allocate(16, 16) == 32u);
+        // The first frame is still in flight, so wrapping around is not possible yet
+        REQUIRE_FALSE(ring.allocate(32, 16).has_value());
+        REQUIRE(ring.allocate(16, 16) == 48u);
+    }
+
+    SECTION("wraps around once the oldest frame retires") {
+        RingAllocator ring(64, 2);
+        ring.begin_frame(0);
+        REQUIRE(ring.allocate(32, 16) == 0u);
+        ring.begin_frame(1);
+        REQUIRE(ring.allocate(16, 16) == 32u);
+        ring.begin_frame(0);
+        REQUIRE(ring.allocate(32, 16) == 0u);
+        // The space skipped at the end of the buffer is accounted to the frame that wrapped around
+        REQUIRE(ring.get_statistics().used == 64);
+        ring.begin_frame(1);
+        REQUIRE(ring.get_statistics().used == 48);
+        REQUIRE(ring.allocate(16, 16) == 32u);
+    }
+
+    SECTION("starts from the beginning when every frame retired") {
+        RingAllocator ring(64, 2);
+        ring.begin_frame(0);
+        REQUIRE(ring.allocate(48, 16) == 0u);
+        ring.begin_frame(1);
+        ring.begin_frame(0);
+        REQUIRE(ring.get_statistics().used == 0);
+        REQUIRE(ring.allocate(64, 16) == 0u);
+    }
+
+    SECTION("reports the high water mark") {
+        RingAllocator ring(128, 2);
+        ring.begin_frame(0);
+        ring.allocate(64, 16);
+        ring.begin_frame(1);
+        ring.allocate(32, 16);
+        ring.begin_frame(0);
+        ring.begin_frame(1);
+        const auto statistics = ring.get_statistics();
+        REQUIRE(statistics.capacity == 128);
+        REQUIRE(statistics.used == 0);
+        REQUIRE(statistics.high_water_mark == 96);
+    }
+
+    SECTION("keeps the high water mark when the capacity is reset") {
+        RingAllocator ring(64, 2);
+        ring.begin_frame(0);
+        ring.allocate(48, 16);
+        ring.reset(256);
+        REQUIRE(ring.allocate(128, 16) == 0u);
+        const auto statistics = ring.get_statistics();
+        REQUIRE(statistics.capacity == 256);
+        REQUIRE(statistics.used == 128);
+        REQUIRE(statistics.high_water_mark == 128);
+    }
+
+    SECTION("requires at least one frame") {
+        REQUIRE_THROWS_AS(RingAllocator(64, 0), std::runtime_error);
+    }
+
+}
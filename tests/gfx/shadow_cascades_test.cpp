@@ -0,0 +1,203 @@
+#include "gfx/shadow_cascades.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+using namespace inf;
+using namespace inf::gfx;
+
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+
+TEST_CASE("ShadowCascades::compute_split_distances()") {
+
+    SECTION("returns the boundaries of the slices from near to far") {
+        const auto result = ShadowCascades::compute_split_distances(0.1f, 40.0f, 4, 0.5f);
+        REQUIRE(result.size() == 5);
+        REQUIRE(result.front() == 0.1f);
+        REQUIRE(result.back() == 40.0f);
+        for (std::size_t i = 1; i < result.size(); ++i) {
+            REQUIRE(result[i] > result[i - 1]);
+        }
+    }
+
+    SECTION("splits uniformly with a lambda of 0 and logarithmically with a lambda of 1") {
+        const auto uniform = ShadowCascades::compute_split_distances(1.0f, 16.0f, 4, 0.0f);
+        REQUIRE_THAT(uniform[1], WithinRel(4.75f));
+        REQUIRE_THAT(uniform[2], WithinRel(8.5f));
+        const auto logarithmic = ShadowCascades::compute_split_distances(1.0f, 16.0f, 4, 1.0f);
+        REQUIRE_THAT(logarithmic[1], WithinRel(2.0f));
+        REQUIRE_THAT(logarithmic[2], WithinRel(4.0f));
+        REQUIRE_THAT(logarithmic[3], WithinRel(8.0f));
+    }
+
+    SECTION("throws for invalid parameters") {
+        REQUIRE_THROWS(ShadowCascades::compute_split_distances(1.0f, 16.0f, 0, 0.5f));
+        REQUIRE_THROWS(ShadowCascades::compute_split_distances(0.0f, 16.0f, 4, 0.5f));
+        REQUIRE_THROWS(ShadowCascades::compute_split_distances(16.0f, 1.0f, 4, 0.5f));
+    }
+
+}
+
+TEST_CASE("ShadowCascades::fit()") {
+
+    static constexpr float fovy = 1.0f;
+    static constexpr float aspect = 16.0f / 9.0f;
+    static constexpr float near = 2.0f;
+    static constexpr float far = 10.0f;
+    static constexpr float caster_distance = 20.0f;
+    static constexpr std::uint32_t resolution = 1024;
+    const auto light_direction = glm::normalize(glm::vec3(-0.65f, -0.54f, -0.54f));
+    const auto view_matrix = glm::lookAt(glm::vec3(3.3f, 2.0f, -7.1f), glm::vec3(5.0f, 1.5f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    SECTION("covers the slice of the camera frustum") {
+        const auto cascade = ShadowCascades::fit(view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.0f, resolution);
+        REQUIRE(cascade.near_distance == near);
+        REQUIRE(cascade.far_distance == far);
+        const auto inverse_view_matrix = glm::inverse(view_matrix);
+        const auto light_space_matrix = cascade.get_light_space_matrix();
+        for (const auto distance : { near, far }) {
+            const auto half_height = distance * std::tan(fovy * 0.5f);
+            const auto half_width = half_height * aspect;
+            for (const auto y : { -half_height, half_height }) {
+                for (const auto x : { -half_width, half_width }) {
+                    const auto corner = inverse_view_matrix * glm::vec4(x, y, -distance, 1.0f);
+                    const auto projected = light_space_matrix * corner;
+                    REQUIRE(std::abs(projected.x) <= 1.0f);
+                    REQUIRE(std::abs(projected.y) <= 1.0f);
+                    REQUIRE(projected.z >= 0.0f);
+                    REQUIRE(projected.z <= 1.0f);
+                }
+            }
+        }
+    }
+
+    SECTION("includes casters towards the light") {
+        const auto cascade = ShadowCascades::fit(view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.0f, resolution);
+        const auto slice_center = glm::vec3(glm::inverse(view_matrix) * glm::vec4(0.0f, 0.0f, -(near + far) * 0.5f, 1.0f));
+        const auto caster = slice_center - light_direction * caster_distance;
+        const auto projected = cascade.get_light_space_matrix() * glm::vec4(caster, 1.0f);
+        REQUIRE(projected.z >= 0.0f);
+        REQUIRE(projected.z < 1.0f);
+    }
+
+    SECTION("does not change its size as the camera rotates") {
+        const auto rotated_view_matrix = glm::rotate(view_matrix, 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+        const auto first = ShadowCascades::fit(view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.0f, resolution);
+        const auto second = ShadowCascades::fit(rotated_view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.0f, resolution);
+        REQUIRE(first.projection_matrix[0][0] == second.projection_matrix[0][0]);
+        REQUIRE(first.projection_matrix[1][1] == second.projection_matrix[1][1]);
+    }
+
+    SECTION("snaps the world origin to a texel corner") {
+        const auto moved_view_matrix = glm::translate(view_matrix, glm::vec3(0.123f, 0.0f, 0.456f));
+        for (const auto& matrix : { view_matrix, moved_view_matrix }) {
+            const auto cascade = ShadowCascades::fit(matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.0f, resolution);
+            const auto origin = cascade.get_light_space_matrix() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            const auto x_in_texels = origin.x * resolution * 0.5f;
+            const auto y_in_texels = origin.y * resolution * 0.5f;
+            REQUIRE_THAT(x_in_texels, WithinAbs(std::round(x_in_texels), 1e-2f));
+            REQUIRE_THAT(y_in_texels, WithinAbs(std::round(y_in_texels), 1e-2f));
+        }
+    }
+
+    SECTION("enlarges the projection by the margin") {
+        const auto tight = ShadowCascades::fit(view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.0f, resolution);
+        const auto loose = ShadowCascades::fit(view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.5f, resolution);
+        REQUIRE(loose.projection_matrix[0][0] < tight.projection_matrix[0][0]);
+    }
+
+}
+
+TEST_CASE("ShadowCascades::covers()") {
+
+    static constexpr float fovy = 1.0f;
+    static constexpr float aspect = 16.0f / 9.0f;
+    static constexpr float near = 2.0f;
+    static constexpr float far = 10.0f;
+    static constexpr float caster_distance = 20.0f;
+    static constexpr std::uint32_t resolution = 1024;
+    const auto light_direction = glm::normalize(glm::vec3(-0.65f, -0.54f, -0.54f));
+    const auto view_matrix = glm::lookAt(glm::vec3(3.3f, 2.0f, -7.1f), glm::vec3(5.0f, 1.5f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const auto cascade = ShadowCascades::fit(view_matrix, fovy, aspect, near, far, light_direction, caster_distance, 0.25f, resolution);
+
+    SECTION("covers the slice it was fit to") {
+        REQUIRE(ShadowCascades::covers(cascade, view_matrix, fovy, aspect, near, far));
+    }
+
+    SECTION("covers the slice of a camera that moved less than the margin") {
+        const auto moved_view_matrix = glm::translate(view_matrix, glm::vec3(0.3f, 0.0f, -0.3f));
+        REQUIRE(ShadowCascades::covers(cascade, moved_view_matrix, fovy, aspect, near, far));
+    }
+
+    SECTION("does not cover the slice of a camera that moved farther than the margin") {
+        const auto moved_view_matrix = glm::translate(view_matrix, glm::vec3(5.0f, 0.0f, 0.0f));
+        REQUIRE_FALSE(ShadowCascades::covers(cascade, moved_view_matrix, fovy, aspect, near, far));
+    }
+
+    SECTION("does not cover a different slice") {
+        REQUIRE_FALSE(ShadowCascades::covers(cascade, view_matrix, fovy, aspect, far, 2.0f * far));
+    }
+
+}
+
+TEST_CASE("ShadowCasterVolume::is_sphere_inside()") {
+
+    // The camera looks along -Z from above the ground, the light shines straight down
+    const auto view_matrix = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const ShadowCasterVolume volume(view_matrix, glm::radians(90.0f), 1.0f, 1.0f, 10.0f, glm::vec3(0.0f, -1.0f, 0.0f));
+
+    SECTION("contains spheres inside of the slice") {
+        REQUIRE(volume.is_sphere_inside(glm::vec3(0.0f, 2.0f, -5.0f), 0.1f));
+    }
+
+    SECTION("contains spheres between the slice and the light") {
+        REQUIRE(volume.is_sphere_inside(glm::vec3(0.0f, 100.0f, -5.0f), 0.1f));
+        REQUIRE(volume.is_sphere_inside(glm::vec3(8.0f, 100.0f, -9.0f), 0.1f));
+    }
+
+    SECTION("does not contain spheres that cast their shadow outside of the slice") {
+        // Below the slice
+        REQUIRE_FALSE(volume.is_sphere_inside(glm::vec3(0.0f, -100.0f, -5.0f), 0.1f));
+        // Beside the slice, behind the camera and beyond the far plane
+        REQUIRE_FALSE(volume.is_sphere_inside(glm::vec3(20.0f, 100.0f, -5.0f), 0.1f));
+        REQUIRE_FALSE(volume.is_sphere_inside(glm::vec3(0.0f, 100.0f, 5.0f), 0.1f));
+        REQUIRE_FALSE(volume.is_sphere_inside(glm::vec3(0.0f, 100.0f, -20.0f), 0.1f));
+    }
+
+    SECTION("contains spheres that intersect the volume") {
+        REQUIRE(volume.is_sphere_inside(glm::vec3(0.0f, 100.0f, 1.0f), 2.5f));
+    }
+
+    SECTION("is extruded along the light direction") {
+        const ShadowCasterVolume slanted_volume(
+            view_matrix, glm::radians(90.0f), 1.0f, 1.0f, 10.0f, glm::normalize(glm::vec3(1.0f, -1.0f, 0.0f)));
+        REQUIRE(slanted_volume.is_sphere_inside(glm::vec3(-50.0f, 52.0f, -5.0f), 0.1f));
+        REQUIRE_FALSE(slanted_volume.is_sphere_inside(glm::vec3(50.0f, 52.0f, -5.0f), 0.1f));
+    }
+
+    SECTION("contains everything when default constructed") {
+        REQUIRE(ShadowCasterVolume().is_sphere_inside(glm::vec3(0.0f, -100.0f, 0.0f), 0.0f));
+    }
+
+    SECTION("contains the volumes of every cascade when constructed from cascades") {
+        const auto light_direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        const std::vector<ShadowCascade> cascades{
+            ShadowCascades::fit(view_matrix, glm::radians(90.0f), 1.0f, 1.0f, 2.0f, light_direction, 20.0f, 0.0f, 1024),
+            ShadowCascades::fit(view_matrix, glm::radians(90.0f), 1.0f, 8.0f, 10.0f, light_direction, 20.0f, 0.0f, 1024)
+        };
+        const ShadowCasterVolume cascades_volume(cascades);
+        REQUIRE(cascades_volume.is_sphere_inside(glm::vec3(0.0f, 2.0f, -1.5f), 0.1f));
+        REQUIRE(cascades_volume.is_sphere_inside(glm::vec3(0.0f, 2.0f, -9.0f), 0.1f));
+        // Above the slices within the caster distance
+        REQUIRE(cascades_volume.is_sphere_inside(glm::vec3(0.0f, 15.0f, -9.0f), 0.1f));
+        // Beside the slices, and beyond the caster distance
+        REQUIRE_FALSE(cascades_volume.is_sphere_inside(glm::vec3(30.0f, 2.0f, -5.0f), 0.1f));
+        REQUIRE_FALSE(cascades_volume.is_sphere_inside(glm::vec3(0.0f, 100.0f, -9.0f), 0.1f));
+    }
+
+}
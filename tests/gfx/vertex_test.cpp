@@ -0,0 +1,55 @@
+#include "gfx/vk/vertex.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <array>
+#include <stdexcept>
+
+using namespace inf;
+using namespace inf::gfx::vk;
+
+TEST_CASE("PackedVertex::PackedVertex()") {
+
+    SECTION("keeps positions within the precision of 16-bit integers") {
+        const Vertex vertex(glm::vec3(0.5f, -2.815f, 1.0f / 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f));
+        const PackedVertex packed(vertex);
+        REQUIRE(glm::length(packed.get_position() - vertex.position) < PackedVertex::POSITION_RANGE / 32767.0f);
+    }
+
+    SECTION("keeps the direction of normals") {
+        const std::array<glm::vec3, 6> normals{
+            glm::vec3(0.0f, 0.0f, -1.0f),
+            glm::vec3(-1.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)),
+            glm::normalize(glm::vec3(-1.0f, 2.0f, -3.0f)),
+            glm::normalize(glm::vec3(0.3f, -0.2f, -0.9f))
+        };
+        for (const auto& normal : normals) {
+            const PackedVertex packed(Vertex(glm::vec3(0.0f), normal, glm::vec3(0.0f)));
+            REQUIRE(glm::dot(packed.get_normal(), normal) > 0.9999f);
+        }
+    }
+
+    SECTION("keeps dark colors more precisely than bright ones") {
+        const PackedVertex dark(Vertex(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.006929f)));
+        REQUIRE(std::abs(dark.get_color().x - 0.006929f) < 0.0005f);
+        const PackedVertex bright(Vertex(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.911869f)));
+        REQUIRE(std::abs(bright.get_color().x - 0.911869f) < 0.01f);
+    }
+
+    SECTION("stores the material slot of building vertices") {
+        const VertexWithMaterial vertex(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0);
+        const PackedVertex packed(vertex, 11);
+        REQUIRE(packed.color[0] == 11);
+    }
+
+    SECTION("throws if the position does not fit into the packed range") {
+        const Vertex vertex(glm::vec3(PackedVertex::POSITION_RANGE * 2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f));
+        REQUIRE_THROWS_AS(PackedVertex(vertex), std::runtime_error);
+    }
+
+}
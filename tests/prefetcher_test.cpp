@@ -0,0 +1,100 @@
+#include "prefetcher.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+using namespace inf;
+
+static const DistrictGrid test_grid{ glm::vec3(0.0f), 100.0f, 10.0f, 2.0f };
+
+static bool contains(const std::vector<PrefetchCandidate>& candidates, const glm::ivec2& grid_position) {
+    return std::any_of(candidates.cbegin(), candidates.cend(), [&](const PrefetchCandidate& candidate) {
+        return candidate.grid_position == grid_position;
+    });
+}
+
+TEST_CASE("DistrictGrid") {
+
+    SECTION("Places districts relative to the origin") {
+        REQUIRE(test_grid.get_position(glm::ivec2(0, 0)) == glm::vec3(0.0f));
+        REQUIRE(test_grid.get_position(glm::ivec2(1, 2)) == glm::vec3(102.0f, 0.0f, -204.0f));
+        const auto bounding_box = test_grid.get_bounding_box(glm::ivec2(-1, 0));
+        REQUIRE(bounding_box.min == glm::vec3(-102.0f, 0.0f, 0.0f));
+        REQUIRE(bounding_box.max == glm::vec3(-2.0f, 10.0f, 100.0f));
+    }
+
+    SECTION("Finds the districts overlapping a box") {
+        const auto inside = test_grid.get_overlapping(BoundingBox3D(glm::vec3(10.0f), glm::vec3(20.0f)));
+        REQUIRE(inside == std::vector<glm::ivec2>{ glm::ivec2(0, 0) });
+        const auto across = test_grid.get_overlapping(BoundingBox3D(glm::vec3(50.0f, 0.0f, -50.0f), glm::vec3(150.0f, 0.0f, 10.0f)));
+        REQUIRE(across == std::vector<glm::ivec2>{ glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(0, 1), glm::ivec2(1, 1) });
+    }
+
+}
+
+TEST_CASE("DistrictPrefetcher") {
+
+    // Same projection as the renderer, including the flipped Y axis
+    auto projection_matrix = glm::perspective(glm::radians(65.0f), 16.0f / 9.0f, 0.01f, 100.0f);
+    projection_matrix[1][1] *= -1.0f;
+
+    SECTION("Tracks the camera velocity") {
+        DistrictPrefetcher prefetcher;
+        Camera camera(glm::vec3(50.0f, 7.0f, 50.0f), glm::vec3(0.0f, -0.6f, -1.0f));
+        for (int frame = 0; frame < 100; ++frame) {
+            prefetcher.update(camera, 0.1f);
+            camera.set_position(camera.get_position() + glm::vec3(10.0f, 0.0f, 0.0f));
+        }
+        REQUIRE_THAT(prefetcher.get_velocity().x, Catch::Matchers::WithinAbs(100.0f, 0.01f));
+        REQUIRE_THAT(prefetcher.get_velocity().z, Catch::Matchers::WithinAbs(0.0f, 0.01f));
+    }
+
+    SECTION("Only returns visible districts without a horizon") {
+        const DistrictPrefetcher prefetcher;
+        const Camera camera(glm::vec3(50.0f, 7.0f, 50.0f), glm::vec3(0.0f, -0.6f, -1.0f));
+        const auto candidates = prefetcher.predict(camera, projection_matrix, test_grid, 0.0f, 0.0f);
+        REQUIRE(contains(candidates, glm::ivec2(0, 0)));
+        REQUIRE(contains(candidates, glm::ivec2(0, 1)));
+        REQUIRE_FALSE(contains(candidates, glm::ivec2(0, -1)));
+        for (const auto& candidate : candidates) {
+            REQUIRE(candidate.time_to_visible == 0.0f);
+        }
+    }
+
+    SECTION("Predicts districts along the camera motion in order of time to visible") {
+        DistrictPrefetcher prefetcher;
+        Camera camera(glm::vec3(50.0f, 7.0f, 50.0f), glm::vec3(0.0f, -0.6f, -1.0f));
+        for (int frame = 0; frame < 100; ++frame) {
+            prefetcher.update(camera, 0.1f);
+            camera.set_position(camera.get_position() + glm::vec3(20.0f, 0.0f, 0.0f));
+        }
+        camera.set_position(glm::vec3(50.0f, 7.0f, 50.0f));
+        const auto visible = prefetcher.predict(camera, projection_matrix, test_grid, 0.0f, 0.0f);
+        const auto candidates = prefetcher.predict(camera, projection_matrix, test_grid, 2.0f, 0.0f);
+        REQUIRE(candidates.size() > visible.size());
+        REQUIRE(std::is_sorted(candidates.cbegin(), candidates.cend(), [](const PrefetchCandidate& a, const PrefetchCandidate& b) {
+            return a.time_to_visible < b.time_to_visible;
+        }));
+        // Moving along +x reveals the districts to the right, but not the ones to the left
+        REQUIRE(contains(candidates, glm::ivec2(3, 0)));
+        REQUIRE_FALSE(contains(candidates, glm::ivec2(-2, 0)));
+        for (const auto& candidate : candidates) {
+            REQUIRE((candidate.time_to_visible == 0.0f) == contains(visible, candidate.grid_position));
+        }
+    }
+
+    SECTION("Enlarging the frustum only adds districts") {
+        const DistrictPrefetcher prefetcher;
+        const Camera camera(glm::vec3(50.0f, 7.0f, 50.0f), glm::vec3(0.0f, -0.6f, -1.0f));
+        const auto candidates = prefetcher.predict(camera, projection_matrix, test_grid, 0.0f, 0.0f);
+        const auto enlarged = prefetcher.predict(camera, projection_matrix, test_grid, 0.0f, 20.0f);
+        REQUIRE(enlarged.size() >= candidates.size());
+        for (const auto& candidate : candidates) {
+            REQUIRE(contains(enlarged, candidate.grid_position));
+        }
+    }
+
+}
@@ -3,22 +3,101 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_vector.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <tuple>
+#include <vector>
+#include <stdexcept>
+#include <unordered_map>
 
 using namespace inf;
 
-std::pair<glm::ivec2, DistrictRoad> create_road(RoadDirection direction, const glm::ivec2& position, bool traversable = true) {
-    return std::make_pair(position, DistrictRoad(direction, position, traversable, nullptr));
+using RoadDescription = std::tuple<RoadDirection, glm::ivec2, bool>;
+
+// Road grids cannot have negative positions, so every road is shifted to the middle of the grid
+static const glm::ivec2 origin(3, 3);
+
+RoadDescription create_road(RoadDirection direction, const glm::ivec2& position, bool traversable = true) {
+    return std::make_tuple(direction, origin + position, traversable);
+}
+
+RoadGrid create_road_grid(const std::vector<RoadDescription>& roads) {
+    RoadGrid grid(glm::ivec2(6, 6));
+    for (const auto& [direction, position, traversable] : roads) {
+        grid.add(position, direction, traversable, nullptr);
+    }
+    return grid;
+}
+
+TEST_CASE("RoadGrid") {
+
+    SECTION("finds roads by their position") {
+        RoadGrid grid(glm::ivec2(4, 3));
+        grid.add(glm::ivec2(1, 2), RoadDirection::VERTICAL_LEFT, true, nullptr);
+        REQUIRE(grid.size() == 1);
+        REQUIRE(grid.find(glm::ivec2(0, 0)) == nullptr);
+        const auto road = grid.find(glm::ivec2(1, 2));
+        REQUIRE(road != nullptr);
+        REQUIRE(road->direction == RoadDirection::VERTICAL_LEFT);
+        REQUIRE(road->traversable);
+        REQUIRE(&grid.at(glm::ivec2(1, 2)) == road);
+        REQUIRE_THROWS_AS(grid.at(glm::ivec2(2, 1)), std::runtime_error);
+    }
+
+    SECTION("returns nullptr for positions that are out of bounds") {
+        RoadGrid grid(glm::ivec2(4, 3));
+        REQUIRE(grid.find(glm::ivec2(-1, 0)) == nullptr);
+        REQUIRE(grid.find(glm::ivec2(0, -1)) == nullptr);
+        REQUIRE(grid.find(glm::ivec2(4, 0)) == nullptr);
+        REQUIRE(grid.find(glm::ivec2(0, 3)) == nullptr);
+        REQUIRE_THROWS_AS(grid.add(glm::ivec2(4, 0), RoadDirection::VERTICAL_LEFT, true, nullptr), std::runtime_error);
+    }
+
+    SECTION("keeps the existing road when adding a road to an occupied position") {
+        RoadGrid grid(glm::ivec2(4, 3));
+        grid.add(glm::ivec2(2, 1), RoadDirection::VERTICAL_LEFT, false, nullptr);
+        grid.add(glm::ivec2(2, 1), RoadDirection::HORIZONTAL_UP, true, nullptr);
+        REQUIRE(grid.size() == 1);
+        REQUIRE(grid.at(glm::ivec2(2, 1)).direction == RoadDirection::VERTICAL_LEFT);
+        REQUIRE_FALSE(grid.at(glm::ivec2(2, 1)).traversable);
+    }
+
+    SECTION("stores the meshes of the roads") {
+        // Only the addresses of the meshes are used, so they do not need to be valid meshes
+        const auto first_mesh = reinterpret_cast<const gfx::Mesh*>(0x10);
+        const auto second_mesh = reinterpret_cast<const gfx::Mesh*>(0x20);
+        RoadGrid grid(glm::ivec2(4, 3));
+        grid.add(glm::ivec2(0, 0), RoadDirection::VERTICAL_LEFT, true, first_mesh);
+        grid.add(glm::ivec2(1, 0), RoadDirection::VERTICAL_RIGHT, true, first_mesh);
+        REQUIRE(grid.get_mesh(grid.at(glm::ivec2(0, 0))) == first_mesh);
+        grid.set_mesh(*grid.find(glm::ivec2(1, 0)), second_mesh);
+        REQUIRE(grid.get_mesh(grid.at(glm::ivec2(0, 0))) == first_mesh);
+        REQUIRE(grid.get_mesh(grid.at(glm::ivec2(1, 0))) == second_mesh);
+    }
+
+    SECTION("iterates over the roads in row-major order") {
+        RoadGrid grid(glm::ivec2(4, 3));
+        grid.add(glm::ivec2(3, 2), RoadDirection::VERTICAL_LEFT, true, nullptr);
+        grid.add(glm::ivec2(1, 0), RoadDirection::VERTICAL_LEFT, true, nullptr);
+        grid.add(glm::ivec2(0, 1), RoadDirection::VERTICAL_LEFT, true, nullptr);
+        std::vector<glm::ivec2> positions;
+        grid.for_each([&positions](const glm::ivec2& position, const DistrictRoad&) {
+            positions.emplace_back(position);
+        });
+        REQUIRE(positions == std::vector<glm::ivec2>{ glm::ivec2(1, 0), glm::ivec2(0, 1), glm::ivec2(3, 2) });
+    }
+
 }
 
 TEST_CASE("RoadUtils::get_possible_continuations()") {
 
     SECTION("returns empty vector if current position is not found") {
-        const auto result = RoadUtils::get_possible_continuations({}, glm::ivec2(), RoadDirection::VERTICAL_LEFT);
+        const auto result = RoadUtils::get_possible_continuations(create_road_grid({}), origin, RoadDirection::VERTICAL_LEFT);
         REQUIRE(result.empty());
     }
 
     SECTION("returns correct directions in a crossing where it is possible to turn either left, right or keep straight") {
-        const auto result = RoadUtils::get_possible_continuations({
+        const auto result = RoadUtils::get_possible_continuations(create_road_grid({
             create_road(RoadDirection::CROSSING_DOWN_RIGHT, glm::ivec2(0, 0)),
             create_road(RoadDirection::CROSSING_DOWN_LEFT, glm::ivec2(-1, 0)),
             create_road(RoadDirection::CROSSING_UP_LEFT, glm::ivec2(-1, -1)),
@@ -26,17 +105,17 @@ TEST_CASE("RoadUtils::get_possible_continuations()") {
             create_road(RoadDirection::HORIZONTAL_DOWN, glm::ivec2(1, 0)),
             create_road(RoadDirection::VERTICAL_RIGHT, glm::ivec2(0, -2)),
             create_road(RoadDirection::HORIZONTAL_UP, glm::ivec2(-2, -1))
-        }, glm::ivec2(0, 0), RoadDirection::VERTICAL_RIGHT);
+        }), origin, RoadDirection::VERTICAL_RIGHT);
         REQUIRE_THAT(result, Catch::Matchers::UnorderedEquals(std::vector<std::vector<glm::ivec2>>{
-            { glm::ivec2(1, 0) }, // Right turn
-            { glm::ivec2(0, -1), glm::ivec2(0, -2) }, // Going straight
-            { glm::ivec2(-1, -1), glm::ivec2(-2, -1) } // Turning left
+            { origin + glm::ivec2(1, 0) }, // Right turn
+            { origin + glm::ivec2(0, -1), origin + glm::ivec2(0, -2) }, // Going straight
+            { origin + glm::ivec2(-1, -1), origin + glm::ivec2(-2, -1) } // Turning left
         }));
     }
 
     SECTION("does not allow navigation to untraversable roads (at the edges of the districts)") {
         // Only the starting road piece should be traversable
-        const auto result = RoadUtils::get_possible_continuations({
+        const auto result = RoadUtils::get_possible_continuations(create_road_grid({
             create_road(RoadDirection::CROSSING_DOWN_RIGHT, glm::ivec2(0, 0), true),
             create_road(RoadDirection::CROSSING_DOWN_LEFT, glm::ivec2(-1, 0), false),
             create_road(RoadDirection::CROSSING_UP_LEFT, glm::ivec2(-1, -1), false),
@@ -44,8 +123,48 @@ TEST_CASE("RoadUtils::get_possible_continuations()") {
             create_road(RoadDirection::HORIZONTAL_DOWN, glm::ivec2(1, 0), false),
             create_road(RoadDirection::VERTICAL_RIGHT, glm::ivec2(0, -2), false),
             create_road(RoadDirection::HORIZONTAL_UP, glm::ivec2(-2, -1), false)
-        }, glm::ivec2(0, 0), RoadDirection::VERTICAL_RIGHT);
+        }), origin, RoadDirection::VERTICAL_RIGHT);
         REQUIRE(result.empty());
     }
 
-}
\ No newline at end of file
+}
+
+// Hidden by default, run it with the [benchmark] tag to compare the dense grid with the hash map it replaced
+TEST_CASE("RoadGrid lookup benchmark", "[.][benchmark]") {
+
+    // Road strips every 10 cells in both directions, which is roughly what the partitioning of a district produces
+    static constexpr int district_size = 100;
+    RoadGrid grid(glm::ivec2(district_size, district_size));
+    std::unordered_map<glm::ivec2, DistrictRoad> map;
+    for (int y = 0; y < district_size; ++y) {
+        for (int x = 0; x < district_size; ++x) {
+            if (x % 10 == 0 || y % 10 == 0) {
+                const auto position = glm::ivec2(x, y);
+                grid.add(position, RoadDirection::VERTICAL_LEFT, true, nullptr);
+                map.emplace(position, grid.at(position));
+            }
+        }
+    }
+
+    // Looks up every cell and its four neighbours, which is the access pattern of road post processing and vehicles
+    const auto count_neighbors = [](const auto& contains) {
+        std::size_t result = 0;
+        for (int y = 0; y < district_size; ++y) {
+            for (int x = 0; x < district_size; ++x) {
+                for (const auto& offset : { glm::ivec2(0, 0), glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1) }) {
+                    result += contains(glm::ivec2(x, y) + offset) ? 1 : 0;
+                }
+            }
+        }
+        return result;
+    };
+
+    BENCHMARK("std::unordered_map") {
+        return count_neighbors([&map](const glm::ivec2& position) { return map.find(position) != map.cend(); });
+    };
+
+    BENCHMARK("RoadGrid") {
+        return count_neighbors([&grid](const glm::ivec2& position) { return grid.find(position) != nullptr; });
+    };
+
+}
@@ -0,0 +1,64 @@
+#include "utils/lru_cache.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+using namespace inf::utils;
+
+TEST_CASE("LruCache") {
+
+    SECTION("Takes inserted values exactly once") {
+        LruCache<int, std::string> cache(4, 100);
+        cache.insert(1, "one", 1);
+        REQUIRE(cache.contains(1));
+        REQUIRE(cache.take(1) == "one");
+        REQUIRE_FALSE(cache.contains(1));
+        REQUIRE_FALSE(cache.take(1).has_value());
+        const auto statistics = cache.get_statistics();
+        REQUIRE(statistics.num_entries == 0);
+        REQUIRE(statistics.cost == 0);
+        REQUIRE(statistics.hits == 1);
+        REQUIRE(statistics.misses == 1);
+    }
+
+    SECTION("Evicts the least recently inserted entry when the entry limit is reached") {
+        LruCache<int, std::string> cache(2, 100);
+        cache.insert(1, "one", 1);
+        cache.insert(2, "two", 1);
+        cache.insert(3, "three", 1);
+        REQUIRE_FALSE(cache.contains(1));
+        REQUIRE(cache.contains(2));
+        REQUIRE(cache.contains(3));
+        REQUIRE(cache.get_statistics().num_entries == 2);
+    }
+
+    SECTION("Evicts entries until the cost limit holds") {
+        LruCache<int, std::string> cache(10, 10);
+        cache.insert(1, "one", 4);
+        cache.insert(2, "two", 4);
+        cache.insert(3, "three", 8);
+        REQUIRE_FALSE(cache.contains(1));
+        REQUIRE_FALSE(cache.contains(2));
+        REQUIRE(cache.contains(3));
+        REQUIRE(cache.get_statistics().cost == 8);
+    }
+
+    SECTION("Drops values that exceed the cost limit on their own") {
+        LruCache<int, std::string> cache(10, 10);
+        cache.insert(1, "one", 4);
+        cache.insert(2, "two", 11);
+        REQUIRE(cache.contains(1));
+        REQUIRE_FALSE(cache.contains(2));
+    }
+
+    SECTION("Replaces entries with the same key") {
+        LruCache<int, std::string> cache(10, 10);
+        cache.insert(1, "one", 4);
+        cache.insert(1, "uno", 6);
+        REQUIRE(cache.get_statistics().num_entries == 1);
+        REQUIRE(cache.get_statistics().cost == 6);
+        REQUIRE(cache.take(1) == "uno");
+    }
+
+}
@@ -0,0 +1,59 @@
+#include "utils/random_utils.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace inf;
+using namespace inf::utils;
+
+TEST_CASE("RandomUtils::split()") {
+
+    SECTION("Creates the requested number of distinct streams") {
+        const RandomGenerator rng(42);
+        const auto streams = RandomUtils::split(rng, 8);
+        REQUIRE(streams.size() == 8);
+        for (std::size_t i = 0; i < streams.size(); ++i) {
+            REQUIRE_FALSE(streams[i] == rng);
+            for (std::size_t j = i + 1; j < streams.size(); ++j) {
+                REQUIRE_FALSE(streams[i] == streams[j]);
+            }
+        }
+    }
+
+    SECTION("Does not depend on the number of streams requested") {
+        const RandomGenerator rng(1337);
+        const auto few = RandomUtils::split(rng, 2);
+        const auto many = RandomUtils::split(rng, 16);
+        REQUIRE(few[0] == many[0]);
+        REQUIRE(few[1] == many[1]);
+    }
+
+    SECTION("Does not advance the generator") {
+        RandomGenerator rng(7);
+        const auto copy = rng;
+        RandomUtils::split(rng, 4);
+        REQUIRE(rng == copy);
+    }
+
+}
+
+TEST_CASE("RandomUtils::derive_seed()") {
+
+    SECTION("Derives the same seed for the same world seed and position") {
+        REQUIRE(RandomUtils::derive_seed(42, glm::ivec2(3, -7)) == RandomUtils::derive_seed(42, glm::ivec2(3, -7)));
+    }
+
+    SECTION("Derives different seeds for neighboring positions") {
+        const auto seed = RandomUtils::derive_seed(42, glm::ivec2(0, 0));
+        REQUIRE(seed != RandomUtils::derive_seed(42, glm::ivec2(1, 0)));
+        REQUIRE(seed != RandomUtils::derive_seed(42, glm::ivec2(-1, 0)));
+        REQUIRE(seed != RandomUtils::derive_seed(42, glm::ivec2(0, 1)));
+        REQUIRE(seed != RandomUtils::derive_seed(42, glm::ivec2(0, -1)));
+        // Swapped coordinates must not collide either
+        REQUIRE(RandomUtils::derive_seed(42, glm::ivec2(1, 2)) != RandomUtils::derive_seed(42, glm::ivec2(2, 1)));
+    }
+
+    SECTION("Derives different seeds for different world seeds") {
+        REQUIRE(RandomUtils::derive_seed(1, glm::ivec2(5, 5)) != RandomUtils::derive_seed(2, glm::ivec2(5, 5)));
+    }
+
+}
@@ -0,0 +1,39 @@
+#include "utils/symbol_table.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace inf::utils;
+
+TEST_CASE("SymbolTable::intern()") {
+
+    SECTION("Returns the same identifier for the same name") {
+        const auto first = SymbolTable::intern("symbol_table_test_foo");
+        const auto second = SymbolTable::intern("symbol_table_test_foo");
+        REQUIRE(first == second);
+    }
+
+    SECTION("Returns different identifiers for different names") {
+        const auto foo = SymbolTable::intern("symbol_table_test_foo");
+        const auto bar = SymbolTable::intern("symbol_table_test_bar");
+        REQUIRE(foo != bar);
+    }
+
+    SECTION("Returns dense identifiers") {
+        const auto id = SymbolTable::intern("symbol_table_test_dense");
+        REQUIRE(id < SymbolTable::size());
+    }
+
+}
+
+TEST_CASE("SymbolTable::get_name()") {
+
+    SECTION("Returns the interned name") {
+        const auto id = SymbolTable::intern("symbol_table_test_name");
+        REQUIRE(SymbolTable::get_name(id) == "symbol_table_test_name");
+    }
+
+    SECTION("Throws for unknown identifiers") {
+        REQUIRE_THROWS(SymbolTable::get_name(static_cast<SymbolId>(SymbolTable::size())));
+    }
+
+}
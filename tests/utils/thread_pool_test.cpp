@@ -0,0 +1,55 @@
+#include "utils/thread_pool.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+using namespace inf::utils;
+
+TEST_CASE("ThreadPool::parallel_for()") {
+
+    for (const std::size_t num_threads : { 1, 4 }) {
+        SECTION("Runs every task exactly once with " + std::to_string(num_threads) + " threads") {
+            ThreadPool thread_pool(num_threads);
+            REQUIRE(thread_pool.get_number_of_threads() == num_threads);
+            // Run multiple loops to make sure the pool can be reused
+            for (std::size_t run = 0; run < 10; ++run) {
+                std::vector<std::atomic<int>> counters(1000);
+                thread_pool.parallel_for(counters.size(), [&](std::size_t index) {
+                    ++counters[index];
+                });
+                for (const auto& counter : counters) {
+                    REQUIRE(counter == 1);
+                }
+            }
+        }
+
+        SECTION("Rethrows exceptions of tasks with " + std::to_string(num_threads) + " threads") {
+            ThreadPool thread_pool(num_threads);
+            std::atomic<int> num_finished = 0;
+            REQUIRE_THROWS_AS(thread_pool.parallel_for(100, [&](std::size_t index) {
+                if (index == 42) {
+                    throw std::runtime_error("Task failed.");
+                }
+                ++num_finished;
+            }), std::runtime_error);
+            // Every other task still runs to completion
+            REQUIRE(num_finished == 99);
+        }
+    }
+
+    SECTION("Does nothing for empty loops") {
+        ThreadPool thread_pool(2);
+        bool called = false;
+        thread_pool.parallel_for(0, [&](std::size_t) { called = true; });
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("Throws without threads") {
+        REQUIRE_THROWS(ThreadPool(0));
+    }
+
+}
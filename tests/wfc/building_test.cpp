@@ -0,0 +1,227 @@
+#include "wfc/building.h"
+#include "utils/symbol_table.h"
+#include "utils/thread_pool.h"
+#include "utils/random_utils.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <optional>
+
+using namespace inf;
+using namespace inf::wfc;
+
+// Utility functions used for building generation testing
+
+std::vector<gfx::vk::VertexWithMaterial> create_triangle(utils::SymbolId material) {
+    return {
+        gfx::vk::VertexWithMaterial(glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), material),
+        gfx::vk::VertexWithMaterial(glm::vec3(0.5f, -0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), material),
+        gfx::vk::VertexWithMaterial(glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), material)
+    };
+}
+
+BuildingPattern create_test_pattern() {
+    const auto wall = utils::SymbolTable::intern("building_test_wall");
+    BuildingMaterials materials;
+    materials.emplace(wall, std::vector<glm::vec3>{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) });
+    materials.emplace(utils::SymbolTable::intern("building_test_roof"), std::vector<glm::vec3>{
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 1.0f) });
+    BuildingPattern pattern(
+        "building_test",
+        AbsoluteBuildingDimensions(Range2D<int>(3, 5), Range2D<int>(2, 4), Range2D<int>(3, 5)),
+        std::move(materials),
+        1);
+
+    std::vector<BuildingPatternFilter> corner_filters;
+    corner_filters.emplace_back(CornerBuildingPatternFilter());
+    pattern.meshes.emplace_back(
+        pattern.meshes.size(),
+        utils::SymbolTable::intern("building_test_corner"),
+        create_triangle(wall),
+        std::vector<std::uint32_t>{ 0, 1, 2 },
+        std::move(corner_filters),
+        std::vector<BuildingMeshHeightRestriction>{});
+
+    std::vector<BuildingPatternFilter> edge_filters;
+    edge_filters.emplace_back(EdgeBuildingPatternFilter());
+    pattern.meshes.emplace_back(
+        pattern.meshes.size(),
+        utils::SymbolTable::intern("building_test_edge"),
+        create_triangle(wall),
+        std::vector<std::uint32_t>{ 0, 1, 2 },
+        std::move(edge_filters),
+        std::vector<BuildingMeshHeightRestriction>{});
+
+    // Doors are only allowed on the ground floor and never next to each other
+    const auto door = utils::SymbolTable::intern("building_test_door");
+    std::vector<BuildingPatternFilter> door_filters;
+    door_filters.emplace_back(EdgeBuildingPatternFilter());
+    door_filters.emplace_back(NegationBuildingPatternFilter(
+        std::make_unique<BuildingPatternFilter>(NextToBuildingPatternFilter(door))));
+    std::vector<BuildingMeshHeightRestriction> door_height_restrictions;
+    door_height_restrictions.emplace_back(BottomHeightRestriction());
+    pattern.meshes.emplace_back(
+        pattern.meshes.size(),
+        door,
+        create_triangle(wall),
+        std::vector<std::uint32_t>{ 0, 1, 2 },
+        std::move(door_filters),
+        std::move(door_height_restrictions));
+
+    std::vector<BuildingPatternFilter> inner_filters;
+    inner_filters.emplace_back(NegationBuildingPatternFilter(
+        std::make_unique<BuildingPatternFilter>(EdgeBuildingPatternFilter())));
+    inner_filters.emplace_back(NegationBuildingPatternFilter(
+        std::make_unique<BuildingPatternFilter>(CornerBuildingPatternFilter())));
+    pattern.meshes.emplace_back(
+        pattern.meshes.size(),
+        utils::SymbolTable::intern("building_test_inner"),
+        create_triangle(wall),
+        std::vector<std::uint32_t>{ 0, 1, 2 },
+        std::move(inner_filters),
+        std::vector<BuildingMeshHeightRestriction>{});
+
+    return pattern;
+}
+
+TEST_CASE("BuildingPattern::generate()") {
+
+    const auto pattern = create_test_pattern();
+
+    SECTION("Generates geometry that fits into the requested dimensions") {
+        RandomGenerator random_generator(42);
+        for (int i = 0; i < 20; ++i) {
+            const auto geometry = pattern.generate(random_generator, 4, 4);
+            REQUIRE(geometry.dimensions.x >= 3);
+            REQUIRE(geometry.dimensions.x <= 4);
+            REQUIRE(geometry.dimensions.y >= 2);
+            REQUIRE(geometry.dimensions.y <= 4);
+            REQUIRE(geometry.dimensions.z >= 3);
+            REQUIRE(geometry.dimensions.z <= 4);
+        }
+    }
+
+    SECTION("Fills every cell of the building") {
+        RandomGenerator random_generator(42);
+        const auto geometry = pattern.generate(random_generator, 5, 5);
+        const auto num_cells = geometry.dimensions.x * geometry.dimensions.y * geometry.dimensions.z;
+        REQUIRE(geometry.cells.size() == static_cast<std::size_t>(num_cells));
+        for (const auto& cell : geometry.cells) {
+            REQUIRE(cell.mesh != nullptr);
+            REQUIRE(geometry.bounding_box.min.x <= cell.position.x);
+            REQUIRE(geometry.bounding_box.max.x >= cell.position.x);
+        }
+    }
+
+    SECTION("Generates the same geometry for the same seed") {
+        for (const auto solver : { WfcSolver::NAIVE, WfcSolver::PROPAGATING }) {
+            RandomGenerator first_generator(1337);
+            RandomGenerator second_generator(1337);
+            const auto first = pattern.generate(first_generator, 5, 5, solver);
+            const auto second = pattern.generate(second_generator, 5, 5, solver);
+            REQUIRE(first.dimensions == second.dimensions);
+            REQUIRE(first.palette == second.palette);
+            REQUIRE(first.cells.size() == second.cells.size());
+            for (std::size_t i = 0; i < first.cells.size(); ++i) {
+                REQUIRE(first.cells[i].mesh == second.cells[i].mesh);
+                REQUIRE(first.cells[i].position == second.cells[i].position);
+                REQUIRE(first.cells[i].rotation == second.cells[i].rotation);
+            }
+        }
+    }
+
+    SECTION("Generates the same buildings regardless of the number of threads") {
+        static constexpr std::size_t num_buildings = 32;
+        const auto generate_all = [&pattern](std::size_t num_threads) {
+            utils::ThreadPool thread_pool(num_threads);
+            const auto rngs = utils::RandomUtils::split(RandomGenerator(1337), num_buildings);
+            std::vector<std::optional<BuildingGeometry>> result(num_buildings);
+            thread_pool.parallel_for(num_buildings, [&](std::size_t index) {
+                auto rng = rngs[index];
+                result[index].emplace(pattern.generate(rng, 5, 5));
+            });
+            return result;
+        };
+        const auto serial = generate_all(1);
+        const auto parallel = generate_all(8);
+        for (std::size_t i = 0; i < num_buildings; ++i) {
+            REQUIRE(serial[i]->dimensions == parallel[i]->dimensions);
+            REQUIRE(serial[i]->palette == parallel[i]->palette);
+            REQUIRE(serial[i]->cells.size() == parallel[i]->cells.size());
+            for (std::size_t j = 0; j < serial[i]->cells.size(); ++j) {
+                REQUIRE(serial[i]->cells[j].mesh == parallel[i]->cells[j].mesh);
+                REQUIRE(serial[i]->cells[j].position == parallel[i]->cells[j].position);
+                REQUIRE(serial[i]->cells[j].rotation == parallel[i]->cells[j].rotation);
+            }
+        }
+    }
+
+    SECTION("Throws if the building cannot fit into the requested dimensions") {
+        RandomGenerator random_generator(42);
+        REQUIRE_THROWS(pattern.generate(random_generator, 2, 5));
+    }
+
+}
+
+TEST_CASE("BuildingPattern::get_static_masks()") {
+
+    const auto pattern = create_test_pattern();
+
+    SECTION("Only allows meshes in cells where their static filters match") {
+        const BuildingContext context(5, 3, 4);
+        const auto& masks = pattern.get_static_masks(5, 3, 4);
+        for (std::size_t cell = 0; cell < context.cells.size(); ++cell) {
+            const auto& building_cell = context.cells[cell];
+            const auto is_inner = !building_cell.is_corner && !building_cell.is_edge;
+            REQUIRE(masks.test(cell, 0) == building_cell.is_corner);
+            REQUIRE(masks.test(cell, 1) == building_cell.is_edge);
+            REQUIRE(masks.test(cell, 2) == (building_cell.is_edge && building_cell.position.y == 0));
+            REQUIRE(masks.test(cell, 3) == is_inner);
+        }
+    }
+
+    SECTION("Returns the cached masks for the same dimensions") {
+        const auto& first = pattern.get_static_masks(3, 2, 3);
+        const auto& second = pattern.get_static_masks(3, 2, 3);
+        REQUIRE(&first == &second);
+    }
+
+}
+
+TEST_CASE("BuildingPattern palettes") {
+
+    const auto pattern = create_test_pattern();
+    const auto wall = utils::SymbolTable::intern("building_test_wall");
+    const auto roof = utils::SymbolTable::intern("building_test_roof");
+
+    SECTION("Creates a palette for every material combination") {
+        REQUIRE(pattern.get_number_of_palettes() == 6);
+        std::vector<glm::vec4> palette;
+        pattern.append_palettes(palette);
+        REQUIRE(palette.size() == 12);
+    }
+
+    SECTION("Generates palette indices whose colors are candidates of the materials") {
+        std::vector<glm::vec4> palette;
+        pattern.append_palettes(palette);
+        RandomGenerator random_generator(42);
+        for (int i = 0; i < 20; ++i) {
+            const auto geometry = pattern.generate(random_generator, 5, 5);
+            REQUIRE(geometry.palette % pattern.material_slots.size() == 0);
+            REQUIRE(geometry.palette < palette.size());
+            for (const auto material : { wall, roof }) {
+                const auto color = glm::vec3(palette[geometry.palette + pattern.get_material_slot(material)]);
+                const auto& candidates = pattern.materials.at(material);
+                REQUIRE(std::find(candidates.cbegin(), candidates.cend(), color) != candidates.cend());
+            }
+        }
+    }
+
+    SECTION("Throws for undefined materials") {
+        REQUIRE_THROWS(pattern.get_material_slot(utils::SymbolTable::intern("building_test_undefined")));
+    }
+
+}
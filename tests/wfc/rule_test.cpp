@@ -2,6 +2,7 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <string>
 #include <vector>
 #include <optional>
 #include <functional>
@@ -52,29 +53,122 @@ struct ColorRule {
 
 };
 
+// Context whose cells form a line where each cell can observe its direct neighbours
+struct TestLineContext {
+
+    using InstanceType = TestCell;
+
+    std::vector<TestCell> cells;
+
+    template<typename Callback>
+    void for_each_neighbor(std::size_t index, Callback&& callback) const {
+        if (index > 0) {
+            callback(index - 1);
+        }
+        if (index < cells.size() - 1) {
+            callback(index + 1);
+        }
+    }
+
+    bool is_next_to(const TestCell& cell, CellColor color) const {
+        const auto index = static_cast<std::size_t>(&cell - cells.data());
+        return (index > 0 && cells[index - 1].color == color) ||
+            (index < cells.size() - 1 && cells[index + 1].color == color);
+    }
+
+};
+
+struct NotNextToRule {
+
+    CellColor color;
+
+    NotNextToRule(CellColor color) : color(color) {}
+
+    bool matches(const TestLineContext& context, const TestCell& cell) const {
+        return !context.is_next_to(cell, color);
+    }
+
+    void apply(TestLineContext&, TestCell& cell) const {
+        cell.color = color;
+    }
+
+};
+
 TEST_CASE("wfc_collapse()") {
 
-    SECTION("Runs WFC algorithm") {
-        TestContext context;
-        // Place 50 cells into the context
-        for (std::size_t i = 0; i < 50; ++i) {
-            // Set even = true if i is divisible by 2
-            context.cells.emplace_back(i % 2 == 0);
+    for (const auto solver : { WfcSolver::NAIVE, WfcSolver::PROPAGATING }) {
+        SECTION("Runs WFC algorithm with solver " + std::to_string(static_cast<int>(solver))) {
+            TestContext context;
+            // Place 50 cells into the context
+            for (std::size_t i = 0; i < 50; ++i) {
+                // Set even = true if i is divisible by 2
+                context.cells.emplace_back(i % 2 == 0);
+            }
+            // Color the cells of the context to red if the cell is even or blue otherwise
+            // Random generator is not used for anything here as the rules are mutually exclusive
+            RandomGenerator random_generator(42);
+            const auto is_even = [](const TestCell& cell) { return cell.even; };
+            const auto is_odd = [](const TestCell& cell) { return !cell.even; };
+            wfc_collapse(random_generator, context, std::vector<ColorRule>{
+                ColorRule(is_even, CellColor::RED),
+                ColorRule(is_odd, CellColor::BLUE)
+            }, solver);
+            for (const auto& cell : context.cells) {
+                REQUIRE(cell.color.has_value());
+                const auto expected_color = cell.even ? CellColor::RED : CellColor::BLUE;
+                REQUIRE(cell.color.value() == expected_color);
+            }
         }
-        // Color the cells of the context to red if the cell is even or blue otherwise
-        // Random generator is not used for anything here as the rules are mutually exclusive
-        RandomGenerator random_generator(42);
-        const auto is_even = [](const TestCell& cell) { return cell.even; };
-        const auto is_odd = [](const TestCell& cell) { return !cell.even; };
-        wfc_collapse(random_generator, context, std::vector<ColorRule>{
-            ColorRule(is_even, CellColor::RED),
-            ColorRule(is_odd, CellColor::BLUE)
-        });
-        for (const auto& cell : context.cells) {
-            REQUIRE(cell.color.has_value());
-            const auto expected_color = cell.even ? CellColor::RED : CellColor::BLUE;
-            REQUIRE(cell.color.value() == expected_color);
+
+        SECTION("Picks matching rules uniformly with solver " + std::to_string(static_cast<int>(solver))) {
+            // Both rules always match, so each of them should be picked for roughly half of the cells
+            static constexpr std::size_t num_cells = 1000;
+            TestContext context;
+            for (std::size_t i = 0; i < num_cells; ++i) {
+                context.cells.emplace_back(i % 2 == 0);
+            }
+            RandomGenerator random_generator(42);
+            const auto always = [](const TestCell&) { return true; };
+            wfc_collapse(random_generator, context, std::vector<ColorRule>{
+                ColorRule(always, CellColor::RED),
+                ColorRule(always, CellColor::BLUE)
+            }, solver);
+            std::size_t num_red = 0;
+            for (const auto& cell : context.cells) {
+                REQUIRE(cell.color.has_value());
+                if (cell.color.value() == CellColor::RED) {
+                    ++num_red;
+                }
+            }
+            REQUIRE(num_red > num_cells * 0.45);
+            REQUIRE(num_red < num_cells * 0.55);
+        }
+    }
+
+}
+
+TEST_CASE("wfc_collapse() with neighbors") {
+
+    for (const auto solver : { WfcSolver::NAIVE, WfcSolver::PROPAGATING }) {
+        SECTION("Re-evaluates neighbors with solver " + std::to_string(static_cast<int>(solver))) {
+            TestLineContext context;
+            for (std::size_t i = 0; i < 100; ++i) {
+                context.cells.emplace_back(i % 2 == 0);
+            }
+            // Two cells of the same color are never allowed to be next to each other
+            RandomGenerator random_generator(42);
+            wfc_collapse(random_generator, context, std::vector<NotNextToRule>{
+                NotNextToRule(CellColor::RED),
+                NotNextToRule(CellColor::BLUE)
+            }, solver);
+            for (std::size_t i = 0; i < context.cells.size(); ++i) {
+                const auto& cell = context.cells[i];
+                if (!cell.color.has_value()) {
+                    continue;
+                }
+                REQUIRE_FALSE(context.is_next_to(cell, cell.color.value()));
+            }
         }
     }
 
-}
\ No newline at end of file
+}